@@ -0,0 +1,160 @@
+// Channel mapping of one Scream chunk against a plain scalar version, on the host:
+//   cmake -S components/audio_pipeline -B build && cmake --build build && build/channel_map_bench
+// Covers every pair of 2, 4, 6 and 8 channel streams, aligned so even pairs take
+// the word copy path and offset so they don't, mono, and a parsed downmix matrix.
+// Exits with 1 when an output differs from the reference or a chunk costs more than the budget.
+#include "channel_map.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+// Payload bytes of one Scream packet, fixed by the protocol
+#define CHUNK_BYTES 1152
+#define SAMPLE_RATE 48000
+// A chunk may take this share of its own period, in tenths of a percent
+#define BUDGET_PERMILLE 20
+#define RUNS 50000
+// Stereo from 5.1 with center and surrounds at about -3dB
+#define MATRIX_5_1 "1,0,0.7,0,0.7,0;0,1,0.7,0,0,0.7"
+// Rows just under the gain sum the mix allows, and one well over it
+#define MATRIX_LOUDEST "1.9,1.9,0.199,0,0,0;-1.9,-1.9,-0.199,0,0,0"
+#define MATRIX_OVERFLOW "1.9,1.9,1.9,1.9,1.9,1.9;0,1"
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static int16_t reference_sample(const uint8_t *in, const scream_format_t *format, size_t frame, int ch) {
+    int bytes = format->bit_depth / 8;
+    const uint8_t *p = in + (frame * format->channels + ch) * bytes;
+    return (int16_t)(p[bytes - 2] | (p[bytes - 1] << 8));
+}
+
+static int16_t reference_mix(int64_t acc) {
+    acc = (acc + 8192) / 16384 - ((acc + 8192) % 16384 < 0);
+    return acc > 32767 ? 32767 : acc < -32768 ? -32768 : (int16_t)acc;
+}
+
+// One sample at a time, straight from the definition of each mode
+static void reference(const channel_map_t *map, const scream_format_t *format,
+                      const uint8_t *in, size_t frames, int16_t *out) {
+    int ch = map->channel < format->channels ? map->channel : 0;
+    int right = ch + 1 < format->channels ? ch + 1 : ch;
+    for (size_t i = 0; i < frames; i++) {
+        switch (map->mode) {
+        case CHANNEL_MAP_PAIR:
+            out[2 * i] = reference_sample(in, format, i, ch);
+            out[2 * i + 1] = reference_sample(in, format, i, right);
+            break;
+        case CHANNEL_MAP_MONO:
+            out[2 * i] = out[2 * i + 1] = reference_sample(in, format, i, ch);
+            break;
+        case CHANNEL_MAP_DOWNMIX:
+            for (int side = 0; side < 2; side++) {
+                int64_t acc = 0;
+                for (int c = 0; c < format->channels; c++) {
+                    acc += (int64_t)reference_sample(in, format, i, c) * map->matrix[side][c];
+                }
+                out[2 * i + side] = reference_mix(acc);
+            }
+            break;
+        }
+    }
+}
+
+static int run_case(const char *name, const channel_map_t *map, uint8_t bits, uint8_t channels,
+                    const uint8_t *in, int16_t *out) {
+    static int16_t expected[CHUNK_BYTES];
+    scream_format_t format = { .sample_rate = SAMPLE_RATE, .bit_depth = bits, .channels = channels };
+    size_t frames = CHUNK_BYTES / (channels * (bits / 8));
+    uint64_t period = frames * 1000000000ull / SAMPLE_RATE;
+
+    reference(map, &format, in, frames, expected);
+    memset(out, 0, frames * 2 * sizeof(int16_t));
+    channel_map_process(map, &format, in, frames, out);
+    int failures = memcmp(out, expected, frames * 2 * sizeof(int16_t)) != 0;
+
+    uint64_t start = now_ns();
+    for (int run = 0; run < RUNS; run++) {
+        channel_map_process(map, &format, in, frames, out);
+    }
+    double mapped = (double)(now_ns() - start) / RUNS;
+    start = now_ns();
+    for (int run = 0; run < RUNS; run++) {
+        reference(map, &format, in, frames, expected);
+    }
+    double scalar = (double)(now_ns() - start) / RUNS;
+
+    double load = mapped * 1000 / period;
+    printf("%-24s %2d-bit %d ch  %4zu  %8.0f  %8.0f  %4.1f permille%s\n", name, bits, channels, frames,
+           mapped, scalar, load, failures ? "  differs from reference" : "");
+    if (load > BUDGET_PERMILLE) {
+        printf("over budget\n");
+        failures++;
+    }
+    return failures;
+}
+
+int main(void) {
+    static const uint8_t channel_counts[] = { 2, 4, 6, 8 };
+    static const uint8_t depths[] = { 16, 24 };
+    // Spare bytes so the payload can start off a word boundary
+    static uint8_t payload[CHUNK_BYTES + 4] __attribute__((aligned(4)));
+    static int16_t stereo[CHUNK_BYTES + 4] __attribute__((aligned(4)));
+    uint32_t seed = 1;
+    for (int i = 0; i < CHUNK_BYTES + 4; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        payload[i] = (uint8_t)(seed >> 24);
+    }
+
+    int failures = 0;
+    char name[32];
+    printf("case                     format      frames  ns/chunk  scalar ns  load\n");
+    for (size_t d = 0; d < sizeof(depths); d++) {
+        for (size_t c = 0; c < sizeof(channel_counts); c++) {
+            uint8_t channels = channel_counts[c];
+            for (uint8_t ch = 0; ch < channels; ch += 2) {
+                channel_map_t map = { .mode = CHANNEL_MAP_PAIR, .channel = ch };
+                snprintf(name, sizeof(name), "pair %d", ch);
+                failures += run_case(name, &map, depths[d], channels, payload, stereo);
+                if (depths[d] == 16) {
+                    snprintf(name, sizeof(name), "pair %d unaligned", ch);
+                    failures += run_case(name, &map, depths[d], channels, payload + 2, stereo);
+                }
+            }
+            // An odd pair straddles words and the last one only has a left channel
+            channel_map_t odd = { .mode = CHANNEL_MAP_PAIR, .channel = channels - 1 };
+            snprintf(name, sizeof(name), "pair %d", channels - 1);
+            failures += run_case(name, &odd, depths[d], channels, payload, stereo);
+
+            channel_map_t mono = { .mode = CHANNEL_MAP_MONO, .channel = channels - 1 };
+            snprintf(name, sizeof(name), "mono %d", channels - 1);
+            failures += run_case(name, &mono, depths[d], channels, payload, stereo);
+        }
+
+        channel_map_t matrix = { .mode = CHANNEL_MAP_DOWNMIX };
+        if (!channel_map_parse_matrix(MATRIX_5_1, matrix.matrix)) {
+            printf("%s doesn't parse\n", MATRIX_5_1);
+            return 1;
+        }
+        failures += run_case("parsed matrix", &matrix, depths[d], 6, payload, stereo);
+
+        // As loud as a matrix may be, the mix has to saturate rather than wrap
+        if (!channel_map_parse_matrix(MATRIX_LOUDEST, matrix.matrix)) {
+            printf("%s doesn't parse\n", MATRIX_LOUDEST);
+            return 1;
+        }
+        failures += run_case("saturating matrix", &matrix, depths[d], 6, payload, stereo);
+    }
+
+    // Louder and full scale samples could overflow the mix
+    int16_t rejected[2][SCREAM_MAX_CHANNELS];
+    if (channel_map_parse_matrix(MATRIX_OVERFLOW, rejected)) {
+        printf("%s parses\n", MATRIX_OVERFLOW);
+        failures++;
+    }
+    return failures ? 1 : 0;
+}
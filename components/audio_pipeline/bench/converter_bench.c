@@ -0,0 +1,165 @@
+// Cost of the USB DAC format converter per chunk and a check of its filter, on the host:
+//   cmake -S components/audio_pipeline -B build && cmake --build build && build/converter_bench
+// Exits with 1 when the passband isn't flat, the stopband lets more than
+// STOPBAND_DB through, or a chunk costs more than the budget.
+#include "converter.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+// Frames in one Scream chunk of 16-bit stereo
+#define CHUNK_FRAMES 288
+#define CHANNELS 2
+// A chunk may take this share of its own period, in percent
+#define BUDGET_PERCENT 10
+#define RUNS 2000
+// Tone level of the filter checks, relative to full scale
+#define TONE_AMPLITUDE 16384.0
+// Gain allowed at 1KHz and 10KHz, and the least rejection past the transition band
+#define PASSBAND_DB 0.1
+#define STOPBAND_DB -80.0
+// Mirrors the filter design in converter.c: cutoff as a share of the lower
+// Nyquist frequency, and the Kaiser transition width as a share of the input rate
+#define CUTOFF_FRACTION 0.92
+#define TRANSITION_FRACTION 0.209
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+// Run a quarter second mono tone through a 32-bit converter. Returns the gain
+// of the tone where it is still in the output band, and what is left once it
+// is fitted out: images, aliases and rounding, in dB below the tone.
+static double run_tone(uint32_t in_rate, uint32_t out_rate, double freq, double *gain_db) {
+    converter_t c;
+    if (!converter_init(&c, in_rate, out_rate, 32, 1)) {
+        *gain_db = -INFINITY;
+        return 0;
+    }
+    size_t frames = in_rate / 4;
+    int16_t *in = malloc(frames * sizeof(int16_t));
+    int32_t *out = malloc(converter_max_output(&c, frames));
+    for (size_t i = 0; i < frames; i++) {
+        in[i] = (int16_t)lrint(TONE_AMPLITUDE * sin(2.0 * M_PI * freq * i / in_rate));
+    }
+    size_t n = converter_process(&c, in, frames, (uint8_t *)out) / sizeof(int32_t);
+
+    // Least squares fit of the tone after the filter has filled, output is at 24-bit scale << 8
+    size_t skip = n / 8;
+    bool in_band = freq < out_rate / 2.0;
+    double ss = 0, sc = 0, cc = 0, xs = 0, xc = 0;
+    for (size_t i = skip; in_band && i < n; i++) {
+        double x = out[i] / 65536.0;
+        double s = sin(2.0 * M_PI * freq * i / out_rate);
+        double k = cos(2.0 * M_PI * freq * i / out_rate);
+        ss += s * s;
+        sc += s * k;
+        cc += k * k;
+        xs += x * s;
+        xc += x * k;
+    }
+    double a = 0, b = 0;
+    if (in_band) {
+        double det = ss * cc - sc * sc;
+        a = (xs * cc - xc * sc) / det;
+        b = (ss * xc - sc * xs) / det;
+    }
+    double residual = 0;
+    for (size_t i = skip; i < n; i++) {
+        double x = out[i] / 65536.0
+            - a * sin(2.0 * M_PI * freq * i / out_rate) - b * cos(2.0 * M_PI * freq * i / out_rate);
+        residual += x * x;
+    }
+    *gain_db = 20.0 * log10(sqrt(a * a + b * b) / TONE_AMPLITUDE + 1e-12);
+    converter_deinit(&c);
+    free(in);
+    free(out);
+    return 20.0 * log10(sqrt(2.0 * residual / (n - skip)) / TONE_AMPLITUDE + 1e-12);
+}
+
+static int check_filter(uint32_t in_rate, uint32_t out_rate) {
+    int failures = 0;
+    double gain_1k, gain_10k, gain_18k, stop_gain;
+    double noise = run_tone(in_rate, out_rate, 1000.0, &gain_1k);
+    run_tone(in_rate, out_rate, 10000.0, &gain_10k);
+    run_tone(in_rate, out_rate, 18000.0, &gain_18k);
+
+    // A tone where the stopband starts, or one whose image lands there when that is past the input band
+    double lower = in_rate < out_rate ? in_rate : out_rate;
+    double edge = CUTOFF_FRACTION * lower / 2.0 + TRANSITION_FRACTION * in_rate;
+    double tone = edge < in_rate / 2.0 ? edge : in_rate - edge;
+    double stop = run_tone(in_rate, out_rate, tone, &stop_gain);
+
+    printf("%5.1f -> %5.1f KHz  1KHz %+.3f dB  10KHz %+.3f dB  18KHz %+.2f dB  noise %.1f dB  "
+           "stopband from %.1f KHz %.1f dB\n", in_rate / 1000.0, out_rate / 1000.0,
+           gain_1k, gain_10k, gain_18k, noise, edge / 1000.0, stop);
+    if (fabs(gain_1k) > PASSBAND_DB || fabs(gain_10k) > PASSBAND_DB) {
+        printf("passband not flat\n");
+        failures++;
+    }
+    if (noise > STOPBAND_DB || stop > STOPBAND_DB) {
+        printf("stopband under %.0f dB\n", -STOPBAND_DB);
+        failures++;
+    }
+    return failures;
+}
+
+static int bench(uint32_t in_rate, uint32_t out_rate, uint8_t out_bits) {
+    static int16_t chunk[CHUNK_FRAMES * CHANNELS];
+    uint32_t seed = 1;
+    for (int i = 0; i < CHUNK_FRAMES * CHANNELS; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        chunk[i] = (int16_t)(seed >> 16);
+    }
+    converter_t c;
+    if (!converter_init(&c, in_rate, out_rate, out_bits, CHANNELS)) {
+        printf("%5.1f -> %5.1f KHz %d-bit not supported\n", in_rate / 1000.0, out_rate / 1000.0, out_bits);
+        return 1;
+    }
+    uint8_t *out = malloc(converter_max_output(&c, CHUNK_FRAMES));
+    uint64_t start = now_ns();
+    for (int run = 0; run < RUNS; run++) {
+        converter_process(&c, chunk, CHUNK_FRAMES, out);
+    }
+    double per_chunk = (double)(now_ns() - start) / RUNS;
+    double period = CHUNK_FRAMES * 1e9 / in_rate;
+    printf("%5.1f -> %5.1f KHz %d-bit  %8.0f ns/chunk  %5.2f%% of %.0f us\n", in_rate / 1000.0,
+           out_rate / 1000.0, out_bits, per_chunk, per_chunk * 100 / period, period / 1000);
+    converter_deinit(&c);
+    free(out);
+    if (per_chunk * 100 > period * BUDGET_PERCENT) {
+        printf("over budget\n");
+        return 1;
+    }
+    return 0;
+}
+
+int main(void) {
+    static const uint32_t rates[][2] = {
+        { 44100, 48000 }, { 48000, 44100 }, { 48000, 96000 },
+        { 96000, 48000 }, { 44100, 96000 }, { 96000, 44100 },
+    };
+    int failures = 0;
+    printf("%d frames of %d channels per chunk\n", CHUNK_FRAMES, CHANNELS);
+    for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+        failures += bench(rates[i][0], rates[i][1], 16);
+    }
+    // Bit depth only, and both together
+    failures += bench(48000, 48000, 24);
+    failures += bench(48000, 48000, 32);
+    failures += bench(44100, 48000, 24);
+    failures += bench(48000, 96000, 32);
+
+    for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+        failures += check_filter(rates[i][0], rates[i][1]);
+    }
+    if (failures) {
+        printf("%d failures\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,69 @@
+// Cost of the compressor and look-ahead limiter per chunk, on the host:
+//   cmake -S components/audio_pipeline -B build && cmake --build build && build/dynamics_bench
+#include "dynamics.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+// Frames in one Scream chunk of 16-bit stereo
+#define CHUNK_FRAMES 288
+#define RUNS 20000
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+int main(void) {
+    static int16_t source[CHUNK_FRAMES * 2];
+    static int16_t chunk[CHUNK_FRAMES * 2];
+    static dynamics_t dynamics;
+    uint32_t seed = 1;
+    for (int i = 0; i < CHUNK_FRAMES * 2; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        source[i] = (int16_t)(seed >> 16);
+    }
+
+    static const struct {
+        const char *name;
+        bool compressor;
+        bool limiter;
+    } modes[] = {
+        { "compressor", true, false },
+        { "limiter", false, true },
+        { "both", true, true },
+    };
+    printf("%d frames per chunk at 48KHz\n", CHUNK_FRAMES);
+    printf("mode        look-ahead (ms)  ns/chunk  ns/frame\n");
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        for (int ms = 1; ms <= 5; ms += 2) {
+            dynamics_config_t config = {
+                .compressor = modes[m].compressor,
+                .threshold_db = -20.0f,
+                .ratio = 4.0f,
+                .attack_ms = 10.0f,
+                .release_ms = 200.0f,
+                .makeup_db = 6.0f,
+                .limiter = modes[m].limiter,
+                .ceiling_db = -1.0f,
+                .lookahead_ms = (float)ms,
+            };
+            dynamics_init(&dynamics);
+            dynamics_configure(&dynamics, &config, 48000);
+
+            uint64_t elapsed = 0;
+            for (int run = 0; run < RUNS; run++) {
+                for (int i = 0; i < CHUNK_FRAMES * 2; i++) {
+                    chunk[i] = source[i];
+                }
+                uint64_t start = now_ns();
+                dynamics_process_s16(&dynamics, chunk, CHUNK_FRAMES);
+                elapsed += now_ns() - start;
+            }
+            double per_chunk = (double)elapsed / RUNS;
+            printf("%-10s  %15d  %8.0f  %8.2f\n", modes[m].name, ms, per_chunk, per_chunk / CHUNK_FRAMES);
+        }
+    }
+    return 0;
+}
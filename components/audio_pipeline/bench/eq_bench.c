@@ -0,0 +1,53 @@
+// Cost of the equaliser per chunk for 1 to EQ_MAX_BANDS bands, on the host:
+//   cmake -S components/audio_pipeline -B build && cmake --build build && build/eq_bench
+// Configure with -DAUDIO_PIPELINE_FIXED_POINT=ON to time the fixed point cascade.
+#include "eq.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+// Frames in one Scream chunk of 16-bit stereo
+#define CHUNK_FRAMES 288
+#define RUNS 20000
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+int main(void) {
+    static int16_t chunk[CHUNK_FRAMES * 2];
+    uint32_t seed = 1;
+    for (int i = 0; i < CHUNK_FRAMES * 2; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        chunk[i] = (int16_t)(seed >> 18);
+    }
+
+    eq_band_t bands[EQ_MAX_BANDS];
+    for (int i = 0; i < EQ_MAX_BANDS; i++) {
+        bands[i] = (eq_band_t){ EQ_PEAK, 40.0f * (float)(1 << i) / 2.0f + 30.0f, -3.0f, 1.4f };
+    }
+
+#ifdef EQ_FIXED_POINT
+    printf("fixed point cascade, %d frames per chunk\n", CHUNK_FRAMES);
+#else
+    printf("float cascade, %d frames per chunk\n", CHUNK_FRAMES);
+#endif
+    printf("bands  ns/chunk  ns/frame\n");
+    for (int count = 1; count <= EQ_MAX_BANDS; count++) {
+        eq_t eq;
+        eq_coeffs_t coeffs;
+        eq_init(&eq);
+        eq_design(bands, count, 48000, &coeffs);
+        eq_set_coeffs(&eq, &coeffs);
+
+        uint64_t start = now_ns();
+        for (int run = 0; run < RUNS; run++) {
+            eq_process_s16(&eq, chunk, CHUNK_FRAMES);
+        }
+        double per_chunk = (double)(now_ns() - start) / RUNS;
+        printf("%5d  %8.0f  %8.2f\n", count, per_chunk, per_chunk / CHUNK_FRAMES);
+    }
+    return 0;
+}
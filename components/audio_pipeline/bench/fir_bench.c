@@ -0,0 +1,54 @@
+// Cost of the partitioned convolution per chunk against the length of the
+// impulse response, on the host:
+//   cmake -S components/audio_pipeline -B build && cmake --build build && build/fir_bench
+#include "fir.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+// Frames in one Scream chunk of 16-bit stereo
+#define CHUNK_FRAMES 288
+#define RUNS 2000
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+int main(void) {
+    static int16_t chunk[CHUNK_FRAMES * 2];
+    static float taps[FIR_PARTITION_FRAMES * 2];
+    uint32_t seed = 1;
+    for (int i = 0; i < CHUNK_FRAMES * 2; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        chunk[i] = (int16_t)(seed >> 18);
+    }
+    for (int i = 0; i < FIR_PARTITION_FRAMES * 2; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        taps[i] = (float)(int32_t)seed / 2147483648.0f / 64.0f;
+    }
+
+    printf("%d frame partitions, %d frames per chunk\n", FIR_PARTITION_FRAMES, CHUNK_FRAMES);
+    printf(" taps  stereo  ns/chunk  memory (KB)\n");
+    for (size_t count = 512; count <= FIR_MAX_TAPS; count *= 2) {
+        for (int stereo = 0; stereo <= 1; stereo++) {
+            fir_conv_t *fir = fir_create(count, stereo);
+            if (fir == NULL) {
+                printf("%5zu  %6d  out of memory\n", count, stereo);
+                continue;
+            }
+            for (int p = 0; p < fir->partitions; p++) {
+                fir_set_partition(fir, p, taps, taps + FIR_PARTITION_FRAMES, FIR_PARTITION_FRAMES);
+            }
+            uint64_t start = now_ns();
+            for (int run = 0; run < RUNS; run++) {
+                fir_process_s16(fir, chunk, CHUNK_FRAMES);
+            }
+            double per_chunk = (double)(now_ns() - start) / RUNS;
+            printf("%5zu  %6d  %8.0f  %11zu\n", count, stereo, per_chunk, fir_memory_bytes(count, stereo) / 1024);
+            fir_destroy(fir);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,114 @@
+// Cost of one Scream chunk in every format the sender can describe, on the host:
+//   cmake -S components/audio_pipeline -B build && cmake --build build && build/format_bench
+// One case per bit depth and channel count at 48KHz. Each case times what the
+// receiver does to a chunk, channel mapping to 16-bit stereo and the gain, plus
+// the sender's in place gain for the 16-bit formats it can take from USB.
+// Exits with 1 when a header doesn't parse back or a chunk costs more than the budget.
+#include "channel_map.h"
+#include "gain.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+// Payload bytes of one Scream packet, fixed by the protocol
+#define CHUNK_BYTES 1152
+#define SAMPLE_RATE 48000
+// A chunk may take this share of its own period, in tenths of a percent
+#define BUDGET_PERMILLE 20
+#define RUNS 50000
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+// Same masks the sender puts in its header
+static uint16_t channel_mask_for(uint8_t channels) {
+    switch (channels) {
+    case 1: return SPEAKER_FRONT_CENTER;
+    case 2: return SPEAKER_FRONT_LEFT | SPEAKER_FRONT_RIGHT;
+    case 4: return 0x0033;
+    case 6: return 0x003F;
+    case 8: return 0x063F;
+    default: return 0;
+    }
+}
+
+int main(void) {
+    static const uint8_t depths[] = { 16, 24, 32 };
+    static const uint8_t channel_counts[] = { 1, 2, 4, 6, 8 };
+    static uint8_t payload[CHUNK_BYTES] __attribute__((aligned(4)));
+    static uint8_t sent[CHUNK_BYTES] __attribute__((aligned(4)));
+    static int16_t stereo[CHUNK_BYTES] __attribute__((aligned(4)));
+    uint32_t seed = 1;
+    for (int i = 0; i < CHUNK_BYTES; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        payload[i] = (uint8_t)(seed >> 24);
+    }
+
+    int failures = 0;
+    printf("format       frames  period ns  receive ns/chunk  send ns/chunk  load\n");
+    for (size_t d = 0; d < sizeof(depths); d++) {
+        for (size_t c = 0; c < sizeof(channel_counts); c++) {
+            uint8_t channels = channel_counts[c];
+            uint16_t mask = channel_mask_for(channels);
+            uint8_t header[SCREAM_HEADER_SIZE] = {
+                SAMPLE_RATE / 48000, depths[d], channels, mask & 0xFF, mask >> 8,
+            };
+            scream_format_t format;
+            if (!scream_parse_header(header, &format) || format.channels != channels
+                || format.bit_depth != depths[d] || format.sample_rate != SAMPLE_RATE) {
+                printf("%2d-bit %d ch: header doesn't parse back\n", depths[d], channels);
+                failures++;
+                continue;
+            }
+
+            // What a receiver set to its default map does with the stream
+            channel_map_t map = { .mode = CHANNEL_MAP_PAIR, .channel = 0 };
+            if (channels == 1) {
+                map.mode = CHANNEL_MAP_MONO;
+            } else if (channels > 2) {
+                map.mode = CHANNEL_MAP_DOWNMIX;
+                channel_map_default_matrix(&format, map.matrix);
+            }
+            size_t frames = CHUNK_BYTES / (channels * (depths[d] / 8));
+            uint64_t period = frames * 1000000000ull / SAMPLE_RATE;
+
+            gain_stage_t gain;
+            gain_init(&gain, 0.5f, GAIN_RAMP_LINEAR);
+            uint64_t start = now_ns();
+            for (int run = 0; run < RUNS; run++) {
+                channel_map_process(&map, &format, payload, frames, stereo);
+                gain_process_s16(&gain, stereo, frames, 2);
+            }
+            double receive = (double)(now_ns() - start) / RUNS;
+
+            // The sender only takes 16-bit from USB and scales it in the packet
+            double send = 0;
+            if (depths[d] == 16) {
+                gain_init(&gain, 0.5f, GAIN_RAMP_LINEAR);
+                start = now_ns();
+                for (int run = 0; run < RUNS; run++) {
+                    memcpy(sent, payload, CHUNK_BYTES);
+                    gain_process_s16(&gain, (int16_t *)sent, frames, channels);
+                }
+                send = (double)(now_ns() - start) / RUNS;
+            }
+
+            double load = (receive > send ? receive : send) * 1000 / period;
+            char send_text[16] = "-";
+            if (depths[d] == 16) {
+                snprintf(send_text, sizeof(send_text), "%.0f", send);
+            }
+            printf("%2d-bit %d ch  %6zu  %9llu  %16.0f  %13s  %4.1f permille\n",
+                   depths[d], channels, frames, (unsigned long long)period, receive, send_text, load);
+            if (load > BUDGET_PERMILLE) {
+                printf("over budget\n");
+                failures++;
+            }
+        }
+    }
+    return failures ? 1 : 0;
+}
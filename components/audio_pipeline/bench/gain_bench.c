@@ -0,0 +1,138 @@
+// Gain ramps checked for clicks, and the cost of the gain stage per chunk, on the host:
+//   cmake -S components/audio_pipeline -B build && cmake --build build && build/gain_bench
+// Exits with 1 when a ramp misses its target, steps backwards or overshoots,
+// unity gain changes a sample, or a chunk costs more than the budget.
+#include "gain.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+// Frames in one Scream chunk of 16-bit stereo, 6ms at 48KHz
+#define CHUNK_FRAMES 288
+#define CHUNK_NS (CHUNK_FRAMES * 1000000000ull / 48000)
+#define CHANNELS 2
+// The gain stage may take this share of a chunk period, in tenths of a percent
+#define BUDGET_PERMILLE 5
+#define RUNS 200000
+// Chunks that are plenty for any ramp to settle
+#define SETTLE_CHUNKS 64
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+// Ramps a full scale DC chunk by chunk, so every output sample is the gain applied to it
+static int check_ramp(gain_ramp_type_t type, float from, float to, const char *name) {
+    static int16_t chunk[CHUNK_FRAMES * CHANNELS] __attribute__((aligned(4)));
+    gain_stage_t g;
+    gain_init(&g, from, type);
+    gain_set_target(&g, to);
+    int32_t target = g.target_q15;
+    bool rising = to > from;
+    int32_t last = (32767 * g.current_q15) >> 15;
+    int failures = 0;
+    int settled_at = -1;
+
+    for (int c = 0; c < SETTLE_CHUNKS; c++) {
+        for (int i = 0; i < CHUNK_FRAMES * CHANNELS; i++) {
+            chunk[i] = 32767;
+        }
+        gain_process_s16(&g, chunk, CHUNK_FRAMES, CHANNELS);
+        for (int f = 0; f < CHUNK_FRAMES; f++) {
+            int32_t v = chunk[f * CHANNELS];
+            if (chunk[f * CHANNELS + 1] != v) {
+                failures++;
+            }
+            if ((rising && v < last) || (!rising && v > last)) {
+                printf("%s: steps back from %d to %d in chunk %d\n", name, (int)last, (int)v, c);
+                failures++;
+            }
+            int32_t end = (32767 * target) >> 15;
+            if ((rising && v > end) || (!rising && v < end)) {
+                printf("%s: overshoots %d with %d in chunk %d\n", name, (int)end, (int)v, c);
+                failures++;
+            }
+            last = v;
+        }
+        if (settled_at < 0 && g.current_q15 == target) {
+            settled_at = c;
+        }
+    }
+    if (g.current_q15 != target) {
+        printf("%s: stuck at %d, target %d\n", name, (int)g.current_q15, (int)target);
+        failures++;
+    }
+    printf("%-26s settled in %d chunks\n", name, settled_at + 1);
+    return failures;
+}
+
+static int check_unity(void) {
+    static int16_t chunk[CHUNK_FRAMES * CHANNELS] __attribute__((aligned(4)));
+    static int16_t ref[CHUNK_FRAMES * CHANNELS];
+    uint32_t seed = 1;
+    for (int i = 0; i < CHUNK_FRAMES * CHANNELS; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        chunk[i] = ref[i] = (int16_t)(seed >> 16);
+    }
+    gain_stage_t g;
+    gain_init(&g, 1.0f, GAIN_RAMP_LINEAR);
+    gain_process_s16(&g, chunk, CHUNK_FRAMES, CHANNELS);
+    for (int i = 0; i < CHUNK_FRAMES * CHANNELS; i++) {
+        if (chunk[i] != ref[i]) {
+            printf("unity: sample %d changed from %d to %d\n", i, ref[i], chunk[i]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static double bench(gain_stage_t *g, int16_t *chunk) {
+    uint64_t start = now_ns();
+    for (int run = 0; run < RUNS; run++) {
+        gain_process_s16(g, chunk, CHUNK_FRAMES, CHANNELS);
+    }
+    return (double)(now_ns() - start) / RUNS;
+}
+
+int main(void) {
+    int failures = 0;
+    failures += check_ramp(GAIN_RAMP_LINEAR, 0.0f, 1.0f, "linear 0 to 1");
+    failures += check_ramp(GAIN_RAMP_LINEAR, 1.0f, 0.0f, "linear 1 to 0");
+    failures += check_ramp(GAIN_RAMP_LINEAR, 0.25f, 0.3f, "linear 0.25 to 0.3");
+    failures += check_ramp(GAIN_RAMP_EXPONENTIAL, 0.0f, 1.0f, "exponential 0 to 1");
+    failures += check_ramp(GAIN_RAMP_EXPONENTIAL, 1.0f, 0.0f, "exponential 1 to 0");
+    failures += check_ramp(GAIN_RAMP_EXPONENTIAL, 0.5f, 0.49f, "exponential 0.5 to 0.49");
+    failures += check_unity();
+
+    static int16_t chunk[CHUNK_FRAMES * CHANNELS] __attribute__((aligned(4)));
+    gain_stage_t g;
+    gain_init(&g, 1.0f, GAIN_RAMP_LINEAR);
+    double unity = bench(&g, chunk);
+    gain_init(&g, 0.5f, GAIN_RAMP_LINEAR);
+    double steady = bench(&g, chunk);
+    // Flip the target every chunk so each one is a ramp
+    uint64_t start = now_ns();
+    for (int run = 0; run < RUNS; run++) {
+        gain_set_target(&g, (run & 1) ? 0.2f : 0.8f);
+        gain_process_s16(&g, chunk, CHUNK_FRAMES, CHANNELS);
+    }
+    double ramping = (double)(now_ns() - start) / RUNS;
+    double budget = (double)CHUNK_NS * BUDGET_PERMILLE / 1000;
+
+    printf("%d frames of %d channels, chunk period %llu ns\n", CHUNK_FRAMES, CHANNELS, (unsigned long long)CHUNK_NS);
+    printf("unity    %8.0f ns/chunk\n", unity);
+    printf("steady   %8.0f ns/chunk\n", steady);
+    printf("ramping  %8.0f ns/chunk  budget %8.0f ns (%d permille)\n", ramping, budget, BUDGET_PERMILLE);
+    if (failures) {
+        printf("%d failures\n", failures);
+        return 1;
+    }
+    if (ramping > budget) {
+        printf("over budget\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,86 @@
+// Cost of the level meters and spectrum analysis per chunk, on the host:
+//   cmake -S components/audio_pipeline -B build && cmake --build build && build/meter_bench
+// Exits with 1 when the part that runs on the audio task is over its budget.
+#include "meter.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+
+// Frames in one Scream chunk of 16-bit stereo, 6ms at 48KHz
+#define CHUNK_FRAMES 288
+#define CHUNK_NS (CHUNK_FRAMES * 1000000000ull / 48000)
+// Most lanes a chunk carries
+#define LANES 4
+// Meters and the scope may take this share of the audio task, in percent of a chunk
+#define AUDIO_TASK_BUDGET_PERCENT 1
+#define RUNS 20000
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+int main(void) {
+    static int16_t chunk[LANES][CHUNK_FRAMES * 2];
+    static meter_levels_t levels[LANES];
+    static meter_scope_t scope;
+    static meter_spectrum_t spectrum;
+    static int16_t mono[METER_FFT_SIZE];
+    uint32_t seed = 1;
+    for (int lane = 0; lane < LANES; lane++) {
+        for (int i = 0; i < CHUNK_FRAMES * 2; i++) {
+            seed = seed * 1664525u + 1013904223u;
+            chunk[lane][i] = (int16_t)(seed >> 16);
+        }
+    }
+
+    // What the meter stage does per chunk: every lane measured, lane 0 into the scope
+    uint64_t elapsed = 0;
+    for (int run = 0; run < RUNS; run++) {
+        uint64_t start = now_ns();
+        for (int lane = 0; lane < LANES; lane++) {
+            meter_measure_s16(&levels[lane], chunk[lane], CHUNK_FRAMES);
+        }
+        meter_scope_write(&scope, chunk[0], CHUNK_FRAMES);
+        elapsed += now_ns() - start;
+    }
+    double audio_task = (double)elapsed / RUNS;
+    double budget = (double)CHUNK_NS * AUDIO_TASK_BUDGET_PERCENT / 100;
+
+    // A full scale sine in the middle of its band should read close to 0dB
+    if (!meter_spectrum_init(&spectrum, 48000)) {
+        return 1;
+    }
+    for (int n = 0; n < METER_FFT_SIZE; n++) {
+        mono[n] = (int16_t)lrint(32767.0 * sin(2.0 * M_PI * 1000.0 * n / 48000));
+    }
+    uint8_t codes[METER_BANDS];
+    elapsed = 0;
+    for (int run = 0; run < RUNS / 10; run++) {
+        uint64_t start = now_ns();
+        meter_spectrum_analyze(&spectrum, mono, codes);
+        elapsed += now_ns() - start;
+    }
+    double analysis = (double)elapsed / (RUNS / 10);
+    int loudest = 0;
+    for (int band = 1; band < METER_BANDS; band++) {
+        if (codes[band] < codes[loudest]) {
+            loudest = band;
+        }
+    }
+
+    printf("%d lanes of %d frames, chunk period %llu ns\n", LANES, CHUNK_FRAMES, (unsigned long long)CHUNK_NS);
+    printf("audio task, meters and scope  %8.0f ns/chunk  budget %8.0f ns (%d%%)\n",
+           audio_task, budget, AUDIO_TASK_BUDGET_PERCENT);
+    printf("spectrum, %d point FFT      %8.0f ns/frame\n", METER_FFT_SIZE, analysis);
+    printf("1KHz full scale sine          band %d at %.1f dB\n", loudest, -codes[loudest] * METER_CODE_STEP_DB);
+    printf("lane 0 peak %.1f dB, rms %.1f dB\n",
+           -meter_peak_code(&levels[0], 0) * METER_CODE_STEP_DB, -meter_rms_code(&levels[0], 0) * METER_CODE_STEP_DB);
+    if (audio_task > budget) {
+        printf("over budget\n");
+        return 1;
+    }
+    return 0;
+}
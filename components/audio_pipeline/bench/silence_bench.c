@@ -0,0 +1,70 @@
+// Cost of the digital silence detector per chunk, on the host:
+//   cmake -S components/audio_pipeline -B build && cmake --build build && build/silence_bench
+// Exits with 1 when a chunk costs more than the budget.
+#include "silence.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+// Samples in one Scream chunk of 16-bit stereo per lane, 6ms at 48KHz
+#define CHUNK_SAMPLES 576
+#define CHUNK_NS 6000000
+#define LANES 4
+// Detection may take this share of a chunk period, in tenths of a percent
+#define BUDGET_PERMILLE 1
+#define RUNS 200000
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static double run(silence_detector_t *d, const int16_t *chunk, bool *silent) {
+    uint64_t start = now_ns();
+    for (int run = 0; run < RUNS; run++) {
+        *silent = silence_update(d, chunk, CHUNK_SAMPLES * LANES);
+    }
+    return (double)(now_ns() - start) / RUNS;
+}
+
+int main(void) {
+    static int16_t zeros[CHUNK_SAMPLES * LANES];
+    static int16_t dither[CHUNK_SAMPLES * LANES];
+    static int16_t music[CHUNK_SAMPLES * LANES];
+    uint32_t seed = 1;
+    for (int i = 0; i < CHUNK_SAMPLES * LANES; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        dither[i] = (int16_t)((int32_t)(seed >> 16) % 15 - 7);
+        music[i] = (int16_t)(seed >> 16);
+    }
+
+    silence_detector_t d;
+    silence_init(&d, 10);
+    bool silent;
+    double budget = (double)CHUNK_NS * BUDGET_PERMILLE / 1000;
+    printf("%d lanes of %d samples, budget %.0f ns/chunk\n", LANES, CHUNK_SAMPLES, budget);
+    printf("input        ns/chunk  silent\n");
+    double zeros_ns = run(&d, zeros, &silent);
+    printf("zeros        %8.0f  %d\n", zeros_ns, silent);
+    double dither_ns = run(&d, dither, &silent);
+    printf("dither +-7   %8.0f  %d\n", dither_ns, silent);
+    double music_ns = run(&d, music, &silent);
+    printf("full scale   %8.0f  %d\n", music_ns, silent);
+
+    // Hysteresis: a peak of 15 ends silence only from the audio side of the threshold
+    static int16_t quiet[CHUNK_SAMPLES];
+    quiet[100] = 15;
+    silence_init(&d, 10);
+    silence_update(&d, zeros, CHUNK_SAMPLES);
+    bool stays_silent = silence_update(&d, quiet, CHUNK_SAMPLES);
+    silence_init(&d, 10);
+    bool stays_audio = !silence_update(&d, quiet, CHUNK_SAMPLES);
+    printf("hysteresis   %s\n", stays_silent && stays_audio ? "ok" : "broken");
+
+    if (zeros_ns > budget || dither_ns > budget || music_ns > budget || !stays_silent || !stays_audio) {
+        printf("failed\n");
+        return 1;
+    }
+    return 0;
+}
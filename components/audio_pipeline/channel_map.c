@@ -0,0 +1,246 @@
+#include "channel_map.h"
+#include <stdlib.h>
+#include <string.h>
+
+// -3dB in Q14
+#define Q14_MINUS_3DB 11585
+// -6dB in Q14
+#define Q14_MINUS_6DB 8192
+// A row's gains must add up to less than this for its 32-bit mix of full
+// scale samples not to overflow
+#define Q14_MAX_ROW_SUM (4 * CHANNEL_MAP_Q14_UNITY)
+
+// Channel order a stream has when its header gives no usable mask
+static uint16_t default_layout(uint8_t channels, int index) {
+    static const uint16_t surround[] = {
+        SPEAKER_FRONT_LEFT, SPEAKER_FRONT_RIGHT, SPEAKER_FRONT_CENTER, SPEAKER_LOW_FREQUENCY,
+        SPEAKER_BACK_LEFT, SPEAKER_BACK_RIGHT, SPEAKER_SIDE_LEFT, SPEAKER_SIDE_RIGHT,
+    };
+    static const uint16_t quad[] = {
+        SPEAKER_FRONT_LEFT, SPEAKER_FRONT_RIGHT, SPEAKER_BACK_LEFT, SPEAKER_BACK_RIGHT,
+    };
+    if (channels == 1) {
+        return SPEAKER_FRONT_CENTER;
+    }
+    if (channels == 4) {
+        return quad[index];
+    }
+    return surround[index];
+}
+
+bool scream_parse_header(const uint8_t *header, scream_format_t *format) {
+    // Bit 7 picks the 44.1KHz or 48KHz family, the rest is the multiplier
+    uint32_t base = (header[0] & 0x80) ? 44100 : 48000;
+    format->sample_rate = base * (header[0] & 0x7F);
+    format->bit_depth = header[1];
+    format->channels = header[2];
+    format->channel_mask = header[3] | (header[4] << 8);
+    return format->sample_rate != 0
+        && (format->bit_depth == 16 || format->bit_depth == 24 || format->bit_depth == 32)
+        && format->channels >= 1 && format->channels <= SCREAM_MAX_CHANNELS;
+}
+
+void channel_map_default_matrix(const scream_format_t *format, int16_t matrix[2][SCREAM_MAX_CHANNELS]) {
+    memset(matrix, 0, sizeof(int16_t) * 2 * SCREAM_MAX_CHANNELS);
+    if (format->channels == 1) {
+        matrix[0][0] = CHANNEL_MAP_Q14_UNITY;
+        matrix[1][0] = CHANNEL_MAP_Q14_UNITY;
+        return;
+    }
+
+    // The mask lists the channels in stream order, lowest bit first
+    bool use_mask = __builtin_popcount(format->channel_mask) == format->channels;
+    uint16_t remaining = format->channel_mask;
+    int32_t sum[2] = { 0, 0 };
+    for (int ch = 0; ch < format->channels; ch++) {
+        uint16_t speaker;
+        if (use_mask) {
+            speaker = remaining & -remaining;
+            remaining &= remaining - 1;
+        } else {
+            speaker = default_layout(format->channels, ch);
+        }
+        int16_t left = 0;
+        int16_t right = 0;
+        switch (speaker) {
+        case SPEAKER_FRONT_LEFT:
+        case SPEAKER_FRONT_LEFT_OF_CENTER:
+            left = CHANNEL_MAP_Q14_UNITY;
+            break;
+        case SPEAKER_FRONT_RIGHT:
+        case SPEAKER_FRONT_RIGHT_OF_CENTER:
+            right = CHANNEL_MAP_Q14_UNITY;
+            break;
+        case SPEAKER_FRONT_CENTER:
+            left = right = Q14_MINUS_3DB;
+            break;
+        case SPEAKER_BACK_LEFT:
+        case SPEAKER_SIDE_LEFT:
+            left = Q14_MINUS_3DB;
+            break;
+        case SPEAKER_BACK_RIGHT:
+        case SPEAKER_SIDE_RIGHT:
+            right = Q14_MINUS_3DB;
+            break;
+        case SPEAKER_BACK_CENTER:
+            left = right = Q14_MINUS_6DB;
+            break;
+        default:
+            // LFE and unknown positions are left out
+            break;
+        }
+        matrix[0][ch] = left;
+        matrix[1][ch] = right;
+        sum[0] += left;
+        sum[1] += right;
+    }
+
+    // Scale both rows alike so the louder one sums to unity
+    int32_t peak = sum[0] > sum[1] ? sum[0] : sum[1];
+    if (peak > CHANNEL_MAP_Q14_UNITY) {
+        for (int row = 0; row < 2; row++) {
+            for (int ch = 0; ch < format->channels; ch++) {
+                matrix[row][ch] = (int16_t)((int32_t)matrix[row][ch] * CHANNEL_MAP_Q14_UNITY / peak);
+            }
+        }
+    }
+}
+
+bool channel_map_parse_matrix(const char *text, int16_t matrix[2][SCREAM_MAX_CHANNELS]) {
+    memset(matrix, 0, sizeof(int16_t) * 2 * SCREAM_MAX_CHANNELS);
+    const char *p = text;
+    for (int row = 0; row < 2; row++) {
+        for (int ch = 0; ch < SCREAM_MAX_CHANNELS; ch++) {
+            char *end;
+            float gain = strtof(p, &end);
+            if (end == p || gain < -1.99f || gain > 1.99f) {
+                return false;
+            }
+            matrix[row][ch] = (int16_t)(gain * CHANNEL_MAP_Q14_UNITY + (gain < 0 ? -0.5f : 0.5f));
+            p = end;
+            while (*p == ' ') {
+                p++;
+            }
+            if (*p != ',') {
+                break;
+            }
+            p++;
+        }
+        if (row == 0) {
+            if (*p != ';') {
+                return false;
+            }
+            p++;
+        }
+        int32_t sum = 0;
+        for (int ch = 0; ch < SCREAM_MAX_CHANNELS; ch++) {
+            sum += abs(matrix[row][ch]);
+        }
+        if (sum >= Q14_MAX_ROW_SUM) {
+            return false;
+        }
+    }
+    return *p == '\0';
+}
+
+bool channel_map_is_identity(const channel_map_t *map, const scream_format_t *format) {
+    if (format->bit_depth != 16 || format->channels != 2) {
+        return false;
+    }
+    if (map->mode == CHANNEL_MAP_PAIR) {
+        return map->channel == 0;
+    }
+    if (map->mode == CHANNEL_MAP_DOWNMIX) {
+        return map->matrix[0][0] == CHANNEL_MAP_Q14_UNITY && map->matrix[0][1] == 0
+            && map->matrix[1][0] == 0 && map->matrix[1][1] == CHANNEL_MAP_Q14_UNITY;
+    }
+    return false;
+}
+
+// Top 16 bits of a little endian sample of any width, unaligned safe
+static inline int16_t read_sample(const uint8_t *p, int bytes) {
+    return (int16_t)(p[bytes - 2] | (p[bytes - 1] << 8));
+}
+
+static inline int16_t saturate_q14(int32_t acc) {
+    acc = (acc + (1 << 13)) >> 14;
+    if (acc > 32767) {
+        return 32767;
+    }
+    if (acc < -32768) {
+        return -32768;
+    }
+    return (int16_t)acc;
+}
+
+void channel_map_process(const channel_map_t *map, const scream_format_t *format,
+                         const uint8_t *in, size_t num_frames, int16_t *out) {
+    const int bytes = format->bit_depth / 8;
+    const int channels = format->channels;
+    const size_t frame_bytes = (size_t)channels * bytes;
+
+    switch (map->mode) {
+    case CHANNEL_MAP_PAIR: {
+        int ch = map->channel < channels ? map->channel : 0;
+        int right = ch + 1 < channels ? ch + 1 : ch;
+        if (bytes == 2 && (ch & 1) == 0 && (channels & 1) == 0 && right == ch + 1
+            && ((uintptr_t)in & 3) == 0 && ((uintptr_t)out & 3) == 0) {
+            // A 16-bit pair on an even channel is one aligned word per frame,
+            // move left and right together
+            const uint32_t *src = (const uint32_t *)in + ch / 2;
+            uint32_t *dst = (uint32_t *)out;
+            const int stride = channels / 2;
+            size_t i = 0;
+            for (; i + 4 <= num_frames; i += 4) {
+                dst[i] = src[0];
+                dst[i + 1] = src[stride];
+                dst[i + 2] = src[2 * stride];
+                dst[i + 3] = src[3 * stride];
+                src += 4 * stride;
+            }
+            for (; i < num_frames; i++) {
+                dst[i] = *src;
+                src += stride;
+            }
+            return;
+        }
+        const uint8_t *l = in + ch * bytes;
+        const uint8_t *r = in + right * bytes;
+        for (size_t i = 0; i < num_frames; i++) {
+            out[2 * i] = read_sample(l, bytes);
+            out[2 * i + 1] = read_sample(r, bytes);
+            l += frame_bytes;
+            r += frame_bytes;
+        }
+        return;
+    }
+    case CHANNEL_MAP_MONO: {
+        int ch = map->channel < channels ? map->channel : 0;
+        const uint8_t *p = in + ch * bytes;
+        for (size_t i = 0; i < num_frames; i++) {
+            int16_t s = read_sample(p, bytes);
+            out[2 * i] = s;
+            out[2 * i + 1] = s;
+            p += frame_bytes;
+        }
+        return;
+    }
+    case CHANNEL_MAP_DOWNMIX: {
+        const int16_t *ml = map->matrix[0];
+        const int16_t *mr = map->matrix[1];
+        for (size_t i = 0; i < num_frames; i++) {
+            int32_t left = 0;
+            int32_t right = 0;
+            for (int ch = 0; ch < channels; ch++) {
+                int32_t s = read_sample(in + ch * bytes, bytes);
+                left += s * ml[ch];
+                right += s * mr[ch];
+            }
+            out[2 * i] = saturate_q14(left);
+            out[2 * i + 1] = saturate_q14(right);
+            in += frame_bytes;
+        }
+        return;
+    }
+    }
+}
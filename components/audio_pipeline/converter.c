@@ -0,0 +1,205 @@
+#include "converter.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef ESP_PLATFORM
+#include "esp_cpu.h"
+#else
+#include <time.h>
+#endif
+
+// Kaiser window shape, at least 80dB stopband attenuation once past the
+// transition band, which with 24 taps per phase is about 0.21 of the input
+// rate wide. Flat to 10KHz, 1-3dB down at 18KHz (checked by converter_bench)
+#define KAISER_BETA 8.0f
+// Passband edge as a fraction of the lower Nyquist frequency
+#define CUTOFF_FRACTION 0.92f
+
+static inline uint32_t cycle_count(void)
+{
+#ifdef ESP_PLATFORM
+    return esp_cpu_get_cycle_count();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec);
+#endif
+}
+
+static uint32_t gcd(uint32_t a, uint32_t b)
+{
+    while (b != 0) {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// Zeroth order modified Bessel function, for the Kaiser window
+static float bessel_i0(float x)
+{
+    float sum = 1.0f;
+    float term = 1.0f;
+    for (int k = 1; k < 25; k++) {
+        term *= (x / (2.0f * k)) * (x / (2.0f * k));
+        sum += term;
+    }
+    return sum;
+}
+
+// Windowed-sinc lowpass at the upsampled rate, stored phase major
+static void design_filter(converter_t *c)
+{
+    int len = c->up * CONVERTER_TAPS_PER_PHASE;
+    float center = (len - 1) / 2.0f;
+    float cutoff = CUTOFF_FRACTION * 0.5f / (c->up > c->down ? c->up : c->down);
+    float norm = bessel_i0(KAISER_BETA);
+
+    for (int j = 0; j < len; j++) {
+        float t = j - center;
+        float sinc = t == 0.0f ? 2.0f * cutoff : sinf(2.0f * (float)M_PI * cutoff * t) / ((float)M_PI * t);
+        float r = t / center;
+        float window = bessel_i0(KAISER_BETA * sqrtf(fmaxf(0.0f, 1.0f - r * r))) / norm;
+        // Interpolation leaves 1/L of the energy in each phase, scale it back up
+        float h = sinc * window * c->up * 32768.0f;
+        if (h > 32767.0f) {
+            h = 32767.0f;
+        } else if (h < -32768.0f) {
+            h = -32768.0f;
+        }
+        int phase = j % c->up;
+        int tap = j / c->up;
+        c->coeffs[phase * CONVERTER_TAPS_PER_PHASE + tap] = (int16_t)lrintf(h);
+    }
+}
+
+bool converter_init(converter_t *c, uint32_t in_rate, uint32_t out_rate, uint8_t out_bits, uint8_t channels)
+{
+    memset(c, 0, sizeof(*c));
+    if (out_bits != 16 && out_bits != 24 && out_bits != 32) {
+        return false;
+    }
+    if (in_rate == 0 || out_rate == 0 || channels == 0) {
+        return false;
+    }
+
+    c->in_rate = in_rate;
+    c->out_rate = out_rate;
+    c->out_bits = out_bits;
+    c->channels = channels;
+    c->resample = in_rate != out_rate;
+    if (!c->resample) {
+        return true;
+    }
+
+    uint32_t g = gcd(in_rate, out_rate);
+    if (out_rate / g > CONVERTER_MAX_PHASES || in_rate / g > CONVERTER_MAX_PHASES) {
+        return false;
+    }
+    c->up = out_rate / g;
+    c->down = in_rate / g;
+
+    c->coeffs = malloc(c->up * CONVERTER_TAPS_PER_PHASE * sizeof(int16_t));
+    c->history = calloc(CONVERTER_TAPS_PER_PHASE * channels, sizeof(int16_t));
+    if (c->coeffs == NULL || c->history == NULL) {
+        converter_deinit(c);
+        return false;
+    }
+    design_filter(c);
+    return true;
+}
+
+void converter_deinit(converter_t *c)
+{
+    free(c->coeffs);
+    free(c->history);
+    c->coeffs = NULL;
+    c->history = NULL;
+    c->resample = false;
+}
+
+size_t converter_max_output(const converter_t *c, size_t num_frames)
+{
+    size_t frames = num_frames;
+    if (c->resample) {
+        frames = (num_frames * c->up + c->down - 1) / c->down + 1;
+    }
+    return frames * c->channels * (c->out_bits == 24 ? 3 : c->out_bits / 8);
+}
+
+// Write one sample given at 24-bit scale in the output bit depth
+static inline uint8_t *pack_sample(uint8_t *out, int32_t s24, uint8_t bits)
+{
+    if (s24 > 8388607) {
+        s24 = 8388607;
+    } else if (s24 < -8388608) {
+        s24 = -8388608;
+    }
+    switch (bits) {
+    case 16: {
+        // Round to nearest, the clamp above keeps this in range
+        int32_t s16 = (s24 + 128) >> 8;
+        if (s16 > 32767) {
+            s16 = 32767;
+        }
+        out[0] = s16 & 0xFF;
+        out[1] = (s16 >> 8) & 0xFF;
+        return out + 2;
+    }
+    case 24:
+        out[0] = s24 & 0xFF;
+        out[1] = (s24 >> 8) & 0xFF;
+        out[2] = (s24 >> 16) & 0xFF;
+        return out + 3;
+    default: {
+        int32_t s32 = s24 * 256;
+        memcpy(out, &s32, sizeof(s32));
+        return out + 4;
+    }
+    }
+}
+
+size_t converter_process(converter_t *c, const int16_t *in, size_t num_frames, uint8_t *out)
+{
+    uint32_t start = cycle_count();
+    uint8_t *p = out;
+    const int ch = c->channels;
+
+    if (!c->resample) {
+        for (size_t i = 0; i < num_frames * ch; i++) {
+            p = pack_sample(p, (int32_t)in[i] << 8, c->out_bits);
+        }
+    } else {
+        const int taps = CONVERTER_TAPS_PER_PHASE;
+        for (size_t i = 0; i < num_frames; i++) {
+            // Shift the new frame into the history, oldest first
+            memmove(c->history, c->history + ch, (taps - 1) * ch * sizeof(int16_t));
+            memcpy(c->history + (taps - 1) * ch, in + i * ch, ch * sizeof(int16_t));
+
+            // Every output whose upsampled position falls within this input frame
+            while (c->phase < c->up) {
+                const int16_t *h = c->coeffs + c->phase * taps;
+                for (int n = 0; n < ch; n++) {
+                    int64_t acc = 0;
+                    const int16_t *x = c->history + (taps - 1) * ch + n;
+                    for (int k = 0; k < taps; k++) {
+                        acc += (int32_t)h[k] * x[-k * ch];
+                    }
+                    // Q15 taps on 16-bit input, keep 8 extra bits for 24/32-bit output
+                    p = pack_sample(p, (int32_t)(acc >> 7), c->out_bits);
+                }
+                c->phase += c->down;
+            }
+            c->phase -= c->up;
+        }
+    }
+
+    uint32_t cycles = cycle_count() - start;
+    if (cycles > c->max_cycles) {
+        c->max_cycles = cycles;
+    }
+    // Exponential moving average with a 1/16 weight
+    c->avg_cycles += ((int32_t)cycles - (int32_t)c->avg_cycles) / 16;
+    return p - out;
+}
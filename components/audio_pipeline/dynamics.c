@@ -0,0 +1,163 @@
+#include "dynamics.h"
+#include <math.h>
+#include <string.h>
+
+// dB per unit of log2
+#define DB_PER_LOG2 6.0206f
+// Log2 level of digital silence, -96dB
+#define SILENCE_LOG2 (-16 * 65536)
+
+// log2(x / 32768) in Q16 for a sample magnitude, within 0.005 of exact
+static inline int32_t level_log2(int32_t x) {
+    if (x <= 0) {
+        return SILENCE_LOG2;
+    }
+    int n = 31 - __builtin_clz((uint32_t)x);
+    uint32_t f = (((uint32_t)x << (31 - n)) & 0x7FFFFFFF) >> 15;
+    // log2(1 + f) ~ f + 0.3466 f (1 - f)
+    int32_t bend = (int32_t)((((uint64_t)f * (65536 - f)) >> 16) * 22714 >> 16);
+    return (n - 15) * 65536 + (int32_t)f + bend;
+}
+
+// 2^v for a Q16 log2 gain, as a Q16 linear gain within 0.3% of exact
+static inline int32_t gain_exp2(int32_t v) {
+    int32_t i = v >> 16;
+    uint32_t f = (uint32_t)v & 0xFFFF;
+    // 2^f ~ 1 + f (0.6565 + 0.3435 f)
+    uint32_t m = 65536 + (uint32_t)(((uint64_t)f * (43024 + ((f * 22512) >> 16))) >> 16);
+    return i >= 0 ? (int32_t)(m << i) : (int32_t)(m >> -i);
+}
+
+static int32_t db_to_log2(float db) {
+    return (int32_t)lrintf(db / DB_PER_LOG2 * 65536.0f);
+}
+
+// One-pole coefficient in Q15 for a time constant
+static int32_t smoothing(float ms, uint32_t sample_rate) {
+    float frames = ms * sample_rate / 1000.0f;
+    int32_t c = frames < 1.0f ? 32768 : (int32_t)lrintf(32768.0f * (1.0f - expf(-1.0f / frames)));
+    return c < 1 ? 1 : c;
+}
+
+static void reset_state(dynamics_t *d) {
+    d->reduction = 0;
+    d->gain = 0;
+    d->frame = 0;
+    d->pos = 0;
+    memset(d->delay, 0, sizeof(d->delay));
+    memset(d->window, 0, sizeof(d->window));
+    d->window_sum = 0;
+    d->hold_head = 0;
+    d->hold_count = 0;
+}
+
+void dynamics_init(dynamics_t *d) {
+    memset(d, 0, sizeof(*d));
+    d->lookahead = 1;
+}
+
+void dynamics_configure(dynamics_t *d, const dynamics_config_t *config, uint32_t sample_rate) {
+    if (sample_rate == 0) {
+        sample_rate = 48000;
+    }
+    bool was_running = d->compressor || d->limiter;
+    d->compressor = config->compressor;
+    d->limiter = config->limiter;
+    d->threshold = db_to_log2(config->threshold_db);
+    d->slope = config->ratio <= 1.0f ? 0 : (int32_t)lrintf(32768.0f * (1.0f - 1.0f / config->ratio));
+    d->attack = smoothing(config->attack_ms, sample_rate);
+    d->release = smoothing(config->release_ms, sample_rate);
+    d->makeup = d->compressor ? db_to_log2(fminf(fmaxf(config->makeup_db, 0.0f), 18.0f)) : 0;
+    d->ceiling = db_to_log2(fminf(config->ceiling_db, 0.0f));
+    d->limiter_release = d->limiter ? smoothing(DYNAMICS_LIMITER_RELEASE_MS, sample_rate) : 32768;
+
+    int lookahead = (int)lrintf(config->lookahead_ms * sample_rate / 1000.0f);
+    if (lookahead < 1) {
+        lookahead = 1;
+    } else if (lookahead > DYNAMICS_MAX_LOOKAHEAD_FRAMES) {
+        lookahead = DYNAMICS_MAX_LOOKAHEAD_FRAMES;
+    }
+    if (lookahead != d->lookahead || !was_running) {
+        d->lookahead = lookahead;
+        reset_state(d);
+    }
+}
+
+// Lowest gain of the last lookahead + 1 frames, a monotonic queue so each frame costs O(1)
+static inline int32_t hold_min(dynamics_t *d, int32_t gain) {
+    const int cap = DYNAMICS_MAX_LOOKAHEAD_FRAMES + 1;
+    while (d->hold_count > 0 && d->hold_gain[(d->hold_head + d->hold_count - 1) % cap] >= gain) {
+        d->hold_count--;
+    }
+    int tail = (d->hold_head + d->hold_count) % cap;
+    d->hold_gain[tail] = gain;
+    d->hold_frame[tail] = d->frame;
+    d->hold_count++;
+    if (d->frame - d->hold_frame[d->hold_head] > (uint32_t)d->lookahead) {
+        d->hold_head = (d->hold_head + 1) % cap;
+        d->hold_count--;
+    }
+    return d->hold_gain[d->hold_head];
+}
+
+void dynamics_process_s16(dynamics_t *d, int16_t *samples, size_t num_frames) {
+    if (!d->compressor && !d->limiter) {
+        return;
+    }
+    const int lookahead = d->lookahead;
+    for (size_t i = 0; i < num_frames; i++) {
+        int16_t *s = samples + 2 * i;
+        int32_t l = s[0] < 0 ? -s[0] : s[0];
+        int32_t r = s[1] < 0 ? -s[1] : s[1];
+        int32_t level = level_log2(l > r ? l : r);
+
+        // Gain this frame wants, the compressor's smoothed curve capped by the ceiling
+        int32_t want = 0;
+        if (d->compressor) {
+            int32_t over = level - d->threshold;
+            int32_t target = over > 0 ? (int32_t)(((int64_t)over * d->slope) >> 15) : 0;
+            int32_t coeff = target > d->reduction ? d->attack : d->release;
+            d->reduction += (int32_t)(((int64_t)(target - d->reduction) * coeff) >> 15);
+            want = d->makeup - d->reduction;
+        }
+        if (d->limiter && d->ceiling - level < want) {
+            want = d->ceiling - level;
+        }
+
+        // Averaging the held minimum over the window reaches it by the time the
+        // frame that needs it leaves the delay line, never later
+        int32_t held = hold_min(d, want);
+        d->window_sum += held - d->window[d->pos];
+        d->window[d->pos] = held;
+        int32_t ramp = d->window_sum / lookahead;
+        if (ramp < d->gain) {
+            d->gain = ramp;
+        } else {
+            d->gain += (int32_t)(((int64_t)(ramp - d->gain) * d->limiter_release) >> 15);
+        }
+
+        int32_t linear = gain_exp2(d->gain);
+        int16_t *delayed = d->delay[d->pos];
+        for (int ch = 0; ch < 2; ch++) {
+            int32_t out = (int32_t)(((int64_t)delayed[ch] * linear) >> 16);
+            delayed[ch] = s[ch];
+            s[ch] = out > INT16_MAX ? INT16_MAX : (out < INT16_MIN ? INT16_MIN : (int16_t)out);
+        }
+        if (++d->pos == lookahead) {
+            d->pos = 0;
+        }
+        d->frame++;
+
+        int32_t reduction = d->makeup - d->gain;
+        d->reduction_now = reduction > 0 ? reduction : 0;
+        if (d->reduction_now > d->reduction_peak) {
+            d->reduction_peak = d->reduction_now;
+        }
+    }
+}
+
+void dynamics_get_reduction(dynamics_t *d, float *now_db, float *peak_db) {
+    *now_db = d->reduction_now * DB_PER_LOG2 / 65536.0f;
+    *peak_db = d->reduction_peak * DB_PER_LOG2 / 65536.0f;
+    d->reduction_peak = d->reduction_now;
+}
@@ -0,0 +1,268 @@
+#include "eq.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef ESP_PLATFORM
+#include "soc/soc_caps.h"
+#if !SOC_CPU_HAS_FPU
+#define EQ_FIXED_POINT 1
+#else
+#include "dsps_biquad.h"
+#endif
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static const struct {
+    const char *name;
+    eq_band_type_t type;
+} s_band_types[] = {
+    { "peak", EQ_PEAK },
+    { "lowshelf", EQ_LOW_SHELF },
+    { "highshelf", EQ_HIGH_SHELF },
+    { "lowpass", EQ_LOW_PASS },
+    { "highpass", EQ_HIGH_PASS },
+};
+
+static const char *skip_spaces(const char *p) {
+    while (*p == ' ') {
+        p++;
+    }
+    return p;
+}
+
+// Parse one "type freq gain q" band, returns the text after it or NULL
+static const char *parse_band(const char *p, eq_band_t *band) {
+    p = skip_spaces(p);
+    size_t len = 0;
+    while (p[len] >= 'a' && p[len] <= 'z') {
+        len++;
+    }
+    bool known = false;
+    for (size_t i = 0; i < sizeof(s_band_types) / sizeof(s_band_types[0]); i++) {
+        if (strlen(s_band_types[i].name) == len && strncmp(p, s_band_types[i].name, len) == 0) {
+            band->type = s_band_types[i].type;
+            known = true;
+        }
+    }
+    if (!known) {
+        return NULL;
+    }
+    p += len;
+
+    float values[3];
+    for (int i = 0; i < 3; i++) {
+        char *end;
+        values[i] = strtof(p, &end);
+        if (end == p) {
+            return NULL;
+        }
+        p = end;
+    }
+    band->freq_hz = values[0];
+    band->gain_db = values[1];
+    band->q = values[2];
+    if (band->freq_hz < 10.0f || band->freq_hz > 24000.0f
+        || band->gain_db < EQ_MIN_GAIN_DB || band->gain_db > EQ_MAX_GAIN_DB
+        || band->q < 0.1f || band->q > 20.0f) {
+        return NULL;
+    }
+    return skip_spaces(p);
+}
+
+int eq_parse_bands(const char *text, eq_band_t *bands, int max) {
+    const char *p = skip_spaces(text);
+    int count = 0;
+    while (*p != '\0') {
+        if (count == max) {
+            return -1;
+        }
+        p = parse_band(p, &bands[count]);
+        if (p == NULL) {
+            return -1;
+        }
+        count++;
+        if (*p == ';') {
+            p++;
+        } else if (*p != '\0') {
+            return -1;
+        }
+    }
+    return count;
+}
+
+// RBJ audio EQ cookbook biquad, normalised by a0
+static void design_band(const eq_band_t *band, uint32_t sample_rate, float c[5]) {
+    double a = pow(10.0, band->gain_db / 40.0);
+    double w0 = 2.0 * M_PI * band->freq_hz / sample_rate;
+    double cosw = cos(w0);
+    double alpha = sin(w0) / (2.0 * band->q);
+    double sqa = 2.0 * sqrt(a) * alpha;
+    double b0, b1, b2, a0, a1, a2;
+
+    switch (band->type) {
+    case EQ_LOW_SHELF:
+        b0 = a * ((a + 1) - (a - 1) * cosw + sqa);
+        b1 = 2 * a * ((a - 1) - (a + 1) * cosw);
+        b2 = a * ((a + 1) - (a - 1) * cosw - sqa);
+        a0 = (a + 1) + (a - 1) * cosw + sqa;
+        a1 = -2 * ((a - 1) + (a + 1) * cosw);
+        a2 = (a + 1) + (a - 1) * cosw - sqa;
+        break;
+    case EQ_HIGH_SHELF:
+        b0 = a * ((a + 1) + (a - 1) * cosw + sqa);
+        b1 = -2 * a * ((a - 1) + (a + 1) * cosw);
+        b2 = a * ((a + 1) + (a - 1) * cosw - sqa);
+        a0 = (a + 1) - (a - 1) * cosw + sqa;
+        a1 = 2 * ((a - 1) - (a + 1) * cosw);
+        a2 = (a + 1) - (a - 1) * cosw - sqa;
+        break;
+    case EQ_LOW_PASS:
+        b0 = (1 - cosw) / 2;
+        b1 = 1 - cosw;
+        b2 = (1 - cosw) / 2;
+        a0 = 1 + alpha;
+        a1 = -2 * cosw;
+        a2 = 1 - alpha;
+        break;
+    case EQ_HIGH_PASS:
+        b0 = (1 + cosw) / 2;
+        b1 = -(1 + cosw);
+        b2 = (1 + cosw) / 2;
+        a0 = 1 + alpha;
+        a1 = -2 * cosw;
+        a2 = 1 - alpha;
+        break;
+    case EQ_PEAK:
+    default:
+        b0 = 1 + alpha * a;
+        b1 = -2 * cosw;
+        b2 = 1 - alpha * a;
+        a0 = 1 + alpha / a;
+        a1 = -2 * cosw;
+        a2 = 1 - alpha / a;
+        break;
+    }
+    c[0] = (float)(b0 / a0);
+    c[1] = (float)(b1 / a0);
+    c[2] = (float)(b2 / a0);
+    c[3] = (float)(a1 / a0);
+    c[4] = (float)(a2 / a0);
+}
+
+void eq_design(const eq_band_t *bands, int count, uint32_t sample_rate, eq_coeffs_t *out) {
+    memset(out, 0, sizeof(*out));
+    if (sample_rate == 0) {
+        return;
+    }
+    for (int i = 0; i < count && out->count < EQ_MAX_BANDS; i++) {
+        if (bands[i].freq_hz >= sample_rate / 2.0f) {
+            continue;
+        }
+        float *c = out->coeffs[out->count];
+        design_band(&bands[i], sample_rate, c);
+        for (int k = 0; k < 5; k++) {
+            out->coeffs_q[out->count][k] = (int32_t)lrint((double)c[k] * (1 << EQ_COEFF_FRAC_BITS));
+        }
+        out->count++;
+    }
+}
+
+void eq_init(eq_t *eq) {
+    memset(eq, 0, sizeof(*eq));
+}
+
+void eq_set_coeffs(eq_t *eq, const eq_coeffs_t *coeffs) {
+    for (int band = eq->coeffs.count; band < coeffs->count; band++) {
+        for (int ch = 0; ch < 2; ch++) {
+            memset(eq->w[ch][band], 0, sizeof(eq->w[ch][band]));
+            memset(eq->z[ch][band], 0, sizeof(eq->z[ch][band]));
+        }
+    }
+    eq->coeffs = *coeffs;
+}
+
+static inline int16_t saturate_s16(int32_t v) {
+    if (v > INT16_MAX) {
+        return INT16_MAX;
+    }
+    if (v < INT16_MIN) {
+        return INT16_MIN;
+    }
+    return (int16_t)v;
+}
+
+#ifdef EQ_FIXED_POINT
+
+// Extra fraction bits the signal carries between bands to keep rounding noise down
+#define EQ_SIGNAL_FRAC_BITS 8
+
+// Direct form I, 32x32 into a 64-bit accumulator
+void eq_process_s16(eq_t *eq, int16_t *samples, size_t num_frames) {
+    const int count = eq->coeffs.count;
+    if (count == 0) {
+        return;
+    }
+    for (size_t i = 0; i < num_frames * 2; i++) {
+        int32_t (*z)[4] = eq->z[i & 1];
+        int32_t x = (int32_t)samples[i] << EQ_SIGNAL_FRAC_BITS;
+        for (int band = 0; band < count; band++) {
+            const int32_t *c = eq->coeffs.coeffs_q[band];
+            int32_t *s = z[band];
+            int64_t acc = (int64_t)c[0] * x + (int64_t)c[1] * s[0] + (int64_t)c[2] * s[1]
+                        - (int64_t)c[3] * s[2] - (int64_t)c[4] * s[3];
+            int32_t y = (int32_t)((acc + (1 << (EQ_COEFF_FRAC_BITS - 1))) >> EQ_COEFF_FRAC_BITS);
+            s[1] = s[0];
+            s[0] = x;
+            s[3] = s[2];
+            s[2] = y;
+            x = y;
+        }
+        samples[i] = saturate_s16((x + (1 << (EQ_SIGNAL_FRAC_BITS - 1))) >> EQ_SIGNAL_FRAC_BITS);
+    }
+}
+
+#else
+
+#ifndef ESP_PLATFORM
+// Same direct form II as the esp-dsp reference implementation, in place
+static void dsps_biquad_f32(const float *input, float *output, int len, const float *coef, float *w) {
+    for (int i = 0; i < len; i++) {
+        float d0 = input[i] - coef[3] * w[0] - coef[4] * w[1];
+        output[i] = coef[0] * d0 + coef[1] * w[0] + coef[2] * w[1];
+        w[1] = w[0];
+        w[0] = d0;
+    }
+}
+#endif
+
+// Split a block into planar channels, run every band over each with esp-dsp and interleave back
+void eq_process_s16(eq_t *eq, int16_t *samples, size_t num_frames) {
+    const int count = eq->coeffs.count;
+    if (count == 0) {
+        return;
+    }
+    float planar[2][EQ_BLOCK_FRAMES];
+    while (num_frames > 0) {
+        int n = num_frames < EQ_BLOCK_FRAMES ? (int)num_frames : EQ_BLOCK_FRAMES;
+        for (int i = 0; i < n; i++) {
+            planar[0][i] = samples[2 * i];
+            planar[1][i] = samples[2 * i + 1];
+        }
+        for (int ch = 0; ch < 2; ch++) {
+            for (int band = 0; band < count; band++) {
+                dsps_biquad_f32(planar[ch], planar[ch], n, eq->coeffs.coeffs[band], eq->w[ch][band]);
+            }
+        }
+        for (int i = 0; i < n; i++) {
+            samples[2 * i] = saturate_s16((int32_t)lrintf(planar[0][i]));
+            samples[2 * i + 1] = saturate_s16((int32_t)lrintf(planar[1][i]));
+        }
+        samples += 2 * n;
+        num_frames -= n;
+    }
+}
+
+#endif
@@ -0,0 +1,75 @@
+#include "fft.h"
+#include <math.h>
+#ifdef ESP_PLATFORM
+#include "dsps_fft2r.h"
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#ifdef ESP_PLATFORM
+
+// esp-dsp keeps one table in bit reversed order, every shorter FFT uses its start
+bool fft_init(void) {
+    esp_err_t err = dsps_fft2r_init_fc32(NULL, FFT_MAX_SIZE);
+    return err == ESP_OK || err == ESP_ERR_DSP_REINITIALIZED;
+}
+
+void fft_forward(float *data, int n) {
+    dsps_fft2r_fc32(data, n);
+    dsps_bit_rev_fc32(data, n);
+}
+
+#else
+
+// Twiddles of the host FFT, cos and -sin of 2*pi*k/N for k < N/2
+static float s_twiddle[FFT_MAX_SIZE];
+static bool s_ready = false;
+
+bool fft_init(void) {
+    if (!s_ready) {
+        for (int k = 0; k < FFT_MAX_SIZE / 2; k++) {
+            s_twiddle[2 * k] = (float)cos(2.0 * M_PI * k / FFT_MAX_SIZE);
+            s_twiddle[2 * k + 1] = (float)-sin(2.0 * M_PI * k / FFT_MAX_SIZE);
+        }
+        s_ready = true;
+    }
+    return true;
+}
+
+// Same result as esp-dsp's dsps_fft2r_fc32() followed by dsps_bit_rev_fc32()
+void fft_forward(float *data, int n) {
+    for (int i = 1, j = 0; i < n; i++) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            float re = data[2 * i], im = data[2 * i + 1];
+            data[2 * i] = data[2 * j];
+            data[2 * i + 1] = data[2 * j + 1];
+            data[2 * j] = re;
+            data[2 * j + 1] = im;
+        }
+    }
+    for (int len = 2; len <= n; len <<= 1) {
+        int step = FFT_MAX_SIZE / len;
+        for (int i = 0; i < n; i += len) {
+            for (int k = 0; k < len / 2; k++) {
+                float wr = s_twiddle[2 * k * step], wi = s_twiddle[2 * k * step + 1];
+                float *a = &data[2 * (i + k)];
+                float *b = &data[2 * (i + k + len / 2)];
+                float tr = b[0] * wr - b[1] * wi;
+                float ti = b[0] * wi + b[1] * wr;
+                b[0] = a[0] - tr;
+                b[1] = a[1] - ti;
+                a[0] += tr;
+                a[1] += ti;
+            }
+        }
+    }
+}
+
+#endif
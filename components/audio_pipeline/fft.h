@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdbool.h>
+
+// Longest FFT the blocks of this component run
+#define FFT_MAX_SIZE 1024
+
+/**
+ * Set up the twiddle table once for every size up to FFT_MAX_SIZE
+ */
+bool fft_init(void);
+
+/**
+ * Complex radix-2 FFT in place with the output in natural order
+ *
+ * @param data n interleaved re, im pairs, 16-byte aligned
+ * @param n Power of two up to FFT_MAX_SIZE
+ */
+void fft_forward(float *data, int n);
@@ -0,0 +1,314 @@
+#include "fir.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef ESP_PLATFORM
+#include "esp_heap_caps.h"
+#endif
+#include "fft.h"
+
+// Floats in the half spectrum of one channel, bins 0..N/2 as re, im
+#define BIN_FLOATS ((FIR_PARTITION_FRAMES + 1) * 2)
+
+#ifdef ESP_PLATFORM
+
+// Spectra are large, prefer PSRAM and leave internal RAM to Wi-Fi and the buffers
+static void *alloc_spectra(size_t bytes) {
+    void *p = heap_caps_aligned_alloc(16, bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (p == NULL) {
+        p = heap_caps_aligned_alloc(16, bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    return p;
+}
+
+static void *alloc_state(size_t bytes) {
+    return heap_caps_aligned_alloc(16, bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+}
+
+static void free_aligned(void *p) {
+    heap_caps_free(p);
+}
+
+#else
+
+static void *alloc_spectra(size_t bytes) {
+    return aligned_alloc(16, (bytes + 15) & ~(size_t)15);
+}
+
+static void *alloc_state(size_t bytes) {
+    return aligned_alloc(16, (bytes + 15) & ~(size_t)15);
+}
+
+static void free_aligned(void *p) {
+    free(p);
+}
+
+#endif
+
+// Split the spectrum of left + j*right into the half spectra of each channel
+static void unpack(const float *x, float *left, float *right) {
+    for (int k = 0; k <= FIR_PARTITION_FRAMES; k++) {
+        int m = (FIR_FFT_SIZE - k) % FIR_FFT_SIZE;
+        float a = x[2 * k], b = x[2 * k + 1];
+        float c = x[2 * m], d = x[2 * m + 1];
+        left[2 * k] = (a + c) * 0.5f;
+        left[2 * k + 1] = (b - d) * 0.5f;
+        right[2 * k] = (b + d) * 0.5f;
+        right[2 * k + 1] = (c - a) * 0.5f;
+    }
+}
+
+static int partitions_for(size_t taps) {
+    return (int)((taps + FIR_PARTITION_FRAMES - 1) / FIR_PARTITION_FRAMES);
+}
+
+size_t fir_memory_bytes(size_t taps, bool stereo) {
+    size_t partitions = partitions_for(taps);
+    return partitions * (stereo ? 4 : 3) * BIN_FLOATS * sizeof(float);
+}
+
+fir_conv_t *fir_create(size_t taps, bool stereo) {
+    if (taps == 0 || taps > FIR_MAX_TAPS || !fft_init()) {
+        return NULL;
+    }
+    fir_conv_t *fir = alloc_state(sizeof(fir_conv_t));
+    if (fir == NULL) {
+        return NULL;
+    }
+    memset(fir, 0, sizeof(*fir));
+    fir->taps = taps;
+    fir->partitions = partitions_for(taps);
+    fir->stereo = stereo;
+    size_t ir_bytes = (size_t)fir->partitions * (stereo ? 2 : 1) * BIN_FLOATS * sizeof(float);
+    size_t fdl_bytes = (size_t)fir->partitions * 2 * BIN_FLOATS * sizeof(float);
+    fir->ir = alloc_spectra(ir_bytes);
+    fir->fdl = alloc_spectra(fdl_bytes);
+    if (fir->ir == NULL || fir->fdl == NULL) {
+        fir_destroy(fir);
+        return NULL;
+    }
+    memset(fir->ir, 0, ir_bytes);
+    memset(fir->fdl, 0, fdl_bytes);
+    return fir;
+}
+
+void fir_destroy(fir_conv_t *fir) {
+    if (fir == NULL) {
+        return;
+    }
+    free_aligned(fir->ir);
+    free_aligned(fir->fdl);
+    free_aligned(fir);
+}
+
+void fir_set_partition(fir_conv_t *fir, int index, const float *left, const float *right, size_t count) {
+    if (index < 0 || index >= fir->partitions || count > FIR_PARTITION_FRAMES) {
+        return;
+    }
+    memset(fir->fft, 0, sizeof(fir->fft));
+    for (size_t n = 0; n < count; n++) {
+        fir->fft[2 * n] = left[n];
+        fir->fft[2 * n + 1] = fir->stereo ? right[n] : 0.0f;
+    }
+    fft_forward(fir->fft, FIR_FFT_SIZE);
+    float *h = fir->ir + (size_t)index * (fir->stereo ? 2 : 1) * BIN_FLOATS;
+    // A mono response only keeps the left half spectrum, the right one is all zero
+    unpack(fir->fft, h, fir->stereo ? h + BIN_FLOATS : fir->acc[1]);
+}
+
+// Accumulate the product of two half spectra
+static inline void complex_mac(float *acc, const float *x, const float *h) {
+    for (int k = 0; k < BIN_FLOATS; k += 2) {
+        acc[k] += x[k] * h[k] - x[k + 1] * h[k + 1];
+        acc[k + 1] += x[k] * h[k + 1] + x[k + 1] * h[k];
+    }
+}
+
+static inline int16_t saturate_s16(float v) {
+    if (v >= 32767.0f) {
+        return INT16_MAX;
+    }
+    if (v <= -32768.0f) {
+        return INT16_MIN;
+    }
+    return (int16_t)lrintf(v);
+}
+
+// Filter one full partition of input, overlap-save
+static void run_partition(fir_conv_t *fir) {
+    const int p_count = fir->partitions;
+
+    // One FFT of both channels, then keep each channel's half spectrum in the delay line
+    for (int n = 0; n < FIR_FFT_SIZE; n++) {
+        fir->fft[2 * n] = fir->input[0][n];
+        fir->fft[2 * n + 1] = fir->input[1][n];
+    }
+    fft_forward(fir->fft, FIR_FFT_SIZE);
+    float *newest = fir->fdl + (size_t)fir->fdl_head * 2 * BIN_FLOATS;
+    unpack(fir->fft, newest, newest + BIN_FLOATS);
+
+    memset(fir->acc, 0, sizeof(fir->acc));
+    for (int p = 0; p < p_count; p++) {
+        int slot = fir->fdl_head - p;
+        if (slot < 0) {
+            slot += p_count;
+        }
+        const float *x = fir->fdl + (size_t)slot * 2 * BIN_FLOATS;
+        const float *h = fir->ir + (size_t)p * (fir->stereo ? 2 : 1) * BIN_FLOATS;
+        complex_mac(fir->acc[0], x, h);
+        complex_mac(fir->acc[1], x + BIN_FLOATS, fir->stereo ? h + BIN_FLOATS : h);
+    }
+
+    // Pack the two output spectra as left + j*right and invert with the forward
+    // FFT of the conjugate, the conjugate of the result is the output
+    const float *yl = fir->acc[0], *yr = fir->acc[1];
+    for (int k = 0; k <= FIR_PARTITION_FRAMES; k++) {
+        fir->fft[2 * k] = yl[2 * k] - yr[2 * k + 1];
+        fir->fft[2 * k + 1] = -(yl[2 * k + 1] + yr[2 * k]);
+    }
+    for (int k = FIR_PARTITION_FRAMES + 1; k < FIR_FFT_SIZE; k++) {
+        int m = FIR_FFT_SIZE - k;
+        fir->fft[2 * k] = yl[2 * m] + yr[2 * m + 1];
+        fir->fft[2 * k + 1] = -(yr[2 * m] - yl[2 * m + 1]);
+    }
+    fft_forward(fir->fft, FIR_FFT_SIZE);
+
+    // The second half of the circular convolution is free of wrap-around
+    const float scale = 1.0f / FIR_FFT_SIZE;
+    for (int n = 0; n < FIR_PARTITION_FRAMES; n++) {
+        const float *z = &fir->fft[2 * (n + FIR_PARTITION_FRAMES)];
+        fir->output[2 * n] = saturate_s16(z[0] * scale);
+        fir->output[2 * n + 1] = saturate_s16(-z[1] * scale);
+    }
+
+    for (int ch = 0; ch < 2; ch++) {
+        memcpy(fir->input[ch], fir->input[ch] + FIR_PARTITION_FRAMES, FIR_PARTITION_FRAMES * sizeof(float));
+    }
+    fir->fdl_head = (fir->fdl_head + 1) % p_count;
+}
+
+void fir_process_s16(fir_conv_t *fir, int16_t *samples, size_t num_frames) {
+    for (size_t i = 0; i < num_frames; i++) {
+        fir->input[0][FIR_PARTITION_FRAMES + fir->pos] = samples[2 * i];
+        fir->input[1][FIR_PARTITION_FRAMES + fir->pos] = samples[2 * i + 1];
+        samples[2 * i] = fir->output[2 * fir->pos];
+        samples[2 * i + 1] = fir->output[2 * fir->pos + 1];
+        if (++fir->pos == FIR_PARTITION_FRAMES) {
+            run_partition(fir);
+            fir->pos = 0;
+        }
+    }
+}
+
+static uint32_t read_le(const uint8_t *p, int bytes) {
+    uint32_t v = 0;
+    for (int i = bytes - 1; i >= 0; i--) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+bool fir_read_wav_info(FILE *file, fir_wav_info_t *info) {
+    uint8_t header[12];
+    if (fseek(file, 0, SEEK_SET) != 0 || fread(header, 1, sizeof(header), file) != sizeof(header)
+        || memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+    memset(info, 0, sizeof(*info));
+    bool have_format = false;
+    uint8_t chunk[8];
+    while (fread(chunk, 1, sizeof(chunk), file) == sizeof(chunk)) {
+        uint32_t size = read_le(chunk + 4, 4);
+        if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+            uint8_t fmt[16];
+            if (fread(fmt, 1, sizeof(fmt), file) != sizeof(fmt)) {
+                return false;
+            }
+            uint16_t tag = read_le(fmt, 2);
+            info->channels = read_le(fmt + 2, 2);
+            info->sample_rate = read_le(fmt + 4, 4);
+            info->bits = read_le(fmt + 14, 2);
+            if (tag == 0xFFFE && size >= 26) {
+                // WAVE_FORMAT_EXTENSIBLE, the sub format GUID starts with the real tag
+                uint8_t ext[10];
+                if (fread(ext, 1, sizeof(ext), file) != sizeof(ext)) {
+                    return false;
+                }
+                tag = read_le(ext + 8, 2);
+                size -= sizeof(ext);
+            }
+            info->is_float = tag == 3;
+            if ((tag != 1 && tag != 3) || info->channels < 1 || info->channels > 2
+                || (info->bits != 16 && info->bits != 24 && info->bits != 32)
+                || (info->is_float && info->bits != 32)) {
+                return false;
+            }
+            have_format = true;
+            size -= 16;
+        } else if (memcmp(chunk, "data", 4) == 0 && have_format) {
+            info->data_offset = ftell(file);
+            info->taps = size / (info->channels * info->bits / 8);
+            return info->taps > 0;
+        }
+        // Chunks are padded to an even size
+        if (fseek(file, size + (size & 1), SEEK_CUR) != 0) {
+            return false;
+        }
+    }
+    return false;
+}
+
+static float sample_to_float(const uint8_t *p, const fir_wav_info_t *info) {
+    if (info->is_float) {
+        float v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    switch (info->bits) {
+    case 16:
+        return (int16_t)read_le(p, 2) / 32768.0f;
+    case 24:
+        return (int32_t)(read_le(p, 3) << 8) / 2147483648.0f;
+    default:
+        return (int32_t)read_le(p, 4) / 2147483648.0f;
+    }
+}
+
+fir_conv_t *fir_load_wav(FILE *file, const fir_wav_info_t *info) {
+    if (info->taps > FIR_MAX_TAPS || fseek(file, info->data_offset, SEEK_SET) != 0) {
+        return NULL;
+    }
+    bool stereo = info->channels == 2;
+    fir_conv_t *fir = fir_create(info->taps, stereo);
+    if (fir == NULL) {
+        return NULL;
+    }
+
+    // One partition of raw frames at a time, then the same as float per channel
+    const size_t frame_bytes = info->channels * info->bits / 8;
+    uint8_t *raw = malloc(FIR_PARTITION_FRAMES * frame_bytes);
+    float *taps = malloc(FIR_PARTITION_FRAMES * 2 * sizeof(float));
+    bool ok = raw != NULL && taps != NULL;
+    size_t left = info->taps;
+    for (int index = 0; ok && left > 0; index++) {
+        size_t count = left < FIR_PARTITION_FRAMES ? left : FIR_PARTITION_FRAMES;
+        if (fread(raw, frame_bytes, count, file) != count) {
+            ok = false;
+            break;
+        }
+        for (size_t n = 0; n < count; n++) {
+            const uint8_t *frame = raw + n * frame_bytes;
+            taps[n] = sample_to_float(frame, info);
+            taps[FIR_PARTITION_FRAMES + n] = stereo ? sample_to_float(frame + info->bits / 8, info) : 0.0f;
+        }
+        fir_set_partition(fir, index, taps, taps + FIR_PARTITION_FRAMES, count);
+        left -= count;
+    }
+    free(raw);
+    free(taps);
+    if (!ok) {
+        fir_destroy(fir);
+        return NULL;
+    }
+    return fir;
+}
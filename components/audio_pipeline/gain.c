@@ -0,0 +1,104 @@
+#include "gain.h"
+#include <stdint.h>
+#include <assert.h>
+#ifdef ESP_PLATFORM
+#include "dsps_mulc.h"
+#endif
+
+static int32_t gain_to_q15(float gain)
+{
+    if (gain <= 0.0f) {
+        return 0;
+    }
+    if (gain >= 1.0f) {
+        return GAIN_Q15_UNITY;
+    }
+    return (int32_t)(gain * GAIN_Q15_UNITY + 0.5f);
+}
+
+void gain_init(gain_stage_t *g, float gain, gain_ramp_type_t ramp_type)
+{
+    g->target_q15 = gain_to_q15(gain);
+    g->current_q15 = g->target_q15;
+    g->ramp_from_q15 = g->target_q15;
+    g->step_q15 = 0;
+    g->ramp_type = ramp_type;
+}
+
+void gain_set_target(gain_stage_t *g, float gain)
+{
+    g->target_q15 = gain_to_q15(gain);
+}
+
+// Per-frame gain ramp, runs only while current != target
+static size_t gain_ramp_s16(gain_stage_t *g, int32_t target, int16_t *samples, size_t num_frames, int channels)
+{
+    if (g->ramp_type == GAIN_RAMP_LINEAR && g->ramp_from_q15 != target) {
+        // New target, spread the difference over the ramp length
+        g->step_q15 = (target - g->current_q15) / GAIN_RAMP_FRAMES;
+        if (g->step_q15 == 0) {
+            g->step_q15 = target > g->current_q15 ? 1 : -1;
+        }
+        g->ramp_from_q15 = target;
+    }
+
+    size_t frame = 0;
+    int32_t current = g->current_q15;
+    while (frame < num_frames && current != target) {
+        int32_t step;
+        if (g->ramp_type == GAIN_RAMP_LINEAR) {
+            step = g->step_q15;
+        } else {
+            step = (target - current) >> GAIN_EXP_SHIFT;
+            if (step == 0) {
+                step = target > current ? 1 : -1;
+            }
+        }
+        current += step;
+        // Don't overshoot the target
+        if ((step > 0 && current > target) || (step < 0 && current < target)) {
+            current = target;
+        }
+
+        int16_t *s = samples + frame * channels;
+        for (int ch = 0; ch < channels; ch++) {
+            s[ch] = (int16_t)((s[ch] * current) >> 15);
+        }
+        frame++;
+    }
+    g->current_q15 = current;
+    return frame;
+}
+
+void gain_process_s16(gain_stage_t *g, int16_t *samples, size_t num_frames, int channels)
+{
+    // An odd address, e.g. right after the 5 byte Scream header, faults on
+    // the first 16-bit load, callers offset their buffers to avoid it
+    assert(((uintptr_t)samples & 1) == 0);
+    int32_t target = g->target_q15;
+    size_t done = 0;
+
+    if (g->current_q15 != target) {
+        done = gain_ramp_s16(g, target, samples, num_frames, channels);
+    }
+    if (done >= num_frames || target == GAIN_Q15_UNITY) {
+        return;
+    }
+
+    // Steady state, vectorised constant multiply: out = (in * C) >> 15
+    int len = (int)((num_frames - done) * channels);
+    int16_t *s = samples + done * channels;
+    // The vector multiply loads word pairs, peel one sample to get there
+    if (((uintptr_t)s & 3) != 0 && len > 0) {
+        *s = (int16_t)((*s * target) >> 15);
+        s++;
+        len--;
+    }
+#ifdef ESP_PLATFORM
+    dsps_mulc_s16(s, s, len, (int16_t)target, 1, 1);
+#else
+    for (int i = 0; i < len; i++) {
+        s[i] = (int16_t)((s[i] * target) >> 15);
+    }
+#endif
+}
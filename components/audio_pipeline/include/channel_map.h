@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Scream header byte size, part of the protocol
+#define SCREAM_HEADER_SIZE 5
+// Most channels a stream may carry, 7.1
+#define SCREAM_MAX_CHANNELS 8
+// Q14 unity for downmix gains
+#define CHANNEL_MAP_Q14_UNITY 16384
+
+// Speaker positions of the Scream channel mask, same bits as WAVEFORMATEXTENSIBLE
+#define SPEAKER_FRONT_LEFT            0x001
+#define SPEAKER_FRONT_RIGHT           0x002
+#define SPEAKER_FRONT_CENTER          0x004
+#define SPEAKER_LOW_FREQUENCY         0x008
+#define SPEAKER_BACK_LEFT             0x010
+#define SPEAKER_BACK_RIGHT            0x020
+#define SPEAKER_FRONT_LEFT_OF_CENTER  0x040
+#define SPEAKER_FRONT_RIGHT_OF_CENTER 0x080
+#define SPEAKER_BACK_CENTER           0x100
+#define SPEAKER_SIDE_LEFT             0x200
+#define SPEAKER_SIDE_RIGHT            0x400
+
+/**
+ * Format a Scream packet header describes
+ */
+typedef struct {
+    uint32_t sample_rate;
+    uint8_t bit_depth;              // 16, 24 or 32
+    uint8_t channels;
+    uint16_t channel_mask;          // SPEAKER_* bits of the channels in stream order, 0 if unknown
+} scream_format_t;
+
+typedef enum {
+    CHANNEL_MAP_PAIR,               // Two adjacent channels as left and right
+    CHANNEL_MAP_MONO,               // One channel on both sides, for a mono speaker
+    CHANNEL_MAP_DOWNMIX,            // Every channel mixed to stereo through a matrix
+} channel_map_mode_t;
+
+/**
+ * Selects the 16-bit stereo a receiver plays out of a multichannel stream.
+ * Samples wider than 16 bits are truncated to their top 16 bits.
+ */
+typedef struct {
+    channel_map_mode_t mode;
+    uint8_t channel;                // First channel of the pair, or the mono channel
+    int16_t matrix[2][SCREAM_MAX_CHANNELS]; // Q14 gain of each stream channel into left and right
+} channel_map_t;
+
+/**
+ * Decode a Scream header
+ *
+ * @return False if the header describes a format the receiver can't play
+ */
+bool scream_parse_header(const uint8_t *header, scream_format_t *format);
+
+/**
+ * Fill a downmix matrix for the channel layout, front channels at full gain and
+ * center and surrounds at -3dB, scaled down so a full scale stream can't clip
+ */
+void channel_map_default_matrix(const scream_format_t *format, int16_t matrix[2][SCREAM_MAX_CHANNELS]);
+
+/**
+ * Parse a downmix matrix written as two rows of gains in stream channel order,
+ * rows separated by ';' and gains by ',' ("1,0,0.7,0,0.7,0;0,1,0.7,0,0,0.7").
+ * Channels a row leaves out get no gain.
+ *
+ * @return False if the text isn't a valid matrix, or a row's gains add up to 4
+ *         or more, where a full scale mix would overflow
+ */
+bool channel_map_parse_matrix(const char *text, int16_t matrix[2][SCREAM_MAX_CHANNELS]);
+
+/**
+ * Whether the map passes 16-bit stereo through untouched
+ */
+bool channel_map_is_identity(const channel_map_t *map, const scream_format_t *format);
+
+/**
+ * Extract stereo frames from interleaved stream frames
+ *
+ * @param in Whole stream frames, 4-byte aligned input takes the word copy path
+ * @param num_frames Number of frames in and out
+ * @param out Receives num_frames 16-bit stereo frames
+ */
+void channel_map_process(const channel_map_t *map, const scream_format_t *format,
+                         const uint8_t *in, size_t num_frames, int16_t *out);
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Taps per polyphase branch of the resampling filter
+#define CONVERTER_TAPS_PER_PHASE 24
+// Largest interpolation factor supported, 44.1KHz -> 96KHz needs 320
+#define CONVERTER_MAX_PHASES 320
+
+/**
+ * Converts interleaved 16-bit PCM to another sample rate and bit depth.
+ * Rate changes use a fixed-ratio polyphase windowed-sinc filter, the ratio is
+ * the reduced fraction of the two rates (48->96 is 2/1, 44.1->48 is 160/147).
+ * Output is 16-bit, packed 24-bit or 32-bit little endian PCM.
+ * One instance per stream, only the audio task may call converter_process().
+ */
+typedef struct {
+    uint32_t in_rate;
+    uint32_t out_rate;
+    uint8_t out_bits;
+    uint8_t channels;
+    bool resample;                  // False when only the bit depth changes
+    uint16_t up;                    // Interpolation factor L
+    uint16_t down;                  // Decimation factor M
+    uint16_t phase;                 // Position within the current input frame, 0..L-1
+    int16_t *coeffs;                // L phases of CONVERTER_TAPS_PER_PHASE Q15 taps, phase major
+    int16_t *history;               // Last CONVERTER_TAPS_PER_PHASE input frames, newest last
+    uint32_t max_cycles;            // Worst converter_process() cost, CPU cycles on the device and ns on a host build
+    uint32_t avg_cycles;            // Moving average converter_process() cost, same units
+} converter_t;
+
+/**
+ * Set up a converter, allocating the filter for rate changes
+ *
+ * @param in_rate Sample rate of the 16-bit input
+ * @param out_rate Sample rate to produce
+ * @param out_bits Bit depth to produce, 16, 24 or 32
+ * @param channels Number of interleaved channels
+ * @return False for a ratio or depth that can't be converted, or if the filter
+ *         couldn't be allocated
+ */
+bool converter_init(converter_t *c, uint32_t in_rate, uint32_t out_rate, uint8_t out_bits, uint8_t channels);
+
+/**
+ * Free the filter of a converter, safe to call on a converter that was never set up
+ */
+void converter_deinit(converter_t *c);
+
+/**
+ * Bytes converter_process() produces at most for a given number of input frames
+ */
+size_t converter_max_output(const converter_t *c, size_t num_frames);
+
+/**
+ * Convert a block of input
+ *
+ * @param in Interleaved 16-bit input
+ * @param num_frames Number of input frames
+ * @param out Receives the converted PCM, at least converter_max_output() bytes
+ * @return Number of bytes written to out
+ */
+size_t converter_process(converter_t *c, const int16_t *in, size_t num_frames, uint8_t *out);
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Longest look-ahead, 5.3ms at 48KHz, longer settings are clamped to it
+#define DYNAMICS_MAX_LOOKAHEAD_FRAMES 256
+// Release of the limiter after a peak has passed
+#define DYNAMICS_LIMITER_RELEASE_MS 50
+
+typedef struct {
+    bool compressor;
+    float threshold_db;             // Level in dBFS above which the compressor reduces gain
+    float ratio;                    // Input dB over threshold per output dB, 1 is no compression
+    float attack_ms;
+    float release_ms;
+    float makeup_db;                // Gain added after compression, up to +18dB
+    bool limiter;
+    float ceiling_db;               // Peak level in dBFS the limiter never lets through
+    float lookahead_ms;             // Delay that lets gain come down before a peak arrives
+} dynamics_config_t;
+
+/**
+ * Feed-forward compressor followed by a look-ahead peak limiter on
+ * interleaved 16-bit stereo, both channels linked. Gains are worked out in
+ * the log2 domain in Q16 fixed point: the compressor's gain is smoothed with
+ * its attack and release, then the lowest gain any frame in the look-ahead
+ * window needs is held and averaged over the window, so gain ramps down
+ * before a peak reaches the output instead of clipping it.
+ */
+typedef struct {
+    // Parameters, Q16 log2 levels and Q15 smoothing coefficients
+    bool compressor;
+    bool limiter;
+    int32_t threshold;
+    int32_t slope;                  // 1 - 1/ratio in Q15
+    int32_t attack;
+    int32_t release;
+    int32_t makeup;
+    int32_t ceiling;
+    int32_t limiter_release;
+    int lookahead;                  // Frames the audio is delayed by
+
+    // State
+    int32_t reduction;              // Smoothed compressor gain reduction
+    int32_t gain;                   // Log2 gain applied to the delayed frame
+    uint32_t frame;                 // Frames processed, wraps
+    int pos;                        // Slot of the delay line and window ring
+    int16_t delay[DYNAMICS_MAX_LOOKAHEAD_FRAMES][2];
+    int32_t window[DYNAMICS_MAX_LOOKAHEAD_FRAMES];   // Held gains being averaged
+    int32_t window_sum;
+    int32_t hold_gain[DYNAMICS_MAX_LOOKAHEAD_FRAMES + 1];  // Ascending run of window minima
+    uint32_t hold_frame[DYNAMICS_MAX_LOOKAHEAD_FRAMES + 1];
+    int hold_head;
+    int hold_count;
+
+    // Gain reduction below the makeup gain, for metering
+    int32_t reduction_now;
+    int32_t reduction_peak;
+} dynamics_t;
+
+/**
+ * Start with both the compressor and the limiter off
+ */
+void dynamics_init(dynamics_t *d);
+
+/**
+ * Apply new settings from the next block on, changing the look-ahead empties the delay line
+ */
+void dynamics_configure(dynamics_t *d, const dynamics_config_t *config, uint32_t sample_rate);
+
+/**
+ * Process interleaved 16-bit stereo in place, delayed by the look-ahead while either part is on
+ */
+void dynamics_process_s16(dynamics_t *d, int16_t *samples, size_t num_frames);
+
+/**
+ * Gain reduction in dB right now and the most since the last call
+ */
+void dynamics_get_reduction(dynamics_t *d, float *now_db, float *peak_db);
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Most bands one equaliser can run
+#define EQ_MAX_BANDS 10
+// Frames filtered per pass, bounds the stack the float path needs
+#define EQ_BLOCK_FRAMES 64
+// Gain range of a band, the boost limit keeps shelf coefficients inside Q28
+#define EQ_MIN_GAIN_DB -24.0f
+#define EQ_MAX_GAIN_DB 15.0f
+// Fraction bits of the fixed point coefficients
+#define EQ_COEFF_FRAC_BITS 28
+
+typedef enum {
+    EQ_PEAK,                        // Bell around freq_hz, gain_db at the centre
+    EQ_LOW_SHELF,                   // gain_db below freq_hz
+    EQ_HIGH_SHELF,                  // gain_db above freq_hz
+    EQ_LOW_PASS,                    // 12dB/octave above freq_hz, gain_db unused
+    EQ_HIGH_PASS,                   // 12dB/octave below freq_hz, gain_db unused
+} eq_band_type_t;
+
+typedef struct {
+    eq_band_type_t type;
+    float freq_hz;
+    float gain_db;
+    float q;
+} eq_band_t;
+
+/**
+ * Biquad coefficients of a cascade, b0 b1 b2 a1 a2 per band with a0
+ * normalised to 1. Designed once per settings or rate change, never per sample.
+ */
+typedef struct {
+    int count;
+    float coeffs[EQ_MAX_BANDS][5];
+    int32_t coeffs_q[EQ_MAX_BANDS][5];  // Same coefficients in Q(EQ_COEFF_FRAC_BITS)
+} eq_coeffs_t;
+
+/**
+ * Stereo biquad cascade over interleaved 16-bit PCM. Uses esp-dsp on chips
+ * with an FPU and a fixed point cascade on those without, or on a host build
+ * with EQ_FIXED_POINT defined. One instance per stereo stream, the
+ * coefficients must not change while eq_process_s16() runs.
+ */
+typedef struct {
+    eq_coeffs_t coeffs;
+    float w[2][EQ_MAX_BANDS][2];        // Float path delay line per channel and band
+    int32_t z[2][EQ_MAX_BANDS][4];      // Fixed point path x1 x2 y1 y2 per channel and band
+} eq_t;
+
+/**
+ * Parse bands from text, "type freq gain q" per band separated by ';', for
+ * example "lowshelf 80 4 0.7; peak 2500 -3 1.4". Types are peak, lowshelf,
+ * highshelf, lowpass and highpass.
+ *
+ * @return Number of bands, 0 for empty text, or -1 if the text is invalid
+ */
+int eq_parse_bands(const char *text, eq_band_t *bands, int max);
+
+/**
+ * Compute the coefficients of a cascade
+ *
+ * @param sample_rate Rate the cascade runs at, bands at or above Nyquist are left out
+ */
+void eq_design(const eq_band_t *bands, int count, uint32_t sample_rate, eq_coeffs_t *out);
+
+/**
+ * Start an equaliser with no bands, it passes audio through untouched
+ */
+void eq_init(eq_t *eq);
+
+/**
+ * Switch to new coefficients from the next block on. Bands keep their delay
+ * lines so a change of gain or frequency doesn't restart the filters, bands
+ * that were not running before start from silence.
+ */
+void eq_set_coeffs(eq_t *eq, const eq_coeffs_t *coeffs);
+
+/**
+ * Filter interleaved 16-bit stereo in place, saturating on overload
+ */
+void eq_process_s16(eq_t *eq, int16_t *samples, size_t num_frames);
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+// Frames per partition, also the latency the convolution adds
+#define FIR_PARTITION_FRAMES 256
+// FFT length, one partition of input plus the one before it
+#define FIR_FFT_SIZE (FIR_PARTITION_FRAMES * 2)
+// Longest impulse response accepted
+#define FIR_MAX_TAPS 8192
+
+/**
+ * Stereo FIR filter by uniformly partitioned overlap-save convolution. The
+ * impulse response is cut into FIR_PARTITION_FRAMES long partitions whose
+ * spectra are kept, and every partition of input is transformed once and
+ * multiplied against all of them from a frequency domain delay line.
+ * Both channels share each FFT, left in the real and right in the imaginary
+ * part. The spectra live in PSRAM when there is some.
+ */
+typedef struct {
+    size_t taps;
+    int partitions;
+    bool stereo;                    // Separate left and right responses, else one for both
+    float *ir;                      // Response spectra, bins 0..N/2 per partition, left then right
+    float *fdl;                     // Input spectra of the last partitions, left then right, a ring
+    int fdl_head;                   // Partition of the ring holding the newest input
+    size_t pos;                     // Frames of the current partition received
+    float input[2][FIR_FFT_SIZE];   // Previous and current partition of input per channel
+    float acc[2][(FIR_PARTITION_FRAMES + 1) * 2];  // Output spectrum being summed per channel
+    int16_t output[FIR_PARTITION_FRAMES * 2];      // Filtered partition, played out one partition late
+    float fft[FIR_FFT_SIZE * 2] __attribute__((aligned(16)));  // Complex FFT work buffer
+} fir_conv_t;
+
+// Layout of an impulse response WAV file
+typedef struct {
+    uint32_t sample_rate;
+    uint16_t channels;              // 1 for one response on both channels, 2 for left and right
+    uint16_t bits;                  // 16, 24 or 32
+    bool is_float;                  // 32-bit IEEE float samples
+    size_t taps;
+    long data_offset;               // File offset of the first sample
+} fir_wav_info_t;
+
+/**
+ * Allocate a filter for a response of up to taps taps, starting silent
+ *
+ * @param stereo Separate left and right responses
+ * @return NULL if taps is out of range or memory ran out
+ */
+fir_conv_t *fir_create(size_t taps, bool stereo);
+
+void fir_destroy(fir_conv_t *fir);
+
+/**
+ * Set the taps of one partition, computes its spectra
+ *
+ * @param left Up to FIR_PARTITION_FRAMES taps, the rest of the partition is zero
+ * @param right Taps of the right channel, ignored for a filter that isn't stereo
+ * @param count Number of taps in left and right
+ */
+void fir_set_partition(fir_conv_t *fir, int index, const float *left, const float *right, size_t count);
+
+/**
+ * Filter interleaved 16-bit stereo in place, output trails input by FIR_PARTITION_FRAMES
+ */
+void fir_process_s16(fir_conv_t *fir, int16_t *samples, size_t num_frames);
+
+/**
+ * Bytes the spectra and delay line of a filter take
+ */
+size_t fir_memory_bytes(size_t taps, bool stereo);
+
+/**
+ * Read the header of a PCM or float WAV file
+ *
+ * @return False if the file isn't a WAV of 1 or 2 channels of 16, 24 or 32 bits
+ */
+bool fir_read_wav_info(FILE *file, fir_wav_info_t *info);
+
+/**
+ * Build a filter from the samples of a WAV file
+ *
+ * @return NULL on a read error, when the response is longer than FIR_MAX_TAPS
+ *         or when memory ran out
+ */
+fir_conv_t *fir_load_wav(FILE *file, const fir_wav_info_t *info);
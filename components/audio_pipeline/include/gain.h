@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Q15 unity gain, samples at this gain are passed through untouched
+#define GAIN_Q15_UNITY 32768
+
+// Length of a linear volume ramp in frames (10ms at 48KHz)
+#define GAIN_RAMP_FRAMES 480
+// One-pole coefficient for exponential ramps, step = (target - current) >> shift
+#define GAIN_EXP_SHIFT 6
+
+typedef enum {
+    GAIN_RAMP_LINEAR,       // Constant step per frame, reaches target in GAIN_RAMP_FRAMES
+    GAIN_RAMP_EXPONENTIAL,  // One-pole smoothing towards the target
+} gain_ramp_type_t;
+
+/**
+ * Fixed point gain stage with click-free ramps between volume levels.
+ * One instance per audio stream, not thread safe beyond a single writer
+ * calling gain_set_target() and a single audio task calling gain_process_s16().
+ */
+typedef struct {
+    volatile int32_t target_q15;    // Gain being ramped towards, written by gain_set_target()
+    int32_t current_q15;            // Gain applied to the next frame
+    int32_t ramp_from_q15;          // Target the current linear step was computed for
+    int32_t step_q15;               // Per-frame step for linear ramps
+    gain_ramp_type_t ramp_type;
+} gain_stage_t;
+
+/**
+ * Initialize a gain stage at a fixed gain without ramping
+ *
+ * @param gain Linear gain 0.0-1.0
+ * @param ramp_type Ramp shape used for later gain changes
+ */
+void gain_init(gain_stage_t *g, float gain, gain_ramp_type_t ramp_type);
+
+/**
+ * Set a new gain to ramp towards, cheap enough to call once per chunk
+ *
+ * @param gain Linear gain 0.0-1.0
+ */
+void gain_set_target(gain_stage_t *g, float gain);
+
+/**
+ * Apply the gain in place to interleaved 16-bit PCM
+ *
+ * @param samples Interleaved samples, at least 2-byte aligned, 4-byte
+ *                aligned buffers keep the whole chunk on the vector path
+ * @param num_frames Number of frames (samples per channel)
+ * @param channels Number of interleaved channels
+ */
+void gain_process_s16(gain_stage_t *g, int16_t *samples, size_t num_frames, int channels);
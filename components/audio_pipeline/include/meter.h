@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Samples per spectrum, 21ms at 48KHz
+#define METER_FFT_SIZE 1024
+// Bands the spectrum is reduced to, spaced evenly in log frequency
+#define METER_BANDS 32
+// Lower edge of the first band
+#define METER_LOWEST_HZ 40.0f
+// Levels are sent as codes of this many dB below full scale, 0 is 0dBFS and 255 silence
+#define METER_CODE_STEP_DB 0.5f
+
+/**
+ * Peak and energy of interleaved 16-bit stereo, accumulated over any number
+ * of blocks until the reader takes them. Only integer adds and compares run
+ * per sample, the dB conversion happens when the levels are read.
+ */
+typedef struct {
+    uint32_t peak[2];               // Largest sample magnitude per channel
+    uint64_t energy[2];             // Sum of squared samples per channel
+    uint32_t frames;
+} meter_levels_t;
+
+/**
+ * Add a block to the levels, cheap enough for the audio task
+ */
+void meter_measure_s16(meter_levels_t *levels, const int16_t *samples, size_t num_frames);
+
+/**
+ * Peak and RMS of a channel as level codes, silence when no frames were measured
+ */
+uint8_t meter_peak_code(const meter_levels_t *levels, int channel);
+uint8_t meter_rms_code(const meter_levels_t *levels, int channel);
+
+/**
+ * The last METER_FFT_SIZE samples of a stereo signal mixed to mono, written
+ * by the audio task and copied out for analysis elsewhere
+ */
+typedef struct {
+    int16_t samples[METER_FFT_SIZE];
+    size_t pos;                     // Oldest sample, next to be overwritten
+} meter_scope_t;
+
+void meter_scope_write(meter_scope_t *scope, const int16_t *samples, size_t num_frames);
+
+/**
+ * Copy the scope out oldest sample first
+ */
+void meter_scope_read(const meter_scope_t *scope, int16_t *mono);
+
+/**
+ * Hann windowed FFT of the scope reduced to METER_BANDS bands, the part that
+ * is too costly for the audio task and runs on another core at a low rate
+ */
+typedef struct {
+    uint32_t sample_rate;
+    uint16_t band_end[METER_BANDS];                 // One past the last bin of each band
+    float window[METER_FFT_SIZE];
+    float fft[METER_FFT_SIZE * 2] __attribute__((aligned(16)));
+} meter_spectrum_t;
+
+/**
+ * Lay out the bands for a sample rate, call again when the rate changes
+ *
+ * @return False if the FFT couldn't be set up
+ */
+bool meter_spectrum_init(meter_spectrum_t *s, uint32_t sample_rate);
+
+/**
+ * Analyse METER_FFT_SIZE mono samples into level codes per band, a full
+ * scale sine reads 0dB in the band it falls in
+ */
+void meter_spectrum_analyze(meter_spectrum_t *s, const int16_t *mono, uint8_t codes[METER_BANDS]);
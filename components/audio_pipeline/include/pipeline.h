@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Most stages one pipeline can hold
+#define PIPELINE_MAX_STAGES 8
+
+/**
+ * A block of audio on its way through the pipeline: one run of 16-bit stereo
+ * frames per lane, lanes back to back. Stages work on it in place.
+ */
+typedef struct {
+    int16_t *samples;
+    size_t frames;                  // Frames per lane
+    int lanes;
+} pipeline_block_t;
+
+/**
+ * A processing stage. process() runs on the audio task for every block while
+ * the stage is enabled and must not allocate or block.
+ */
+typedef struct {
+    const char *name;
+    void *ctx;                      // Passed to process(), owned by whoever adds the stage
+    void (*process)(void *ctx, pipeline_block_t *block);
+} pipeline_stage_t;
+
+// Per stage counters, cycles are CPU cycles on the device and nanoseconds on a host build
+typedef struct {
+    const char *name;
+    bool enabled;
+    uint32_t runs;                  // Blocks processed
+    uint32_t avg_cycles;            // Cost per block, moving average
+    uint32_t max_cycles;            // Cost per block, worst case
+} pipeline_stage_stats_t;
+
+/**
+ * Stages run in the order they were added on a block allocated up front, so
+ * running the pipeline never allocates. Stages are added at startup and can
+ * then be switched on and off from any task.
+ */
+typedef struct {
+    pipeline_stage_t stages[PIPELINE_MAX_STAGES];
+    pipeline_stage_stats_t stats[PIPELINE_MAX_STAGES];
+    volatile bool enabled[PIPELINE_MAX_STAGES];
+    int count;
+    pipeline_block_t block;
+    size_t block_bytes;
+} pipeline_t;
+
+/**
+ * Allocate the working block
+ *
+ * @param frames Frames per lane in every block
+ * @param lanes Stereo mixes per block
+ * @return False if the block couldn't be allocated
+ */
+bool pipeline_init(pipeline_t *p, size_t frames, int lanes);
+
+/**
+ * Free the working block, the stages stay with their owners
+ */
+void pipeline_deinit(pipeline_t *p);
+
+/**
+ * Append a stage, only before the pipeline starts running
+ *
+ * @param stage Copied into the pipeline
+ * @return False when PIPELINE_MAX_STAGES stages are already added
+ */
+bool pipeline_add_stage(pipeline_t *p, const pipeline_stage_t *stage, bool enabled);
+
+/**
+ * Switch a stage on or off, takes effect from the next block
+ *
+ * @return False if no stage has this name
+ */
+bool pipeline_set_enabled(pipeline_t *p, const char *name, bool enabled);
+
+/**
+ * Copy a block in and run every enabled stage over it
+ *
+ * @param in block_bytes of input, lanes back to back
+ * @return The processed block, valid until the next run
+ */
+uint8_t *pipeline_run(pipeline_t *p, const uint8_t *in);
+
+/**
+ * Copy the counters of every stage
+ *
+ * @return Number of stages written to stats
+ */
+int pipeline_get_stats(const pipeline_t *p, pipeline_stage_stats_t *stats, int max);
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Once silent, a chunk has to peak above threshold * SILENCE_RELEASE_FACTOR to count as audio again
+#define SILENCE_RELEASE_FACTOR 2
+
+/**
+ * Digital silence detector for 16-bit PCM with hysteresis. A chunk whose
+ * peak is at or below the threshold is silent, and after that the level has
+ * to rise past a higher release level before chunks count as audio again, so
+ * dither or a noise floor hovering around the threshold doesn't flap.
+ */
+typedef struct {
+    uint16_t threshold;             // Peak magnitude still counted as silence
+    bool silent;
+} silence_detector_t;
+
+/**
+ * Start out treating the stream as audio
+ */
+void silence_init(silence_detector_t *d, uint16_t threshold);
+
+/**
+ * Largest magnitude of any sample, or the first one found above limit
+ *
+ * @param limit Stop scanning once a sample exceeds it, UINT16_MAX to scan everything
+ */
+uint16_t silence_peak_s16(const int16_t *samples, size_t count, uint16_t limit);
+
+/**
+ * Classify a chunk of samples, channels in any layout
+ *
+ * @return True while the stream is silent
+ */
+bool silence_update(silence_detector_t *d, const int16_t *samples, size_t count);
@@ -0,0 +1,126 @@
+#include "meter.h"
+#include <math.h>
+#include <string.h>
+#include "fft.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+void meter_measure_s16(meter_levels_t *levels, const int16_t *samples, size_t num_frames) {
+    // Separate accumulators per channel and no branches, so the loop
+    // vectorises where the compiler can and pipelines where it can't
+    uint32_t peak_l = levels->peak[0], peak_r = levels->peak[1];
+    uint64_t energy_l = levels->energy[0], energy_r = levels->energy[1];
+    for (size_t i = 0; i < num_frames; i++) {
+        int32_t l = samples[2 * i];
+        int32_t r = samples[2 * i + 1];
+        uint32_t abs_l = (uint32_t)(l < 0 ? -l : l);
+        uint32_t abs_r = (uint32_t)(r < 0 ? -r : r);
+        peak_l = abs_l > peak_l ? abs_l : peak_l;
+        peak_r = abs_r > peak_r ? abs_r : peak_r;
+        energy_l += (uint32_t)(l * l);
+        energy_r += (uint32_t)(r * r);
+    }
+    levels->peak[0] = peak_l;
+    levels->peak[1] = peak_r;
+    levels->energy[0] = energy_l;
+    levels->energy[1] = energy_r;
+    levels->frames += num_frames;
+}
+
+static uint8_t db_to_code(float db) {
+    float code = -db / METER_CODE_STEP_DB;
+    if (!(code < 255.0f)) {
+        return 255;
+    }
+    return code < 0.0f ? 0 : (uint8_t)lrintf(code);
+}
+
+uint8_t meter_peak_code(const meter_levels_t *levels, int channel) {
+    if (levels->frames == 0 || levels->peak[channel] == 0) {
+        return 255;
+    }
+    return db_to_code(20.0f * log10f(levels->peak[channel] / 32768.0f));
+}
+
+uint8_t meter_rms_code(const meter_levels_t *levels, int channel) {
+    if (levels->frames == 0 || levels->energy[channel] == 0) {
+        return 255;
+    }
+    float mean = (float)levels->energy[channel] / levels->frames;
+    return db_to_code(10.0f * log10f(mean / (32768.0f * 32768.0f)));
+}
+
+void meter_scope_write(meter_scope_t *scope, const int16_t *samples, size_t num_frames) {
+    size_t pos = scope->pos;
+    for (size_t i = 0; i < num_frames; i++) {
+        scope->samples[pos] = (int16_t)((samples[2 * i] + samples[2 * i + 1]) >> 1);
+        if (++pos == METER_FFT_SIZE) {
+            pos = 0;
+        }
+    }
+    scope->pos = pos;
+}
+
+void meter_scope_read(const meter_scope_t *scope, int16_t *mono) {
+    size_t older = METER_FFT_SIZE - scope->pos;
+    memcpy(mono, scope->samples + scope->pos, older * sizeof(int16_t));
+    memcpy(mono + older, scope->samples, scope->pos * sizeof(int16_t));
+}
+
+bool meter_spectrum_init(meter_spectrum_t *s, uint32_t sample_rate) {
+    if (!fft_init() || sample_rate == 0) {
+        return false;
+    }
+    s->sample_rate = sample_rate;
+    for (int n = 0; n < METER_FFT_SIZE; n++) {
+        s->window[n] = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * n / METER_FFT_SIZE);
+    }
+    // Log spaced edges from METER_LOWEST_HZ to Nyquist, at least one bin per band
+    const float bin_hz = (float)sample_rate / METER_FFT_SIZE;
+    const float ratio = powf(sample_rate / 2.0f / METER_LOWEST_HZ, 1.0f / METER_BANDS);
+    int start = (int)(METER_LOWEST_HZ / bin_hz);
+    if (start < 1) {
+        start = 1;
+    }
+    float edge = METER_LOWEST_HZ;
+    for (int band = 0; band < METER_BANDS; band++) {
+        edge *= ratio;
+        int end = (int)lrintf(edge / bin_hz);
+        if (end <= start) {
+            end = start + 1;
+        }
+        if (end > METER_FFT_SIZE / 2 || band == METER_BANDS - 1) {
+            end = METER_FFT_SIZE / 2;
+        }
+        s->band_end[band] = (uint16_t)end;
+        start = end;
+    }
+    return true;
+}
+
+void meter_spectrum_analyze(meter_spectrum_t *s, const int16_t *mono, uint8_t codes[METER_BANDS]) {
+    for (int n = 0; n < METER_FFT_SIZE; n++) {
+        s->fft[2 * n] = mono[n] * s->window[n];
+        s->fft[2 * n + 1] = 0.0f;
+    }
+    fft_forward(s->fft, METER_FFT_SIZE);
+
+    // A full scale sine peaks at 32768 * N / 4 through the Hann window
+    const float full_scale = 32768.0f * METER_FFT_SIZE / 4.0f;
+    const float reference = full_scale * full_scale;
+    int bin = (int)(METER_LOWEST_HZ * METER_FFT_SIZE / s->sample_rate);
+    if (bin < 1) {
+        bin = 1;
+    }
+    for (int band = 0; band < METER_BANDS; band++) {
+        float power = 0.0f;
+        for (; bin < s->band_end[band]; bin++) {
+            float re = s->fft[2 * bin], im = s->fft[2 * bin + 1];
+            float p = re * re + im * im;
+            power = p > power ? p : power;
+        }
+        codes[band] = power > 0.0f ? db_to_code(10.0f * log10f(power / reference)) : 255;
+    }
+}
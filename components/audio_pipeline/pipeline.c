@@ -0,0 +1,97 @@
+#include "pipeline.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef ESP_PLATFORM
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+#else
+#include <time.h>
+#endif
+
+static inline uint32_t cycle_count(void) {
+#ifdef ESP_PLATFORM
+    return esp_cpu_get_cycle_count();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec);
+#endif
+}
+
+bool pipeline_init(pipeline_t *p, size_t frames, int lanes) {
+    memset(p, 0, sizeof(*p));
+    p->block_bytes = frames * 4 * lanes;
+#ifdef ESP_PLATFORM
+    // Stages touch every sample, keep the block in internal RAM
+    p->block.samples = heap_caps_aligned_alloc(16, p->block_bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+#else
+    p->block.samples = aligned_alloc(16, (p->block_bytes + 15) & ~(size_t)15);
+#endif
+    if (p->block.samples == NULL) {
+        return false;
+    }
+    p->block.frames = frames;
+    p->block.lanes = lanes;
+    return true;
+}
+
+void pipeline_deinit(pipeline_t *p) {
+#ifdef ESP_PLATFORM
+    heap_caps_free(p->block.samples);
+#else
+    free(p->block.samples);
+#endif
+    p->block.samples = NULL;
+}
+
+bool pipeline_add_stage(pipeline_t *p, const pipeline_stage_t *stage, bool enabled) {
+    if (p->count >= PIPELINE_MAX_STAGES) {
+        return false;
+    }
+    p->stages[p->count] = *stage;
+    p->stats[p->count].name = stage->name;
+    p->enabled[p->count] = enabled;
+    p->count++;
+    return true;
+}
+
+bool pipeline_set_enabled(pipeline_t *p, const char *name, bool enabled) {
+    for (int i = 0; i < p->count; i++) {
+        if (strcmp(p->stages[i].name, name) == 0) {
+            p->enabled[i] = enabled;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint8_t *pipeline_run(pipeline_t *p, const uint8_t *in) {
+    memcpy(p->block.samples, in, p->block_bytes);
+    for (int i = 0; i < p->count; i++) {
+        if (!p->enabled[i]) {
+            continue;
+        }
+        uint32_t start = cycle_count();
+        p->stages[i].process(p->stages[i].ctx, &p->block);
+        uint32_t cycles = cycle_count() - start;
+
+        pipeline_stage_stats_t *s = &p->stats[i];
+        s->runs++;
+        if (cycles > s->max_cycles) {
+            s->max_cycles = cycles;
+        }
+        // Exponential moving average with a 1/16 weight
+        s->avg_cycles += ((int32_t)cycles - (int32_t)s->avg_cycles) / 16;
+    }
+    return (uint8_t *)p->block.samples;
+}
+
+int pipeline_get_stats(const pipeline_t *p, pipeline_stage_stats_t *stats, int max) {
+    int n = 0;
+    for (int i = 0; i < p->count && n < max; i++) {
+        stats[n] = p->stats[i];
+        stats[n].enabled = p->enabled[i];
+        n++;
+    }
+    return n;
+}
@@ -0,0 +1,42 @@
+#include "silence.h"
+
+// Samples compared between checks for the early exit, a whole number of vectors
+#define SILENCE_BLOCK 64
+
+void silence_init(silence_detector_t *d, uint16_t threshold) {
+    d->threshold = threshold;
+    d->silent = false;
+}
+
+uint16_t silence_peak_s16(const int16_t *samples, size_t count, uint16_t limit) {
+    // Max and min over fixed blocks with no branches inside, which compilers
+    // turn into vector max/min, then one check per block for the early exit
+    int16_t hi = 0, lo = 0;
+    size_t i = 0;
+    for (; i + SILENCE_BLOCK <= count; i += SILENCE_BLOCK) {
+        for (size_t k = 0; k < SILENCE_BLOCK; k++) {
+            int16_t s = samples[i + k];
+            hi = s > hi ? s : hi;
+            lo = s < lo ? s : lo;
+        }
+        if (hi > limit || -(int32_t)lo > limit) {
+            break;
+        }
+    }
+    if (i + SILENCE_BLOCK > count) {
+        for (; i < count; i++) {
+            int16_t s = samples[i];
+            hi = s > hi ? s : hi;
+            lo = s < lo ? s : lo;
+        }
+    }
+    int32_t peak = -(int32_t)lo > hi ? -(int32_t)lo : hi;
+    return peak > UINT16_MAX ? UINT16_MAX : (uint16_t)peak;
+}
+
+bool silence_update(silence_detector_t *d, const int16_t *samples, size_t count) {
+    uint32_t release = (uint32_t)d->threshold * SILENCE_RELEASE_FACTOR;
+    uint16_t level = d->silent ? (release > UINT16_MAX ? UINT16_MAX : (uint16_t)release) : d->threshold;
+    d->silent = silence_peak_s16(samples, count, level) <= level;
+    return d->silent;
+}
@@ -0,0 +1,115 @@
+// Stage bookkeeping of pipeline_run, on the host:
+//   cmake -S components/audio_pipeline -B build && cmake --build build && ctest --test-dir build
+// Exits with 1 when a check fails.
+#include "pipeline.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#define FRAMES 32
+#define LANES 2
+// Longest run order the log keeps
+#define LOG_SIZE 32
+
+static char order[LOG_SIZE];
+static int order_length;
+static int failures;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+// Logs its id and adds it to every sample, so the output shows the stages that ran
+static void tag_stage(void *ctx, pipeline_block_t *block) {
+    char id = *(const char *)ctx;
+    if (order_length < LOG_SIZE - 1) {
+        order[order_length++] = id;
+        order[order_length] = '\0';
+    }
+    for (size_t i = 0; i < block->frames * 2 * block->lanes; i++) {
+        block->samples[i] += id;
+    }
+}
+
+static uint8_t *run(pipeline_t *p, const int16_t *in) {
+    order_length = 0;
+    order[0] = '\0';
+    return pipeline_run(p, (const uint8_t *)in);
+}
+
+int main(void) {
+    static const char ids[PIPELINE_MAX_STAGES + 1] = "abcdefghi";
+    static const char *names[PIPELINE_MAX_STAGES + 1] = { "a", "b", "c", "d", "e", "f", "g", "h", "i" };
+    static int16_t in[FRAMES * 2 * LANES];
+    for (int i = 0; i < FRAMES * 2 * LANES; i++) {
+        in[i] = (int16_t)(i * 7 - 500);
+    }
+
+    pipeline_t p;
+    if (!pipeline_init(&p, FRAMES, LANES)) {
+        printf("pipeline_init failed\n");
+        return 1;
+    }
+    CHECK(p.block_bytes == sizeof(in));
+
+    // Stages run in the order they were added, not by name, disabled ones are skipped
+    pipeline_stage_t stage = { .name = names[2], .ctx = (void *)&ids[2], .process = tag_stage };
+    CHECK(pipeline_add_stage(&p, &stage, true));
+    stage = (pipeline_stage_t){ .name = names[0], .ctx = (void *)&ids[0], .process = tag_stage };
+    CHECK(pipeline_add_stage(&p, &stage, false));
+    stage = (pipeline_stage_t){ .name = names[1], .ctx = (void *)&ids[1], .process = tag_stage };
+    CHECK(pipeline_add_stage(&p, &stage, true));
+    const int16_t *out = (const int16_t *)run(&p, in);
+    CHECK(strcmp(order, "cb") == 0);
+    CHECK(out[0] == in[0] + 'c' + 'b');
+    CHECK(out[FRAMES * 2 * LANES - 1] == in[FRAMES * 2 * LANES - 1] + 'c' + 'b');
+
+    // Switching takes effect on the next block, and the input is copied fresh each run
+    CHECK(pipeline_set_enabled(&p, "a", true));
+    CHECK(pipeline_set_enabled(&p, "c", false));
+    out = (const int16_t *)run(&p, in);
+    CHECK(strcmp(order, "ab") == 0);
+    CHECK(out[0] == in[0] + 'a' + 'b');
+
+    // Unknown names change nothing
+    CHECK(!pipeline_set_enabled(&p, "z", true));
+    CHECK(!pipeline_set_enabled(&p, "", false));
+    run(&p, in);
+    CHECK(strcmp(order, "ab") == 0);
+
+    // Only runs of an enabled stage count
+    pipeline_stage_stats_t stats[PIPELINE_MAX_STAGES];
+    int n = pipeline_get_stats(&p, stats, PIPELINE_MAX_STAGES);
+    CHECK(n == 3);
+    CHECK(strcmp(stats[0].name, "c") == 0 && stats[0].runs == 1 && !stats[0].enabled);
+    CHECK(strcmp(stats[1].name, "a") == 0 && stats[1].runs == 2 && stats[1].enabled);
+    CHECK(strcmp(stats[2].name, "b") == 0 && stats[2].runs == 3 && stats[2].enabled);
+    CHECK(stats[2].max_cycles >= stats[2].avg_cycles);
+    CHECK(pipeline_get_stats(&p, stats, 2) == 2);
+
+    // Fill up to PIPELINE_MAX_STAGES, one more is refused and never runs
+    for (int i = 3; i < PIPELINE_MAX_STAGES; i++) {
+        stage = (pipeline_stage_t){ .name = names[i], .ctx = (void *)&ids[i], .process = tag_stage };
+        CHECK(pipeline_add_stage(&p, &stage, true));
+    }
+    stage = (pipeline_stage_t){
+        .name = names[PIPELINE_MAX_STAGES], .ctx = (void *)&ids[PIPELINE_MAX_STAGES], .process = tag_stage,
+    };
+    CHECK(!pipeline_add_stage(&p, &stage, true));
+    CHECK(p.count == PIPELINE_MAX_STAGES);
+    CHECK(!pipeline_set_enabled(&p, names[PIPELINE_MAX_STAGES], true));
+    run(&p, in);
+    CHECK(strcmp(order, "abdefgh") == 0);
+
+    pipeline_deinit(&p);
+    CHECK(p.block.samples == NULL);
+    if (failures) {
+        printf("%d failures\n", failures);
+        return 1;
+    }
+    printf("pipeline ok\n");
+    return 0;
+}
@@ -1,25 +1,139 @@
 #include "global.h"
 #include "buffer.h"
 #include "config_manager.h"
+#include "gain.h"
+#include "eq.h"
+#include "fir.h"
+#include "dynamics.h"
+#include "meter.h"
+#include "silence.h"
+#include "pipeline.h"
+#include "sink.h"
+#include "i2s_output.h"
+#include "spdif.h"
+#include "channel_map.h"
 #include "freertos/FreeRTOS.h"
 #include <inttypes.h>
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
-#ifdef IS_SPDIF
-#include "spdif.h"
-#endif
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+#include "esp_spiffs.h"
+#include "audio.h"
+#include "power.h"
+#include "boot_profile.h"
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
 #ifdef IS_USB
-#include "usb/uac_host.h"
-uac_host_device_handle_t spkr_handle = NULL;
+#include "usb_dac.h"
 #endif
 
 bool playing = false;
 
 uint8_t volume = 100;
+// Software volume applied to every chunk before it reaches the sink, one stage per lane
+static gain_stage_t s_gain[SINK_MAX_LANES];
+// Equaliser bands shared by every lane, each lane filters with its own state
+static eq_t s_eq[SINK_MAX_LANES];
+// Set by audio_update_eq() and on a rate change, the receive task redesigns
+// the bands before the next packet
+static volatile bool s_eq_dirty = true;
+// Compressor and limiter per lane, allocated for the lanes in use
+static dynamics_t *s_dynamics = NULL;
+// Set by audio_update_dynamics() and on a rate change, applied before the next packet
+static volatile bool s_dynamics_dirty = true;
+// Room correction of the receiver's own mix, NULL without an impulse response.
+// Swapped under the pipeline lock.
+static fir_conv_t *s_fir = NULL;
+static uint32_t s_fir_rate = 0;
+// Levels of every lane since they were last read, and the receiver's own mix
+// kept for spectrum analysis while someone watches it. The audio task only
+// adds to them, the dB conversion and the FFT run on the reader's task.
+static meter_levels_t s_levels[SINK_MAX_LANES];
+static meter_scope_t s_scope;
+static volatile bool s_scope_enabled = false;
+static portMUX_TYPE s_meter_lock = portMUX_INITIALIZER_UNLOCKED;
 uint8_t silence[32] = {0};
+// Silence timing, only the PCM handler task reads and writes these
 bool is_silent = false;
-uint32_t silence_duration_ms = 0;
-TickType_t last_audio_time = 0;
+static uint32_t silence_duration_ms = 0;
+static TickType_t last_audio_time = 0;
+// What other tasks report to the PCM handler's silence timing
+static volatile uint32_t s_audible_chunks = 0;   // Written by emit_chunk() only
+static uint32_t s_audible_chunks_seen = 0;
+static volatile bool s_silence_reset = false;
+// Peak detector run on every chunk as it arrives, senders keep streaming zeros
+// when nothing plays and those count as silence like missing packets do
+static silence_detector_t s_silence;
+
+// Activity counters of the sleep monitor in usb_audio_player_main.c
+extern volatile uint32_t packet_counter;
+extern volatile bool monitoring_active;
+extern volatile TickType_t last_packet_time;
+
+// How often the handler wakes to time silence while playing with nothing to write
+#define SILENCE_CHECK_INTERVAL_MS 100
+#define SILENCE_LOG_INTERVAL_MS 5000
+static TaskHandle_t s_pcm_task_handle = NULL;
+static audio_stats_t s_stats;
+static uint32_t s_next_silence_log_ms = 0;
+// Stereo mixes carried per chunk, the receiver's own plus one per USB DAC zone bound to a pair
+static int s_lanes = 1;
+// Processing between the buffer and the outputs, copies each chunk out of the
+// ring or the receive buffer before its stages run
+static pipeline_t s_pipeline;
+// Held while a chunk goes through the pipeline, direct writes and the PCM handler share it
+static SemaphoreHandle_t s_pipeline_lock = NULL;
+
+// Frames of 16-bit stereo in a chunk
+#define CHUNK_FRAMES (PCM_CHUNK_SIZE / 4)
+// Format of the last packet, streams that aren't 16-bit stereo are mapped per lane
+static scream_format_t s_stream_format;
+// Delivery delay, see note_delivery(). Arrival of the first and last packet of
+// the measurement, PCM bytes received since the first and the earliest offset.
+static int64_t s_delivery_start_us = 0;
+static int64_t s_delivery_last_us = 0;
+static uint64_t s_delivery_bytes = 0;
+static int64_t s_delivery_reference_us = 0;
+// A gap this long in the stream starts a new delivery measurement
+#define DELIVERY_RESET_US 1000000
+// Reference creep per packet, about 170us/s, to follow the sender's clock when it runs slow
+#define DELIVERY_DRIFT_US 1
+static channel_map_t s_lane_maps[SINK_MAX_LANES];
+// Set when the stream is 16-bit stereo and every lane plays it as is
+static bool s_passthrough = true;
+// Set by audio_update_channel_map(), the receive task rebuilds the maps before the next packet
+static volatile bool s_maps_dirty = true;
+// Stereo chunks being assembled from multichannel packets, one per lane
+static uint8_t *s_assembly = NULL;
+static size_t s_assembled_frames = 0;
+// Start of a stream frame split across two packets
+static uint8_t s_carry[SCREAM_MAX_CHANNELS * 4];
+static size_t s_carry_len = 0;
+// Outputs registered at boot besides the USB DAC
+static bool s_spdif_enabled = false;
+static bool s_i2s_enabled = false;
+
+#ifdef IS_USB
+// Set while the primary DAC is unplugged during playback, incoming audio is buffered for it
+static bool s_resume_on_attach = false;
+// Set when the receiver was ready to play before the DAC enumerated, boot no longer waits for it
+static bool s_start_on_attach = false;
+// Set after a replug until the buffered audio has been written
+static bool s_draining_backlog = false;
+// Replug timing, zero when not in progress
+static int64_t s_detach_us = 0;
+static int64_t s_attach_us = 0;
+// Wake from silence sleep, arrival of the first audible chunk and start of
+// the DAC restart, zero when not in progress
+static int64_t s_wake_us = 0;
+static int64_t s_wake_dac_us = 0;
+// Chunks buffered since the first audible one while asleep
+static unsigned int s_wake_chunks = 0;
+#endif
 
 // Forward declaration of the sleep function we'll define in usb_audio_player_main.c
 extern void enter_silence_sleep_mode();
@@ -31,59 +145,407 @@ bool is_playing() {
 void resume_playback() {
 #ifdef IS_USB
     // Only try to resume if we have a valid DAC handle
-    if (spkr_handle != NULL) {
+    if (usb_dac_connected(0)) {
         // Get current configuration
         app_config_t *config = config_manager_get_config();
-        
-        uac_host_stream_config_t stm_config = {
-            .channels = 2,
-            .bit_resolution = config->bit_depth,
-            .sample_freq = config->sample_rate,
-        };
-        ESP_LOGI(TAG, "Resume Playback with DAC (SR: %" PRIu32 ", BD: %" PRIu8 ")", 
+        ESP_LOGI(TAG, "Resume Playback with DAC (stream SR: %" PRIu32 ", BD: %" PRIu8 ")", 
                  config->sample_rate, config->bit_depth);
-        
-        ESP_ERROR_CHECK(uac_host_device_start(spkr_handle, &stm_config));
-        ESP_ERROR_CHECK(uac_host_device_set_volume(spkr_handle, config->volume * 100.0f));
+        s_start_on_attach = false;
+        if (usb_dac_start(0, config->sample_rate) != ESP_OK) {
+            return;
+        }
+        // DACs in the other zones follow the primary one
+        for (int zone = 1; zone < USB_DAC_MAX; zone++) {
+            if (usb_dac_connected(zone)) {
+                usb_dac_start(zone, config->sample_rate);
+            }
+        }
         playing = true;
+        // Start timing silence and drain anything already buffered
+        audio_notify();
     } else {
         ESP_LOGI(TAG, "Cannot resume playback - No DAC connected");
-        // Do NOT set playing to true if no DAC is available
+        // Do NOT set playing to true if no DAC is available, start_playback() starts it
+        s_start_on_attach = true;
     }
+#else
+    // S/PDIF and I2S outputs are always there, drain the buffer into them
+    playing = true;
+    audio_notify();
 #endif
 }
 
 #ifdef IS_USB
-void start_playback(uac_host_device_handle_t _spkr_handle) {
-	spkr_handle = _spkr_handle;
+int start_playback(uac_host_device_handle_t _spkr_handle) {
+	int zone = usb_dac_attach(_spkr_handle);
+	if (zone < 0) {
+		return zone;
+	}
+	if (zone > 0) {
+		// Join a stream that is already playing
+		if (playing) {
+			usb_dac_start(zone, config_manager_get_config()->sample_rate);
+		}
+		return zone;
+	}
+
+	// First DAC after boot, the receive socket was already waiting for it
+	if (s_start_on_attach && !device_sleeping) {
+		resume_playback();
+		return zone;
+	}
+
+	// Replugged during playback, restart straight away with the cached stream config
+	if (s_resume_on_attach) {
+		s_resume_on_attach = false;
+		s_attach_us = esp_timer_get_time();
+		if (usb_dac_restart(0) != ESP_OK) {
+			s_attach_us = 0;
+			return zone;
+		}
+		// Keep only the configured prebuffer so the backlog doesn't add latency
+		trim_buffer(config_manager_get_config()->initial_buffer_size);
+		s_draining_backlog = true;
+		playing = true;
+		s_stats.replugs++;
+		ESP_LOGI(TAG, "DAC replugged, resuming playback");
+		audio_notify();
+	}
+	return zone;
+}
+
+void audio_dac_detached(uac_host_device_handle_t handle) {
+	int zone = usb_dac_detach(handle);
+	if (zone != 0) {
+		// A secondary zone only loses its own output
+		return;
+	}
+	s_resume_on_attach = playing;
+	playing = false;
+	s_detach_us = esp_timer_get_time();
+	ESP_LOGI(TAG, "DAC detached%s", s_resume_on_attach ? ", buffering until it returns" : "");
+}
+
+uint32_t audio_dac_detached_ms(void) {
+	if (usb_dac_connected(0) || s_detach_us == 0) {
+		return 0;
+	}
+	return (uint32_t)((esp_timer_get_time() - s_detach_us) / 1000);
+}
+
+// Leave silence sleep, restart the DACs with the stream config they had and
+// play the audio buffered since the first audible chunk, see buffer_while_asleep()
+void audio_wake_from_sleep(void) {
+	if (!usb_dac_connected(0)) {
+		ESP_LOGI(TAG, "Cannot resume playback - No DAC connected");
+		s_wake_us = 0;
+		return;
+	}
+	// Direct writes go through the buffer until the wake audio has been played
+	s_draining_backlog = true;
+	uint32_t rate = config_manager_get_config()->sample_rate;
+	s_wake_dac_us = esp_timer_get_time();
+	if (usb_dac_restart(0) != ESP_OK && usb_dac_start(0, rate) != ESP_OK) {
+		s_draining_backlog = false;
+		s_wake_us = 0;
+		return;
+	}
+	for (int zone = 1; zone < USB_DAC_MAX; zone++) {
+		if (usb_dac_connected(zone) && usb_dac_restart(zone) != ESP_OK) {
+			usb_dac_start(zone, rate);
+		}
+	}
+	s_stats.wake_dac_start_us = (uint32_t)(esp_timer_get_time() - s_wake_dac_us);
+	s_stats.wakes++;
+	playing = true;
+	ESP_LOGI(TAG, "Woke from silence sleep, DAC started in %" PRIu32 " us with %u chunks buffered",
+	         s_stats.wake_dac_start_us, s_wake_chunks);
+	audio_notify();
+}
+
+// Record replug and wake timing on the first chunk the primary DAC accepts
+static void note_first_sample(int zone) {
+	if (zone != 0) {
+		return;
+	}
+	int64_t now = esp_timer_get_time();
+	if (s_wake_us != 0 && playing) {
+		s_stats.wake_to_sound_us = (uint32_t)(now - s_wake_us);
+		ESP_LOGI(TAG, "First sample %" PRIu32 " us after the audio that woke the receiver",
+		         s_stats.wake_to_sound_us);
+		s_wake_us = 0;
+	}
+	if (s_attach_us == 0) {
+		return;
+	}
+	s_stats.time_to_first_sample_us = (uint32_t)(now - s_attach_us);
+	s_stats.replug_gap_ms = (uint32_t)((now - s_detach_us) / 1000);
+	ESP_LOGI(TAG, "First sample %" PRIu32 " us after replug, %" PRIu32 " ms without audio",
+	         s_stats.time_to_first_sample_us, s_stats.replug_gap_ms);
+	s_attach_us = 0;
+	s_detach_us = 0;
 }
 #endif
 
 void stop_playback() {
 	playing = false;
+#ifdef IS_USB
+	s_start_on_attach = false;
+#endif
 	ESP_LOGI(TAG, "Stop Playback");
+	sink_flush();
 #ifdef IS_USB
-	uac_host_device_stop(spkr_handle);
+	for (int zone = 0; zone < USB_DAC_MAX; zone++) {
+		usb_dac_stop(zone);
+	}
 #endif
 }
 
-void audio_direct_write(uint8_t *data) {
+void audio_set_volume(float volume) {
+  for (int lane = 0; lane < SINK_MAX_LANES; lane++) {
+    gain_set_target(&s_gain[lane], volume);
+  }
+}
+
+// Pipeline stage applying the software volume, one gain stage per lane
+static void gain_stage_process(void *ctx, pipeline_block_t *block) {
+  for (int lane = 0; lane < block->lanes; lane++) {
+    gain_process_s16(&s_gain[lane], block->samples + lane * block->frames * 2, block->frames, 2);
+  }
+}
+
+// Pipeline stage running the equaliser, before the gain so cuts leave headroom for boosts
+static void eq_stage_process(void *ctx, pipeline_block_t *block) {
+  for (int lane = 0; lane < block->lanes; lane++) {
+    eq_process_s16(&s_eq[lane], block->samples + lane * block->frames * 2, block->frames);
+  }
+}
+
+// Pipeline stage convolving the receiver's own mix with the room correction
+// response, zones on other lanes play elsewhere and aren't corrected
+static void fir_stage_process(void *ctx, pipeline_block_t *block) {
+  if (s_fir != NULL && s_fir_rate == s_stream_format.sample_rate) {
+    fir_process_s16(s_fir, block->samples, block->frames);
+  }
+}
+
+// Pipeline stage compressing and limiting each lane, after the EQ so its boosts are caught
+static void dynamics_stage_process(void *ctx, pipeline_block_t *block) {
+  for (int lane = 0; lane < block->lanes; lane++) {
+    dynamics_process_s16(&s_dynamics[lane], block->samples + lane * block->frames * 2, block->frames);
+  }
+}
+
+// Pipeline stage metering each lane as it goes out, last so it sees what is played
+static void meter_stage_process(void *ctx, pipeline_block_t *block) {
+  meter_levels_t levels[SINK_MAX_LANES] = {0};
+  for (int lane = 0; lane < block->lanes; lane++) {
+    meter_measure_s16(&levels[lane], block->samples + lane * block->frames * 2, block->frames);
+  }
+  taskENTER_CRITICAL(&s_meter_lock);
+  for (int lane = 0; lane < block->lanes; lane++) {
+    for (int ch = 0; ch < 2; ch++) {
+      if (levels[lane].peak[ch] > s_levels[lane].peak[ch]) {
+        s_levels[lane].peak[ch] = levels[lane].peak[ch];
+      }
+      s_levels[lane].energy[ch] += levels[lane].energy[ch];
+    }
+    s_levels[lane].frames += levels[lane].frames;
+  }
+  if (s_scope_enabled) {
+    meter_scope_write(&s_scope, block->samples, block->frames);
+  }
+  taskEXIT_CRITICAL(&s_meter_lock);
+}
+
+// Run a chunk through the pipeline and queue the result on every output
+static void process_chunk(const uint8_t *data, int64_t arrival_us) {
+  xSemaphoreTake(s_pipeline_lock, portMAX_DELAY);
+  uint8_t *out = pipeline_run(&s_pipeline, data);
+  // Every output queues its own copy, one that can't keep up drops its oldest chunk
+  sink_dispatch(out, s_lanes, arrival_us);
+  xSemaphoreGive(s_pipeline_lock);
+  if (s_stats.boot_to_first_audio_ms == 0) {
+    s_stats.boot_to_first_audio_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    ESP_LOGI(TAG, "First audio %" PRIu32 " ms after boot", s_stats.boot_to_first_audio_ms);
+    boot_profile_mark("first_audio");
+  }
+}
+
+esp_err_t audio_load_fir(const char *path) {
+  fir_conv_t *fir = NULL;
+  fir_wav_info_t info = {0};
+  if (path != NULL) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+      return ESP_ERR_NOT_FOUND;
+    }
+    esp_err_t err = ESP_OK;
+    if (!fir_read_wav_info(file, &info)) {
+      err = ESP_ERR_INVALID_ARG;
+    } else if (info.taps > FIR_MAX_TAPS) {
+      err = ESP_ERR_INVALID_SIZE;
+    } else {
+      fir = fir_load_wav(file, &info);
+      if (fir == NULL) {
+        ESP_LOGE(TAG, "No memory for a %u tap response (%u KB)", (unsigned)info.taps,
+                 (unsigned)(fir_memory_bytes(info.taps, info.channels == 2) / 1024));
+        err = ESP_ERR_NO_MEM;
+      }
+    }
+    fclose(file);
+    if (err != ESP_OK) {
+      return err;
+    }
+  }
+
+  xSemaphoreTake(s_pipeline_lock, portMAX_DELAY);
+  fir_conv_t *old = s_fir;
+  s_fir = fir;
+  s_fir_rate = info.sample_rate;
+  xSemaphoreGive(s_pipeline_lock);
+  fir_destroy(old);
+  if (fir != NULL) {
+    ESP_LOGI(TAG, "Room correction: %u taps, %u channel(s) at %" PRIu32 " Hz, %d ms latency",
+             (unsigned)info.taps, info.channels, info.sample_rate,
+             FIR_PARTITION_FRAMES * 1000 / (int)info.sample_rate);
+  }
+  return ESP_OK;
+}
+
+int audio_get_pipeline_stats(pipeline_stage_stats_t *stats, int max) {
+  return pipeline_get_stats(&s_pipeline, stats, max);
+}
+
+bool audio_set_stage_enabled(const char *name, bool enabled) {
+  return pipeline_set_enabled(&s_pipeline, name, enabled);
+}
+
+// spdif_write() blocks until the DMA has room, which it always makes in time
+static esp_err_t spdif_sink_write(void *ctx, const uint8_t *data, size_t len, TickType_t timeout) {
+  spdif_write(data, len);
+  return ESP_OK;
+}
+
+static const sink_ops_t s_spdif_sink = {
+  .name = "spdif",
+  .write = spdif_sink_write,
+};
+
+static esp_err_t i2s_sink_write(void *ctx, const uint8_t *data, size_t len, TickType_t timeout) {
+  return i2s_output_write(data, len, timeout);
+}
+
+static const sink_ops_t s_i2s_sink = {
+  .name = "i2s",
+  .write = i2s_sink_write,
+};
+
+void audio_direct_write(uint8_t *data, int64_t arrival_us) {
 #ifdef IS_USB
-  // Check if we have a valid DAC handle before writing
-  // Reset silence tracking
+  // While the DAC re-enumerates, and until the audio buffered meanwhile has
+  // been played, go through the buffer so chunks stay in order
+  if (s_resume_on_attach || s_draining_backlog) {
+    audio_write(data, arrival_us);
+    return;
+  }
+#endif
+  process_chunk(data, arrival_us);
+}
+
+// Hand buffered chunks to the outputs while the primary one has room,
+// returns false if the buffer ran empty
+static bool drain_chunks(void) {
+  while (playing) {
+    if (!sink_primary_has_room()) {
+      s_stats.sink_full++;
+      return true;
+    }
+    int64_t arrival_us;
+    uint8_t *data = pop_chunk(&arrival_us);
+    if (!data) {
+#ifdef IS_USB
+      s_draining_backlog = false;
+#endif
+      return false;
+    }
+    process_chunk(data, arrival_us);
+    s_stats.chunks_written++;
+  }
+  return true;
+}
+
+// Audio arrived, restart the silence timer
+static void reset_silence(void) {
   is_silent = false;
   silence_duration_ms = 0;
-  last_audio_time = xTaskGetTickCount(); // Reset to current time
-  if (spkr_handle != NULL) {
-    uac_host_device_write(spkr_handle, data, PCM_CHUNK_SIZE, portMAX_DELAY);
-  } else {
-    // DAC is not connected - we should be in sleep mode
-    ESP_LOGD(TAG, "Attempted write with no DAC");
+  last_audio_time = xTaskGetTickCount();
+}
+
+// Track how long the stream has been silent and enter sleep mode past the threshold
+static void update_silence(void) {
+  if (device_sleeping) {
+    return;
   }
+  TickType_t current_time = xTaskGetTickCount();
+  if (!is_silent) {
+      is_silent = true;
+      last_audio_time = current_time; // Start the silence timer
+      s_next_silence_log_ms = SILENCE_LOG_INTERVAL_MS;
+  }
+  
+  // Unsigned subtraction handles tick counter rollover
+  silence_duration_ms = (current_time - last_audio_time) * portTICK_PERIOD_MS;
+  
+  // Only log occasionally to avoid spamming
+  if (silence_duration_ms >= s_next_silence_log_ms) {
+      ESP_LOGI(TAG, "Silence duration: %" PRIu32 " ms", silence_duration_ms);
+      s_next_silence_log_ms += SILENCE_LOG_INTERVAL_MS;
+  }
+  
+  // Check if silence threshold is reached - use config value
+  app_config_t *config = config_manager_get_config();
+  if (silence_duration_ms >= config->silence_threshold_ms) {
+      ESP_LOGI(TAG, "Silence threshold reached (%" PRIu32 " ms), entering sleep mode", 
+              silence_duration_ms);
+      s_stats.silence_sleeps++;
+#ifdef IS_USB
+      s_wake_us = 0;
 #endif
-#ifdef IS_SPDIF
-  spdif_write(data, PCM_CHUNK_SIZE);
-#endif
+      
+      // Trigger sleep mode
+      enter_silence_sleep_mode();
+  }
+}
+
+// Audible audio while asleep counts towards waking, see network_monitor_task()
+static void note_activity(void) {
+  if (monitoring_active) {
+    packet_counter++;
+    last_packet_time = xTaskGetTickCount();
+    if (s_network_activity_event_group != NULL) {
+      xEventGroupSetBits(s_network_activity_event_group, NETWORK_PACKET_RECEIVED_BIT);
+    }
+  }
+}
+
+void audio_reset_silence(void) {
+  s_silence_reset = true;
+  audio_notify();
+}
+
+// Runs on the PCM handler only, so the silence timer and the sleep it leads
+// to never race. Audible chunks since the last look restart the timer,
+// anything else, silent chunks or none at all, lets it run.
+static void track_silence(void) {
+  uint32_t audible = s_audible_chunks;
+  if (s_silence_reset || audible != s_audible_chunks_seen) {
+    s_silence_reset = false;
+    s_audible_chunks_seen = audible;
+    reset_silence();
+    return;
+  }
+  update_silence();
 }
 
 void pcm_handler(void*) {
@@ -91,86 +553,447 @@ void pcm_handler(void*) {
   last_audio_time = xTaskGetTickCount();
   
   while (true) {
-      if (playing) {
-          uint8_t *data = pop_chunk();
-          TickType_t current_time = xTaskGetTickCount();
-          
-          if (data) {
-              if (is_silent) {
-                  is_silent = false;
-              }
-              silence_duration_ms = 0;
-              last_audio_time = xTaskGetTickCount(); // Reset to current time
-
-              
-              // Process the audio data
-#ifdef IS_USB
-              if (spkr_handle != NULL) {
-                  uac_host_device_write(spkr_handle, data, PCM_CHUNK_SIZE, portMAX_DELAY);
-              } else {
-                  // DAC is not connected but we're trying to play - should enter sleep
-                  ESP_LOGW(TAG, "PCM handler tried to write with no DAC");
-                  playing = false; // Force playback to stop
-              }
-#endif
-#ifdef IS_SPDIF
-              spdif_write(data, PCM_CHUNK_SIZE);
-#endif
-          } else {
-              // pop_chunk() returned NULL - NO PACKETS RECEIVED - THIS IS SILENCE!
-              if (!is_silent) {
-                  is_silent = true;
-                  last_audio_time = current_time; // Start the silence timer
-              }
-              
-              // Calculate how long we've been in silence, handling tick counter rollover
-              // When current_time < last_audio_time, it means the counter has rolled over
-              if (current_time < last_audio_time) {
-                  // Handle rollover: calculate time until max value, then add time since 0
-                  silence_duration_ms = ((portMAX_DELAY - last_audio_time) + current_time) * portTICK_PERIOD_MS;
-              } else {
-                  silence_duration_ms = (current_time - last_audio_time) * portTICK_PERIOD_MS;
-              }
-              
-              // Only log occasionally to avoid spamming
-              if (silence_duration_ms % 5000 == 0 && silence_duration_ms > 0) {
-                  ESP_LOGI(TAG, "Silence duration: %" PRIu32 " ms", silence_duration_ms);
-              }
-              
-              // Check if silence threshold is reached - use config value
-              app_config_t *config = config_manager_get_config();
-              if (silence_duration_ms < 30000) {
-                if (silence_duration_ms >= config->silence_threshold_ms) {
-                    ESP_LOGI(TAG, "Silence threshold reached (%" PRIu32 " ms), entering sleep mode", 
-                            silence_duration_ms);
-                    
-                    // Trigger sleep mode
-                    enter_silence_sleep_mode();
-                }
-              } else {
-                ESP_LOGI(TAG, "Absurd silence threshold ignored (%" PRIu32 " ms)", 
-                  silence_duration_ms);
-                  last_audio_time = current_time;
-              }
+      // Woken by new chunks and by the sink freeing space. While playing, also
+      // wake periodically so silence is still timed when nothing arrives.
+      TickType_t wait = playing ? pdMS_TO_TICKS(SILENCE_CHECK_INTERVAL_MS) : portMAX_DELAY;
+      ulTaskNotifyTake(pdTRUE, wait);
+      s_stats.wakeups++;
+      if (!playing) {
+          s_stats.idle_wakeups++;
+      } else {
+          uint32_t written = s_stats.chunks_written;
+          drain_chunks();
+          if (s_stats.chunks_written == written) {
+              s_stats.idle_wakeups++;
           }
       }
-      vTaskDelay(1);
+      track_silence();
   }
 }
 
-void setup_audio() {
-#ifdef IS_SPDIF
-  // Get configuration for sample rate
+void audio_write(uint8_t *data, int64_t arrival_us) {
+  if (push_chunk(data, arrival_us)) {
+    audio_notify();
+  }
+}
+
+#ifdef IS_USB
+// While asleep only audio worth waking for is buffered, from its first audible
+// chunk on, so the DAC can start meanwhile without the start being clipped
+static void buffer_while_asleep(uint8_t *chunk, int64_t arrival_us, bool silent) {
+  if (s_wake_us == 0) {
+    if (silent) {
+      return;
+    }
+    // Whatever is left from before sleep is stale
+    empty_buffer();
+    s_wake_us = arrival_us;
+    s_wake_chunks = 0;
+  } else if (silent && s_wake_chunks >= MAX_BUFFER_SIZE) {
+    // A blip too short to wake for, start over at the next audible chunk
+    s_wake_us = 0;
+    return;
+  }
+  s_wake_chunks++;
+  audio_write(chunk, arrival_us);
+}
+#endif
+
+// Hand a complete chunk, one block per lane, to the buffer or straight to the outputs
+static void emit_chunk(uint8_t *chunk, int64_t arrival_us) {
+  s_silence.threshold = config_manager_get_config()->silence_amplitude_threshold;
+  uint32_t start = esp_cpu_get_cycle_count();
+  bool silent = silence_update(&s_silence, (const int16_t *)chunk, PCM_CHUNK_SIZE * s_lanes / 2);
+  uint32_t cycles = esp_cpu_get_cycle_count() - start;
+  if (cycles > s_stats.silence_max_cycles) {
+    s_stats.silence_max_cycles = cycles;
+  }
+  if (silent) {
+    s_stats.silent_chunks++;
+  } else {
+    s_audible_chunks = s_audible_chunks + 1;
+    note_activity();
+  }
+  // The handler times silence, it only wakes by itself while playing
+  if (!playing) {
+    audio_notify();
+  }
+#ifdef IS_USB
+  if (device_sleeping) {
+    buffer_while_asleep(chunk, arrival_us, silent);
+    return;
+  }
+#endif
+  if (config_manager_get_config()->use_direct_write) {
+    audio_direct_write(chunk, arrival_us);
+  } else {
+    audio_write(chunk, arrival_us);
+  }
+}
+
+// Lane 0 plays the receiver's channel setting, the others the pair of a USB DAC zone
+static void build_lane_maps(void) {
   app_config_t *config = config_manager_get_config();
-  esp_err_t err = spdif_init(config->sample_rate);
-  if (err == ESP_OK) {
-    ESP_LOGI(TAG, "Initialized SPDIF with pin %d and sample rate: %" PRIu32, config->spdif_data_pin, config->sample_rate);
+  channel_map_t *map = &s_lane_maps[0];
+  memset(map, 0, sizeof(*map));
+  map->mode = (channel_map_mode_t)config->channel_mode;
+  map->channel = map->mode == CHANNEL_MAP_PAIR ? config->channel_select * 2 : config->channel_select;
+  if (map->mode == CHANNEL_MAP_DOWNMIX
+      && (config->downmix_matrix[0] == '\0' || !channel_map_parse_matrix(config->downmix_matrix, map->matrix))) {
+    channel_map_default_matrix(&s_stream_format, map->matrix);
+  }
+  s_passthrough = s_lanes == 1 && channel_map_is_identity(map, &s_stream_format);
+#ifdef IS_USB
+  for (int zone = 0; zone < USB_DAC_MAX; zone++) {
+    int lane = usb_dac_zone_lane(zone);
+    if (lane > 0 && lane < s_lanes) {
+      memset(&s_lane_maps[lane], 0, sizeof(channel_map_t));
+      s_lane_maps[lane].mode = CHANNEL_MAP_PAIR;
+      s_lane_maps[lane].channel = usb_dac_zone_pair(zone) * 2;
+    }
+  }
+#endif
+  s_maps_dirty = false;
+}
+
+// Design the configured bands for the stream rate and switch every lane over between two chunks
+static void build_eq(void) {
+  static eq_coeffs_t coeffs;
+  eq_band_t bands[EQ_MAX_BANDS];
+  int count = eq_parse_bands(config_manager_get_config()->eq_bands, bands, EQ_MAX_BANDS);
+  eq_design(bands, count < 0 ? 0 : count, s_stream_format.sample_rate, &coeffs);
+  xSemaphoreTake(s_pipeline_lock, portMAX_DELAY);
+  for (int lane = 0; lane < SINK_MAX_LANES; lane++) {
+    eq_set_coeffs(&s_eq[lane], &coeffs);
+  }
+  xSemaphoreGive(s_pipeline_lock);
+  s_eq_dirty = false;
+}
+
+// Apply the dynamics settings to every lane between two chunks
+static void build_dynamics(void) {
+  app_config_t *config = config_manager_get_config();
+  dynamics_config_t dynamics = {
+    .compressor = config->compressor_enabled,
+    .threshold_db = config->compressor_threshold_db,
+    .ratio = config->compressor_ratio,
+    .attack_ms = config->compressor_attack_ms,
+    .release_ms = config->compressor_release_ms,
+    .makeup_db = config->compressor_makeup_db,
+    .limiter = config->limiter_enabled,
+    .ceiling_db = config->limiter_ceiling_db,
+    .lookahead_ms = config->lookahead_ms,
+  };
+  xSemaphoreTake(s_pipeline_lock, portMAX_DELAY);
+  for (int lane = 0; lane < s_lanes; lane++) {
+    dynamics_configure(&s_dynamics[lane], &dynamics, s_stream_format.sample_rate);
+  }
+  xSemaphoreGive(s_pipeline_lock);
+  s_dynamics_dirty = false;
+}
+
+// Map whole stream frames into the lane chunks, emitting each chunk as it fills
+static void map_frames(const uint8_t *in, size_t frames, int64_t arrival_us) {
+  const size_t frame_bytes = (size_t)s_stream_format.channels * (s_stream_format.bit_depth / 8);
+  while (frames > 0) {
+    size_t n = CHUNK_FRAMES - s_assembled_frames;
+    if (n > frames) {
+      n = frames;
+    }
+    for (int lane = 0; lane < s_lanes; lane++) {
+      int16_t *out = (int16_t *)(s_assembly + lane * PCM_CHUNK_SIZE) + s_assembled_frames * 2;
+      channel_map_process(&s_lane_maps[lane], &s_stream_format, in, n, out);
+    }
+    s_assembled_frames += n;
+    in += n * frame_bytes;
+    frames -= n;
+    if (s_assembled_frames == CHUNK_FRAMES) {
+      emit_chunk(s_assembly, arrival_us);
+      s_assembled_frames = 0;
+    }
+  }
+}
+
+// How much later than the stream's own pace a packet reached the receiver, per
+// power mode. Packets are sent a fixed amount of audio apart, so arrival time
+// minus the audio time before the packet stays constant while each one is
+// handled straight away. Whatever a packet spends waiting for the radio or the
+// CPU to wake from light sleep adds to its offset from the earliest one.
+static void note_delivery(const scream_format_t *format, int64_t arrival_us) {
+  uint32_t bytes_per_second = format->sample_rate * format->channels * (format->bit_depth / 8);
+  if (bytes_per_second == 0) {
+    return;
+  }
+  if (s_delivery_start_us == 0 || arrival_us - s_delivery_last_us > DELIVERY_RESET_US) {
+    s_delivery_start_us = arrival_us;
+    s_delivery_bytes = 0;
+    s_delivery_reference_us = 0;
   } else {
-    ESP_LOGE(TAG, "Failed to initialize SPDIF with pin %d and sample rate %" PRIu32 ": %s", 
-             config->spdif_data_pin, config->sample_rate, esp_err_to_name(err));
-    ESP_LOGW(TAG, "Audio output will not be available. Please check the SPDIF pin configuration in the web UI.");
-    // Continue running - we won't have audio output but the web UI will still work
+    // Inter-arrival jitter as in RFC 3550, the gap's deviation from one packet of audio smoothed by 1/16
+    int32_t deviation = (int32_t)(arrival_us - s_delivery_last_us
+                                  - (int64_t)PCM_CHUNK_SIZE * 1000000 / bytes_per_second);
+    if (deviation < 0) {
+      deviation = -deviation;
+    }
+    s_stats.jitter_us += (deviation - (int32_t)s_stats.jitter_us) / 16;
+  }
+  s_delivery_last_us = arrival_us;
+  int64_t offset = arrival_us - s_delivery_start_us - (int64_t)(s_delivery_bytes * 1000000 / bytes_per_second);
+  s_delivery_bytes += PCM_CHUNK_SIZE;
+  if (offset < s_delivery_reference_us + DELIVERY_DRIFT_US) {
+    s_delivery_reference_us = offset;
+  } else {
+    s_delivery_reference_us += DELIVERY_DRIFT_US;
+  }
+
+  uint32_t delay = (uint32_t)(offset - s_delivery_reference_us);
+  power_mode_t mode = power_get_mode();
+  // Exponential moving average with a 1/16 weight
+  s_stats.delivery_delay_avg_us[mode] += ((int32_t)delay - (int32_t)s_stats.delivery_delay_avg_us[mode]) / 16;
+  if (delay > s_stats.delivery_delay_max_us[mode]) {
+    s_stats.delivery_delay_max_us[mode] = delay;
+  }
+}
+
+void audio_receive(uint8_t *packet, int64_t arrival_us) {
+  scream_format_t format;
+  if (!scream_parse_header(packet, &format)) {
+    s_stats.bad_headers++;
+    return;
+  }
+  if (memcmp(&format, &s_stream_format, sizeof(format)) != 0) {
+    ESP_LOGI(TAG, "Stream format: %" PRIu32 " Hz, %d bit, %d channels (mask 0x%03x)",
+             format.sample_rate, format.bit_depth, format.channels, format.channel_mask);
+    s_stream_format = format;
+    s_delivery_start_us = 0;
+    s_assembled_frames = 0;
+    s_carry_len = 0;
+    s_maps_dirty = true;
+    s_eq_dirty = true;
+    s_dynamics_dirty = true;
+  }
+  if (s_maps_dirty) {
+    build_lane_maps();
+  }
+  if (s_eq_dirty) {
+    build_eq();
+  }
+  if (s_dynamics_dirty) {
+    build_dynamics();
+  }
+  note_delivery(&format, arrival_us);
+
+  uint8_t *payload = packet + SCREAM_HEADER_SIZE;
+  if (s_passthrough) {
+    emit_chunk(payload, arrival_us);
+    return;
+  }
+
+  uint32_t start = esp_cpu_get_cycle_count();
+  const size_t frame_bytes = (size_t)format.channels * (format.bit_depth / 8);
+  const uint8_t *in = payload;
+  size_t avail = PCM_CHUNK_SIZE;
+  // Frames don't always divide the payload, finish the one the last packet started
+  if (s_carry_len > 0) {
+    size_t need = frame_bytes - s_carry_len;
+    memcpy(s_carry + s_carry_len, in, need);
+    in += need;
+    avail -= need;
+    s_carry_len = 0;
+    map_frames(s_carry, 1, arrival_us);
+  }
+  size_t frames = avail / frame_bytes;
+  map_frames(in, frames, arrival_us);
+  s_carry_len = avail - frames * frame_bytes;
+  memcpy(s_carry, in + frames * frame_bytes, s_carry_len);
+
+  uint32_t cycles = esp_cpu_get_cycle_count() - start;
+  if (cycles > s_stats.channel_map_max_cycles) {
+    s_stats.channel_map_max_cycles = cycles;
+  }
+  // Exponential moving average with a 1/16 weight
+  s_stats.channel_map_avg_cycles += ((int32_t)cycles - (int32_t)s_stats.channel_map_avg_cycles) / 16;
+}
+
+void audio_update_channel_map(void) {
+  s_maps_dirty = true;
+}
+
+void audio_update_eq(void) {
+  s_eq_dirty = true;
+}
+
+void audio_update_dynamics(void) {
+  s_dynamics_dirty = true;
+}
+
+int audio_get_levels(meter_levels_t *levels, int max) {
+  int lanes = s_lanes < max ? s_lanes : max;
+  taskENTER_CRITICAL(&s_meter_lock);
+  memcpy(levels, s_levels, sizeof(meter_levels_t) * lanes);
+  memset(s_levels, 0, sizeof(s_levels));
+  taskEXIT_CRITICAL(&s_meter_lock);
+  return lanes;
+}
+
+void audio_set_scope_enabled(bool enabled) {
+  s_scope_enabled = enabled;
+}
+
+uint32_t audio_get_scope(int16_t *mono) {
+  taskENTER_CRITICAL(&s_meter_lock);
+  meter_scope_read(&s_scope, mono);
+  taskEXIT_CRITICAL(&s_meter_lock);
+  return s_stream_format.sample_rate;
+}
+
+unsigned int audio_lane_count(void) {
+  unsigned int lanes = 1;
+#ifdef IS_USB
+  for (int zone = 0; zone < USB_DAC_MAX; zone++) {
+    if (usb_dac_zone_pair(zone) >= 0) {
+      lanes++;
+    }
+  }
+#endif
+  return lanes;
+}
+
+void audio_notify(void) {
+  if (s_pcm_task_handle != NULL) {
+    xTaskNotifyGive(s_pcm_task_handle);
+  }
+}
+
+uint32_t audio_get_jitter_us(void) {
+  return s_stats.jitter_us;
+}
+
+void audio_get_stats(audio_stats_t *stats) {
+  *stats = s_stats;
+  stats->stream_sample_rate = s_stream_format.sample_rate;
+  stats->stream_bit_depth = s_stream_format.bit_depth;
+  stats->stream_channels = s_stream_format.channels;
+  stats->stream_channel_mask = s_stream_format.channel_mask;
+  stats->lanes = s_lanes;
+  if (s_dynamics != NULL) {
+    dynamics_get_reduction(&s_dynamics[0], &stats->gain_reduction_db, &stats->gain_reduction_peak_db);
+  }
+  if (s_fir != NULL) {
+    stats->fir_taps = s_fir->taps;
+    stats->fir_sample_rate = s_fir_rate;
+    stats->fir_active = s_fir_rate == s_stream_format.sample_rate;
+  }
+  // Latency and drops are reported for the output that paces the stream
+  sink_stats_t sinks[SINK_MAX];
+  int count = sink_get_stats(sinks, SINK_MAX);
+  for (int i = 0; i < count; i++) {
+    if (sinks[i].primary) {
+      stats->write_timeouts = sinks[i].dropped;
+      stats->latency_last_us = sinks[i].latency_last_us;
+      stats->latency_avg_us = sinks[i].latency_avg_us;
+      stats->latency_max_us = sinks[i].latency_max_us;
+    }
   }
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+  if (s_pcm_task_handle != NULL) {
+    stats->run_time = ulTaskGetRunTimeCounter(s_pcm_task_handle);
+  }
+#endif
+#ifdef IS_USB
+  usb_dac_info_t dac;
+  usb_dac_get_info(&dac, 1);
+  stats->dac_sample_rate = dac.sample_rate;
+  stats->dac_bit_depth = dac.bit_depth;
+  stats->converter_avg_cycles = dac.converter_avg_cycles;
+  stats->converter_max_cycles = dac.converter_max_cycles;
 #endif
-  xTaskCreatePinnedToCore(pcm_handler, "pcm_handler", 16384, NULL, 1, NULL, 1);
+}
+
+void audio_set_sample_rate(uint32_t rate) {
+  if (s_spdif_enabled) {
+    esp_err_t err = spdif_set_sample_rates(rate);
+    if (err != ESP_OK) {
+      ESP_LOGE(TAG, "Failed to change S/PDIF sample rate: %s", esp_err_to_name(err));
+    }
+  }
+  if (s_i2s_enabled) {
+    esp_err_t err = i2s_output_set_sample_rate(rate);
+    if (err != ESP_OK) {
+      ESP_LOGE(TAG, "Failed to change I2S sample rate: %s", esp_err_to_name(err));
+    }
+  }
+}
+
+// The storage partition only holds the room correction response
+static void mount_storage(void) {
+  esp_vfs_spiffs_conf_t conf = {
+    .base_path = "/storage",
+    .partition_label = "storage",
+    .max_files = 2,
+    .format_if_mount_failed = true,
+  };
+  esp_err_t err = esp_vfs_spiffs_register(&conf);
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG, "Storage partition not mounted, no room correction: %s", esp_err_to_name(err));
+  }
+}
+
+void setup_audio() {
+  app_config_t *config = config_manager_get_config();
+  silence_init(&s_silence, config->silence_amplitude_threshold);
+  for (int lane = 0; lane < SINK_MAX_LANES; lane++) {
+    gain_init(&s_gain[lane], config->volume, GAIN_RAMP_LINEAR);
+    eq_init(&s_eq[lane]);
+  }
+  // Must match the lanes setup_buffer() was given
+  s_lanes = audio_lane_count();
+  s_assembly = heap_caps_malloc(PCM_CHUNK_SIZE * s_lanes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  s_dynamics = heap_caps_malloc(sizeof(dynamics_t) * s_lanes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  s_pipeline_lock = xSemaphoreCreateMutex();
+  bool pipeline_ready = pipeline_init(&s_pipeline, CHUNK_FRAMES, s_lanes);
+  assert(s_assembly != NULL && s_dynamics != NULL && s_pipeline_lock != NULL && pipeline_ready);
+  for (int lane = 0; lane < s_lanes; lane++) {
+    dynamics_init(&s_dynamics[lane]);
+  }
+  // Stages run in order on every chunk: the stream is already decoded to stereo
+  // lanes on arrival and each USB DAC resamples to its own rate on its output task
+  pipeline_add_stage(&s_pipeline, &(pipeline_stage_t){ .name = "fir", .process = fir_stage_process }, true);
+  pipeline_add_stage(&s_pipeline, &(pipeline_stage_t){ .name = "eq", .process = eq_stage_process }, true);
+  pipeline_add_stage(&s_pipeline, &(pipeline_stage_t){ .name = "dynamics", .process = dynamics_stage_process }, true);
+  pipeline_add_stage(&s_pipeline, &(pipeline_stage_t){ .name = "gain", .process = gain_stage_process }, true);
+  pipeline_add_stage(&s_pipeline, &(pipeline_stage_t){ .name = "meter", .process = meter_stage_process }, true);
+  mount_storage();
+  esp_err_t fir_err = audio_load_fir(AUDIO_FIR_PATH);
+  if (fir_err != ESP_OK && fir_err != ESP_ERR_NOT_FOUND) {
+    ESP_LOGW(TAG, "Room correction response not loaded: %s", esp_err_to_name(fir_err));
+  }
+  // The outputs pull from the buffer at the pace of the primary one
+  sink_set_room_callback(audio_notify);
+#ifdef IS_USB
+  ESP_ERROR_CHECK(usb_dac_init(note_first_sample));
+#endif
+  if (config->enable_spdif_output) {
+    esp_err_t err = spdif_init(config->sample_rate);
+    if (err == ESP_OK) {
+      ESP_LOGI(TAG, "Initialized SPDIF with pin %d and sample rate: %" PRIu32, config->spdif_data_pin, config->sample_rate);
+      s_spdif_enabled = sink_register(&s_spdif_sink, SINK_DROP_OLDEST, false) == ESP_OK;
+    } else {
+      ESP_LOGE(TAG, "Failed to initialize SPDIF with pin %d and sample rate %" PRIu32 ": %s", 
+               config->spdif_data_pin, config->sample_rate, esp_err_to_name(err));
+      ESP_LOGW(TAG, "S/PDIF output will not be available. Please check the SPDIF pin configuration in the web UI.");
+      // Continue running - the other outputs and the web UI still work
+    }
+  }
+  if (config->enable_i2s_output) {
+    esp_err_t err = i2s_output_init(config->sample_rate);
+    if (err == ESP_OK) {
+      ESP_LOGI(TAG, "Initialized I2S DAC (bck %d, ws %d, data %d) at %" PRIu32 " Hz",
+               config->i2s_bck_pin, config->i2s_ws_pin, config->i2s_data_pin, config->sample_rate);
+      s_i2s_enabled = sink_register(&s_i2s_sink, SINK_DROP_OLDEST, false) == ESP_OK;
+    } else {
+      ESP_LOGW(TAG, "I2S DAC output will not be available. Please check the I2S pin configuration in the web UI.");
+    }
+  }
+  xTaskCreatePinnedToCore(pcm_handler, "pcm_handler", 16384, NULL, 1, &s_pcm_task_handle, 1);
 }
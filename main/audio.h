@@ -1,5 +1,11 @@
 #pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
 #include "config.h"
+#include "pipeline.h"
+#include "meter.h"
+#include "power.h"
 #ifdef IS_USB
 #include "usb/uac_host.h"
 #endif
@@ -7,10 +13,104 @@ void process_audio_actions(bool is_startup);
 void register_button(int button,void (*action)(bool, int, void *));
 void setup_audio();
 #ifdef IS_USB
-void start_playback(uac_host_device_handle_t _spkr_handle);
+// Called when a DAC enumerates, returns its zone or -1. The primary DAC (zone 0)
+// resumes straight away if it was unplugged during playback, others join the stream.
+int start_playback(uac_host_device_handle_t _spkr_handle);
+// Called when a DAC is unplugged, invalidates its handle. For the primary DAC
+// audio is buffered until it returns.
+void audio_dac_detached(uac_host_device_handle_t handle);
+// Milliseconds since the DAC was unplugged, 0 while attached
+uint32_t audio_dac_detached_ms(void);
+// Leave silence sleep: restart the DACs and play the audio buffered since the
+// first audible chunk arrived, so the start of it isn't lost
+void audio_wake_from_sleep(void);
 #endif
 void stop_playback();
-void audio_write(uint8_t* data);
-void audio_direct_write(uint8_t *data);
+// Take a Scream packet, header included. 16-bit stereo goes through as is, other
+// formats are mapped to stereo per lane and regrouped into whole chunks.
+void audio_receive(uint8_t *packet, int64_t arrival_us);
+// Queue a chunk, one PCM_CHUNK_SIZE block per lane, arrival_us is when its packet was received
+void audio_write(uint8_t* data, int64_t arrival_us);
+// Hand a chunk, one block per lane, straight to the outputs without buffering, never blocks
+void audio_direct_write(uint8_t *data, int64_t arrival_us);
+// Counters of every processing stage between the buffer and the outputs
+int audio_get_pipeline_stats(pipeline_stage_stats_t *stats, int max);
+// Switch a processing stage on or off by name, false if there is no such stage
+bool audio_set_stage_enabled(const char *name, bool enabled);
+// Re-read the channel settings before the next packet
+void audio_update_channel_map(void);
+// Re-read the equaliser bands before the next packet
+void audio_update_eq(void);
+// Re-read the compressor and limiter settings before the next packet
+void audio_update_dynamics(void);
+// Take the levels of every lane metered since the last call, returns the lanes written
+int audio_get_levels(meter_levels_t *levels, int max);
+// Keep the last METER_FFT_SIZE samples of the receiver's own mix for audio_get_scope()
+void audio_set_scope_enabled(bool enabled);
+// Copy those samples out mixed to mono, oldest first, returns the stream rate
+uint32_t audio_get_scope(int16_t *mono);
+// Where the room correction impulse response is kept, a WAV of 1 or 2 channels
+#define AUDIO_FIR_PATH "/storage/fir.wav"
+// Build the room correction filter from an impulse response WAV and switch to it,
+// NULL to remove the filter. Returns ESP_ERR_NOT_FOUND for a missing file,
+// ESP_ERR_INVALID_ARG for one that isn't a usable WAV, ESP_ERR_INVALID_SIZE
+// past FIR_MAX_TAPS and ESP_ERR_NO_MEM, keeping the current filter on error.
+esp_err_t audio_load_fir(const char *path);
+// Stereo mixes each chunk carries, the receiver's own plus one per USB DAC zone bound to a pair
+unsigned int audio_lane_count(void);
+void audio_set_volume(float volume);
+// Change the rate of the S/PDIF and I2S outputs, the USB DAC picks it up when playback resumes
+void audio_set_sample_rate(uint32_t rate);
 void resume_playback();
-bool is_playing();
\ No newline at end of file
+bool is_playing();
+
+// Counters for the PCM handler task
+typedef struct {
+    uint32_t wakeups;          // Times the handler woke up
+    uint32_t idle_wakeups;     // Wakeups that wrote nothing
+    uint32_t chunks_written;   // Chunks handed to the outputs from the buffer
+    uint32_t sink_full;        // Times the buffer was left alone because the primary output was full
+    uint32_t run_time;         // Handler run time counter, 0 without FreeRTOS run time stats
+    uint32_t write_timeouts;   // Chunks the primary output dropped because it stayed full
+    uint32_t latency_last_us;  // Packet arrival to primary output submission, last chunk
+    uint32_t latency_avg_us;   // Packet arrival to primary output submission, moving average
+    uint32_t latency_max_us;   // Packet arrival to primary output submission, worst case
+    uint32_t replugs;                 // DAC replugs resumed during playback
+    uint32_t time_to_first_sample_us; // Last replug, DAC enumerated to first chunk accepted
+    uint32_t replug_gap_ms;           // Last replug, unplug to first chunk accepted
+    uint32_t dac_sample_rate;         // Rate negotiated with the DAC, 0 before it starts
+    uint8_t dac_bit_depth;            // Bit depth negotiated with the DAC
+    uint32_t converter_avg_cycles;    // Format conversion cost per chunk, 0 when not converting
+    uint32_t converter_max_cycles;    // Format conversion cost per chunk, worst case
+    uint32_t stream_sample_rate;      // Format of the last Scream packet
+    uint8_t stream_bit_depth;
+    uint8_t stream_channels;
+    uint16_t stream_channel_mask;
+    uint8_t lanes;                    // Stereo mixes carried per chunk
+    uint32_t bad_headers;             // Packets dropped for a format the receiver can't play
+    uint32_t channel_map_avg_cycles;  // Channel mapping cost per packet, 0 for plain stereo
+    uint32_t channel_map_max_cycles;  // Channel mapping cost per packet, worst case
+    uint32_t fir_taps;                // Room correction response length, 0 without one
+    uint32_t fir_sample_rate;         // Rate of the response, it only runs on streams of this rate
+    bool fir_active;                  // The response matches the stream and is being applied
+    float gain_reduction_db;          // Compressor and limiter on the receiver's own mix, now
+    float gain_reduction_peak_db;     // Most since the last time the counters were read
+    uint32_t silent_chunks;           // Chunks at or below silence_amplitude_threshold
+    uint32_t silence_max_cycles;      // Silence detection cost per chunk, worst case
+    uint32_t silence_sleeps;          // Times silence put the receiver to sleep
+    uint32_t wakes;                   // Times audio woke the receiver from silence sleep
+    uint32_t wake_dac_start_us;       // Last wake, time the DACs took to restart
+    uint32_t wake_to_sound_us;        // Last wake, first audible chunk to first chunk accepted
+    uint32_t delivery_delay_avg_us[POWER_MODE_COUNT]; // Packet arrival behind the stream's pace, per power mode
+    uint32_t delivery_delay_max_us[POWER_MODE_COUNT];
+    uint32_t jitter_us;               // Packet inter-arrival jitter, smoothed
+    uint32_t boot_to_first_audio_ms;  // App start to the first chunk handed to the outputs
+} audio_stats_t;
+
+// Wake the PCM handler, called when a chunk is buffered or the sink has room
+void audio_notify(void);
+// Restart the silence timer, from any task, so a wake doesn't go straight back to sleep
+void audio_reset_silence(void);
+void audio_get_stats(audio_stats_t *stats);
+// Packet inter-arrival jitter alone, without the side effects of reading all stats
+uint32_t audio_get_jitter_us(void);
\ No newline at end of file
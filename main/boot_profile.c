@@ -0,0 +1,44 @@
+#include "boot_profile.h"
+#include "config.h"
+#include <inttypes.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static boot_stage_t s_stages[BOOT_PROFILE_MAX_STAGES];
+static size_t s_stage_count = 0;
+static portMUX_TYPE s_stage_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void boot_profile_mark(const char *name) {
+    boot_stage_t stage = {
+        .name = name,
+        .at_ms = (uint32_t)(esp_timer_get_time() / 1000),
+        .core = xPortGetCoreID(),
+    };
+    bool recorded = false;
+    taskENTER_CRITICAL(&s_stage_lock);
+    bool seen = false;
+    for (size_t i = 0; i < s_stage_count; i++) {
+        if (strcmp(s_stages[i].name, name) == 0) {
+            seen = true;
+            break;
+        }
+    }
+    if (!seen && s_stage_count < BOOT_PROFILE_MAX_STAGES) {
+        s_stages[s_stage_count++] = stage;
+        recorded = true;
+    }
+    taskEXIT_CRITICAL(&s_stage_lock);
+    if (recorded) {
+        ESP_LOGI(TAG, "Boot: %s after %" PRIu32 " ms on core %d", name, stage.at_ms, stage.core);
+    }
+}
+
+size_t boot_profile_get(boot_stage_t *stages, size_t max_stages) {
+    taskENTER_CRITICAL(&s_stage_lock);
+    size_t count = s_stage_count < max_stages ? s_stage_count : max_stages;
+    memcpy(stages, s_stages, count * sizeof(boot_stage_t));
+    taskEXIT_CRITICAL(&s_stage_lock);
+    return count;
+}
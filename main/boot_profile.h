@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BOOT_PROFILE_MAX_STAGES 16
+
+// An init step and when it finished, see boot_profile_get()
+typedef struct {
+    const char *name;       // Static name of the step
+    uint32_t at_ms;         // Time since the app started, the bootloader isn't counted
+    int core;               // Core the step finished on
+} boot_stage_t;
+
+/**
+ * @brief Record that an init step finished. Only the first mark of a name is kept,
+ * so steps that run again after silence sleep or a reconnect leave the boot
+ * profile alone. Safe to call from any task on either core.
+ */
+void boot_profile_mark(const char *name);
+
+/**
+ * @brief Copy up to max_stages stages in the order they finished
+ *
+ * @return Number of stages copied
+ */
+size_t boot_profile_get(boot_stage_t *stages, size_t max_stages);
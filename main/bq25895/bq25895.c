@@ -268,6 +268,32 @@ esp_err_t bq25895_reset_watchdog(void)
     return ESP_OK;
 }
 
+/**
+ * @brief Start the ADC once or continuously
+ */
+esp_err_t bq25895_start_adc(bool continuous)
+{
+    if (!is_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Read current value of REG02
+    uint8_t value;
+    esp_err_t ret = bq25895_read_reg(BQ25895_REG_02, &value);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    // Bit 6 (CONV_RATE) converts every second, bit 7 (CONV_START) starts a single conversion
+    if (continuous) {
+        value |= (1 << 6);
+    } else {
+        value &= ~(1 << 6);
+        value |= (1 << 7);
+    }
+    return bq25895_write_reg(BQ25895_REG_02, value);
+}
+
 /**
  * @brief Get the current status of the BQ25895
  */
@@ -319,6 +345,8 @@ esp_err_t bq25895_get_status(bq25895_status_t *status)
     status->ntc_fault = reg_0c & 0x07;
 
     status->therm_stat = (reg_0e >> 7) & 0x01;
+    status->vdpm_stat = (reg_13 >> 7) & 0x01;
+    status->idpm_stat = (reg_13 >> 6) & 0x01;
 
     // Calculate voltages and currents
     status->bat_voltage = 2.304f + ((reg_0e & 0x7F) * 0.02f);
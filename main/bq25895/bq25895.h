@@ -100,6 +100,8 @@ typedef struct {
     bool bat_fault;                       /*!< Battery fault status */
     bq25895_ntc_fault_t ntc_fault;        /*!< NTC fault status */
     bool therm_stat;                      /*!< Thermal regulation status */
+    bool vdpm_stat;                       /*!< Input held at the input voltage limit */
+    bool idpm_stat;                       /*!< Input held at the input current limit */
     float bat_voltage;                    /*!< Battery voltage in volts */
     float sys_voltage;                    /*!< System voltage in volts */
     float vbus_voltage;                   /*!< VBUS voltage in volts */
@@ -237,6 +239,15 @@ esp_err_t bq25895_set_boost_voltage(uint16_t voltage_mv);
  */
 esp_err_t bq25895_reset_watchdog(void);
 
+/**
+ * @brief Start the ADC, the voltage and current readings in the status stay
+ * at their last values until it converts
+ * 
+ * @param continuous Convert once a second from now on, or only once
+ * @return ESP_OK on success
+ */
+esp_err_t bq25895_start_adc(bool continuous);
+
 /**
  * @brief Read a register from the BQ25895
  * 
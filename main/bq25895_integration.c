@@ -4,6 +4,7 @@
  */
 
 #include "bq25895_integration.h"
+#include "power.h"
 #include "bq25895/bq25895.h"
 #include "bq25895/bq25895_web.h"
 #include "esp_log.h"
@@ -46,7 +47,64 @@ static const bq25895_charge_params_t default_charge_params = {
 
 // I2C master initialization is now handled by the BQ25895 driver
 
-// Task to periodically reset the watchdog timer
+// How often the ADC is sampled for the energy report, also the watchdog reset period
+#define ENERGY_SAMPLE_INTERVAL_MS 30000
+
+// Charge current and power summed per power mode, only written by the watchdog task
+typedef struct {
+    float ma_sum;
+    float mw_sum;
+    uint32_t samples;
+} power_state_t;
+
+static power_state_t s_modes[POWER_MODE_COUNT];
+static uint32_t s_sleep_intervals = 0;
+
+// File the charge current and power under the mode the receiver is in. Only
+// samples taken while the input sits at its current limit count, otherwise the
+// charger holds its own charge current and the receiver's draw doesn't show.
+static void sample_energy(void)
+{
+    power_mode_t mode = power_get_mode();
+    if (mode == POWER_MODE_SLEEP) {
+        s_sleep_intervals++;
+    }
+    bq25895_status_t status;
+    if (bq25895_get_status(&status) != ESP_OK || !status.pg_stat || !status.idpm_stat) {
+        return;
+    }
+    power_state_t *state = &s_modes[mode];
+    state->ma_sum += status.charge_current * 1000.0f;
+    state->mw_sum += status.bat_voltage * status.charge_current * 1000.0f;
+    state->samples++;
+}
+
+static float mode_average(const power_state_t *state, float sum)
+{
+    return state->samples > 0 ? sum / state->samples : 0.0f;
+}
+
+void bq25895_integration_get_energy_report(bq25895_energy_report_t *report)
+{
+    const power_state_t *idle = &s_modes[POWER_MODE_IDLE];
+    const power_state_t *sleep = &s_modes[POWER_MODE_SLEEP];
+    report->valid = idle->samples > 0 && sleep->samples > 0;
+    report->awake_idle_mw = mode_average(idle, idle->mw_sum);
+    report->sleep_mw = mode_average(sleep, sleep->mw_sum);
+    for (int mode = 0; mode < POWER_MODE_COUNT; mode++) {
+        const power_state_t *state = &s_modes[mode];
+        report->modes[mode].samples = state->samples;
+        report->modes[mode].charge_ma = mode_average(state, state->ma_sum);
+        // What the mode draws over silence sleep, taken from the battery's share of the input
+        report->modes[mode].extra_ma = state->samples > 0 && sleep->samples > 0
+            ? mode_average(sleep, sleep->ma_sum) - report->modes[mode].charge_ma : 0.0f;
+    }
+    report->saved_mwh_per_idle_hour = report->valid ? report->sleep_mw - report->awake_idle_mw : 0.0f;
+    report->sleep_hours = s_sleep_intervals * (ENERGY_SAMPLE_INTERVAL_MS / 3600000.0f);
+    report->saved_mwh = report->saved_mwh_per_idle_hour * report->sleep_hours;
+}
+
+// Task to periodically reset the watchdog timer and sample the ADC
 static void watchdog_reset_task(void *pvParameters)
 {
     ESP_LOGI(TAG, "Watchdog reset task started");
@@ -54,7 +112,8 @@ static void watchdog_reset_task(void *pvParameters)
     while (1) {
         // Reset the watchdog timer every 30 seconds
         // The BQ25895 watchdog timer is typically 40 seconds
-        vTaskDelay(pdMS_TO_TICKS(30000));
+        vTaskDelay(pdMS_TO_TICKS(ENERGY_SAMPLE_INTERVAL_MS));
+        sample_energy();
         
         esp_err_t ret = bq25895_reset_watchdog();
         if (ret != ESP_OK) {
@@ -68,6 +127,9 @@ static void watchdog_reset_task(void *pvParameters)
         if (ret != ESP_OK) {
             ESP_LOGW(TAG, "Failed to re-enable OTG mode: %s", esp_err_to_name(ret));
         }
+
+        // A register reset from the web interface stops the ADC too
+        bq25895_start_adc(true);
     }
 }
 
@@ -83,6 +145,9 @@ esp_err_t bq25895_integration_init(void)
         .pull_down_en = GPIO_PULLDOWN_DISABLE,
         .intr_type = GPIO_INTR_DISABLE
     };
+    // Held through deep sleep by bq25895_integration_hold_usb_power()
+    gpio_hold_dis(BQ25895_CE_PIN);
+    gpio_hold_dis(BQ25895_OTG_PIN);
     ret = gpio_config(&io_conf);
     io_conf.pin_bit_mask = (1ULL << BQ25895_OTG_PIN);
     ret = gpio_config(&io_conf);
@@ -155,7 +220,6 @@ esp_err_t bq25895_integration_init(void)
         ESP_LOGI(TAG, "Watchdog reset task created");
     }
 
-    bq25895_write_reg(0x02, 0x40); // Enable refreshing battery charge level otherwise it never polls
     uint8_t value = 0;
     bq25895_read_reg(0x07, &value);
     value &= 0xE7;
@@ -167,6 +231,12 @@ esp_err_t bq25895_integration_init(void)
         ESP_LOGE(TAG, "Failed to set default charge parameters: %s", esp_err_to_name(ret));
         return ret;
     }
+
+    // The ADC only converts when asked, without this the readings never change
+    ret = bq25895_start_adc(true);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to start the charger ADC, no energy report: %s", esp_err_to_name(ret));
+    }
     
     // Initialize BQ25895 web interface
     ret = bq25895_web_init();
@@ -241,3 +311,17 @@ esp_err_t bq25895_integration_set_ce_pin(bool enable)
     ESP_LOGI(TAG, "BQ25895 CE pin set to %d (charging %s)", level, enable ? "enabled" : "disabled");
     return ESP_OK;
 }
+
+esp_err_t bq25895_integration_hold_usb_power(void)
+{
+    esp_err_t ret = gpio_hold_en(BQ25895_CE_PIN);
+    if (ret == ESP_OK) {
+        ret = gpio_hold_en(BQ25895_OTG_PIN);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to hold the charger pins: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    gpio_deep_sleep_hold_en();
+    return ESP_OK;
+}
@@ -8,6 +8,32 @@
 
 #include "esp_err.h"
 #include "bq25895/bq25895.h" // Include the main driver header for status/params structs
+#include "power.h"
+
+/**
+ * @brief What silence sleep saves, from the charger's ADC readings.
+ *
+ * The charger only measures current flowing into the battery, so power is
+ * sampled as battery voltage times charge current while on USB input. With
+ * the input at its current limit, whatever the receiver stops drawing while
+ * asleep goes into the battery instead, so the difference between the two
+ * states is the power sleep saves. It is an estimate: the ADC reads the
+ * charge current in 50mA steps, and readings are only taken while the
+ * charger reports the input at its current limit.
+ */
+typedef struct {
+    bool valid;                     /*!< Both states sampled on charger input */
+    float awake_idle_mw;            /*!< Charge power while awake on a silent stream */
+    float sleep_mw;                 /*!< Charge power in silence sleep */
+    float saved_mwh_per_idle_hour;  /*!< Energy an hour of sleep saves over staying awake */
+    float sleep_hours;              /*!< Time spent in silence sleep since boot */
+    float saved_mwh;                /*!< Energy saved since boot */
+    struct {
+        uint32_t samples;           /*!< ADC readings taken on charger input in this mode */
+        float charge_ma;            /*!< Average battery charge current in this mode, not the receiver's draw */
+        float extra_ma;             /*!< Current drawn over silence sleep, 0 until both are sampled */
+    } modes[POWER_MODE_COUNT];      /*!< Per power mode, see power.h */
+} bq25895_energy_report_t;
 
 /**
  * @brief Initialize the BQ25895 battery charger and its web interface.
@@ -58,4 +84,22 @@ esp_err_t bq25895_integration_reset(void);
  */
 esp_err_t bq25895_integration_set_ce_pin(bool enable);
 
+/**
+ * @brief Keep the CE and OTG pins at their levels through deep sleep.
+ *
+ * The boost converter keeps powering the USB port, so a DAC plugged in while
+ * asleep pulls D+ up and wakes the receiver. bq25895_integration_init()
+ * releases the pins again.
+ *
+ * @return ESP_OK on success, or an error code otherwise.
+ */
+esp_err_t bq25895_integration_hold_usb_power(void);
+
+/**
+ * @brief Get the estimate of the energy silence sleep has saved.
+ *
+ * @param report Pointer to a structure where the report will be stored.
+ */
+void bq25895_integration_get_energy_report(bq25895_energy_report_t *report);
+
 #endif // BQ25895_INTEGRATION_H
@@ -1,5 +1,6 @@
 #include "esp_psram.h"
 #include "global.h"
+#include "buffer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include <string.h>
@@ -18,10 +19,19 @@ unsigned int packet_buffer_pos              = 0;
 unsigned int target_buffer_size             = INITIAL_BUFFER_SIZE;
 // Buffer of packets to send
 uint8_t *packet_buffer[MAX_BUFFER_SIZE] = { 0 };
+// Bytes per buffered packet, one chunk per lane
+static size_t slot_size = PCM_CHUNK_SIZE;
+// Arrival time of each buffered packet, for latency measurement
+int64_t packet_arrival_us[MAX_BUFFER_SIZE] = { 0 };
 portMUX_TYPE buffer_mutex = portMUX_INITIALIZER_UNLOCKED;
+// Times the buffer ran dry during playback
+static uint32_t s_underruns = 0;
+// Fewest chunks left after a pop since buffer_get_status() last ran
+static unsigned int s_low_water = MAX_BUFFER_SIZE;
 
 void set_underrun() {
   if (!is_underrun) {
+    s_underruns++;
     received_packets = 0;
     target_buffer_size += BUFFER_GROW_STEP_SIZE;
     if (target_buffer_size >= MAX_GROW_SIZE)
@@ -31,7 +41,7 @@ void set_underrun() {
   is_underrun = true;
 }
 
-bool push_chunk(uint8_t *chunk) {
+bool push_chunk(uint8_t *chunk, int64_t arrival_us) {
   int write_position = (packet_buffer_pos + packet_buffer_size) % MAX_BUFFER_SIZE;
 //  ESP_LOGI(TAG, "memcpy(%p, %p, %i)", packet_buffer[write_position], chunk, PCM_CHUNK_SIZE); 
   taskENTER_CRITICAL(&buffer_mutex);
@@ -43,7 +53,8 @@ bool push_chunk(uint8_t *chunk) {
   }
 
   write_position = (packet_buffer_pos + packet_buffer_size) % MAX_BUFFER_SIZE;
-  memcpy(packet_buffer[write_position], chunk, PCM_CHUNK_SIZE);
+  memcpy(packet_buffer[write_position], chunk, slot_size);
+  packet_arrival_us[write_position] = arrival_us;
   packet_buffer_size++;
   received_packets++;
   if (received_packets >= target_buffer_size)
@@ -52,7 +63,7 @@ bool push_chunk(uint8_t *chunk) {
   return true;
 }
 
-uint8_t *pop_chunk() {
+uint8_t *pop_chunk(int64_t *arrival_us) {
   taskENTER_CRITICAL(&buffer_mutex);
   if (packet_buffer_size == 0) {
     taskEXIT_CRITICAL(&buffer_mutex);
@@ -64,12 +75,36 @@ uint8_t *pop_chunk() {
     return NULL;
   }
   uint8_t *return_chunk = packet_buffer[packet_buffer_pos];
+  *arrival_us = packet_arrival_us[packet_buffer_pos];
   packet_buffer_size--;
   packet_buffer_pos = (packet_buffer_pos + 1) % MAX_BUFFER_SIZE;
+  if (packet_buffer_size < s_low_water) {
+    s_low_water = packet_buffer_size;
+  }
   taskEXIT_CRITICAL(&buffer_mutex);
   return return_chunk;
 }
 
+// Drop the oldest chunks so at most keep remain
+void trim_buffer(unsigned int keep) {
+  taskENTER_CRITICAL(&buffer_mutex);
+  if (packet_buffer_size > keep) {
+    packet_buffer_pos = (packet_buffer_pos + packet_buffer_size - keep) % MAX_BUFFER_SIZE;
+    packet_buffer_size = keep;
+  }
+  taskEXIT_CRITICAL(&buffer_mutex);
+}
+
+void buffer_get_status(buffer_status_t *status) {
+  taskENTER_CRITICAL(&buffer_mutex);
+  status->fill = packet_buffer_size;
+  status->target = target_buffer_size;
+  status->low_water = s_low_water;
+  status->underruns = s_underruns;
+  s_low_water = MAX_BUFFER_SIZE;
+  taskEXIT_CRITICAL(&buffer_mutex);
+}
+
 void empty_buffer() {
 	taskENTER_CRITICAL(&buffer_mutex);
 	packet_buffer_size = 0;
@@ -77,12 +112,13 @@ void empty_buffer() {
 	taskEXIT_CRITICAL(&buffer_mutex);
 }
 
-void setup_buffer() {
-  ESP_LOGI(TAG, "Allocating buffer");
+void setup_buffer(unsigned int lanes) {
+  ESP_LOGI(TAG, "Allocating buffer for %u lane(s)", lanes);
+  slot_size = PCM_CHUNK_SIZE * lanes;
   uint8_t *buffer = 0;
-  buffer = (uint8_t *)malloc(PCM_CHUNK_SIZE * MAX_BUFFER_SIZE);
-  memset(buffer, 0, PCM_CHUNK_SIZE * MAX_BUFFER_SIZE);
+  buffer = (uint8_t *)malloc(slot_size * MAX_BUFFER_SIZE);
+  memset(buffer, 0, slot_size * MAX_BUFFER_SIZE);
   for (int i = 0; i < MAX_BUFFER_SIZE; i++)
-    packet_buffer[i] = (uint8_t *)buffer + i * PCM_CHUNK_SIZE;
+    packet_buffer[i] = (uint8_t *)buffer + i * slot_size;
   ESP_LOGI(TAG, "Buffer allocated");
 }
\ No newline at end of file
@@ -1,13 +1,24 @@
 #pragma once
 
 extern bool is_underrun;
-extern uint64_t received_packets;
-extern uint64_t packet_buffer_size;
-extern uint64_t packet_buffer_pos;
-extern uint64_t target_buffer_size;
-
-void setup_buffer();
-bool push_chunk(uint8_t *chunk);
-uint8_t *pop_chunk();
-void setup_buffer();
-void empty_buffer();
\ No newline at end of file
+extern unsigned int received_packets;
+extern unsigned int packet_buffer_size;
+extern unsigned int packet_buffer_pos;
+extern unsigned int target_buffer_size;
+
+// Allocate the ring, each packet holds one PCM_CHUNK_SIZE chunk per lane
+void setup_buffer(unsigned int lanes);
+bool push_chunk(uint8_t *chunk, int64_t arrival_us);
+uint8_t *pop_chunk(int64_t *arrival_us);
+void empty_buffer();
+void trim_buffer(unsigned int keep);
+
+typedef struct {
+  unsigned int fill;          // Chunks buffered now
+  unsigned int target;        // Chunks buffered again after an underrun before playing
+  unsigned int low_water;     // Fewest chunks left since the last call, MAX_BUFFER_SIZE if none were played
+  uint32_t underruns;         // Times the buffer ran dry while playing
+} buffer_status_t;
+
+// Read the fill level, resets the low water mark
+void buffer_get_status(buffer_status_t *status);
\ No newline at end of file
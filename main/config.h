@@ -18,8 +18,18 @@
 //Volume 0.0f-1.0f
 #define VOLUME 1.0f
 
-// Time to wake from deep sleep to check for DAC (in ms)
+// Time to wake from deep sleep to check for DAC (in ms), the first check of a deep sleep
 #define DAC_CHECK_SLEEP_TIME_MS 2000
+// Longest interval the checks back off to while no DAC shows up
+#define DAC_CHECK_MAX_SLEEP_MS 60000
+// Checks the wake stub makes before the app boots to look for a DAC it can't see on D+
+#define DAC_CHECK_BOOT_EVERY 8
+// How long a boot from deep sleep waits for the DAC to enumerate before sleeping again
+#define DAC_WAKE_GRACE_MS 2000
+// USB D+ pad, a full speed DAC pulls it up as soon as it has power
+#define USB_DP_GPIO 20
+// How long an unplugged DAC may take to come back before deep sleep, fixed at compile time
+#define DAC_REPLUG_GRACE_MS 10000
 
 // Sleep on silence configuration
 #define SILENCE_THRESHOLD_MS 30000       // Sleep after 10 seconds of silence
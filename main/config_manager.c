@@ -3,11 +3,18 @@
 #include "esp_log.h"
 #include "nvs_flash.h"
 #include "nvs.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include <string.h>
+#include <inttypes.h>
 
 // Store the active configuration
 static app_config_t s_app_config;
 
+// Quiet period after the last deferred change before it is written to NVS
+#define CONFIG_FLUSH_QUIET_MS 2000
+
 // NVS keys for different config parameters
 #define NVS_KEY_PORT "port"
 #define NVS_KEY_AP_SSID "ap_ssid"
@@ -21,6 +28,19 @@ static app_config_t s_app_config;
 #define NVS_KEY_BIT_DEPTH "bit_depth"
 #define NVS_KEY_VOLUME "volume"
 #define NVS_KEY_SPDIF_DATA_PIN "spdif_pin"
+#define NVS_KEY_CHANNEL_MODE "ch_mode"
+#define NVS_KEY_CHANNEL_SELECT "ch_select"
+#define NVS_KEY_DOWNMIX_MATRIX "downmix"
+#define NVS_KEY_EQ_BANDS "eq_bands"
+#define NVS_KEY_COMP_ENABLED "comp_en"
+#define NVS_KEY_COMP_THRESHOLD "comp_thr"
+#define NVS_KEY_COMP_RATIO "comp_ratio"
+#define NVS_KEY_COMP_ATTACK "comp_attack"
+#define NVS_KEY_COMP_RELEASE "comp_release"
+#define NVS_KEY_COMP_MAKEUP "comp_makeup"
+#define NVS_KEY_LIMITER_ENABLED "lim_en"
+#define NVS_KEY_LIMITER_CEILING "lim_ceiling"
+#define NVS_KEY_LOOKAHEAD_MS "lookahead_ms"
 #define NVS_KEY_SILENCE_THRES_MS "silence_ms"
 #define NVS_KEY_NET_CHECK_MS "net_check_ms"
 #define NVS_KEY_ACTIVITY_PACKETS "act_packets"
@@ -30,6 +50,8 @@ static app_config_t s_app_config;
 #define NVS_KEY_ENABLE_USB_SENDER "usb_sender"
 #define NVS_KEY_SENDER_DEST_IP "sender_ip"
 #define NVS_KEY_SENDER_DEST_PORT "sender_port"
+#define NVS_KEY_SENDER_EXTRA_DESTS "sender_extra"
+#define NVS_KEY_SENDER_DEST_NAME "sender_name"
 
 // WiFi roaming keys
 #define NVS_KEY_RSSI_THRESHOLD "rssi_thresh"
@@ -37,6 +59,34 @@ static app_config_t s_app_config;
 // Audio processing keys
 #define NVS_KEY_USE_DIRECT_WRITE "direct_write"
 
+// USB DAC buffering keys
+#define NVS_KEY_USB_BUFFER_CHUNKS "usb_buf_chunks"
+#define NVS_KEY_USB_THRESHOLD_CHUNKS "usb_thr_chunks"
+#define NVS_KEY_USB_ZONE_CHANNELS "usb_zone_ch"
+
+// Output keys
+#define NVS_KEY_SPDIF_OUTPUT "spdif_out"
+#define NVS_KEY_I2S_OUTPUT "i2s_out"
+#define NVS_KEY_I2S_BCK_PIN "i2s_bck"
+#define NVS_KEY_I2S_WS_PIN "i2s_ws"
+#define NVS_KEY_I2S_DATA_PIN "i2s_data"
+
+// Keys that may be written behind by config_manager_save_setting_deferred(),
+// the index in this table is the bit in the dirty mask
+static const char *const s_deferred_keys[] = {
+    NVS_KEY_VOLUME,
+};
+#define DEFERRED_KEY_COUNT ((int)(sizeof(s_deferred_keys) / sizeof(s_deferred_keys[0])))
+
+// Write-behind state
+static uint32_t s_dirty_mask = 0;
+static portMUX_TYPE s_dirty_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t s_flush_task_handle = NULL;
+static config_write_stats_t s_write_stats;
+
+static void config_flush_task(void *arg);
+static void config_shutdown_handler(void);
+
 /**
  * Initialize with default values from config.h
  */
@@ -54,6 +104,19 @@ static void set_default_config(void) {
     s_app_config.bit_depth = BIT_DEPTH;
     s_app_config.volume = VOLUME;
     s_app_config.spdif_data_pin = 16; // Default SPDIF pin for ESP32-S3
+    s_app_config.channel_mode = 2; // Downmix, plain stereo streams pass through
+    s_app_config.channel_select = 0;
+    s_app_config.downmix_matrix[0] = '\0';
+    s_app_config.eq_bands[0] = '\0';
+    s_app_config.compressor_enabled = false;
+    s_app_config.compressor_threshold_db = -20;
+    s_app_config.compressor_ratio = 4;
+    s_app_config.compressor_attack_ms = 10;
+    s_app_config.compressor_release_ms = 200;
+    s_app_config.compressor_makeup_db = 0;
+    s_app_config.limiter_enabled = false;
+    s_app_config.limiter_ceiling_db = -1;
+    s_app_config.lookahead_ms = 2;
     s_app_config.silence_threshold_ms = SILENCE_THRESHOLD_MS;
     s_app_config.network_check_interval_ms = NETWORK_CHECK_INTERVAL_MS;
     s_app_config.activity_threshold_packets = ACTIVITY_THRESHOLD_PACKETS;
@@ -64,12 +127,30 @@ static void set_default_config(void) {
     s_app_config.enable_usb_sender = false;
     strcpy(s_app_config.sender_destination_ip, "192.168.1.255"); // Default to broadcast
     s_app_config.sender_destination_port = 4010; // Default Scream port
+    s_app_config.sender_extra_destinations[0] = '\0'; // No extra destinations
+    s_app_config.sender_destination_name[0] = '\0'; // Use the destination IP
     
     // WiFi roaming defaults
     s_app_config.rssi_threshold = -58; // Default RSSI threshold for roaming
     
     // Audio processing defaults
     s_app_config.use_direct_write = true; // Default to direct write mode
+    
+    // USB DAC buffering defaults
+    s_app_config.usb_buffer_chunks = 4;
+    s_app_config.usb_threshold_chunks = 3; // TX done whenever one chunk fits
+    s_app_config.usb_zone_channels[0] = '\0'; // Every zone plays channels 1 and 2
+    
+    // Default outputs
+#ifdef IS_SPDIF
+    s_app_config.enable_spdif_output = true;
+#else
+    s_app_config.enable_spdif_output = false;
+#endif
+    s_app_config.enable_i2s_output = false;
+    s_app_config.i2s_bck_pin = 4;
+    s_app_config.i2s_ws_pin = 5;
+    s_app_config.i2s_data_pin = 6;
 }
 
 /**
@@ -81,6 +162,12 @@ esp_err_t config_manager_init(void) {
     // Set default values first
     set_default_config();
     
+    // Start the write-behind flush task and make sure pending writes survive a restart
+    if (s_flush_task_handle == NULL) {
+        xTaskCreate(config_flush_task, "config_flush", 3072, NULL, 1, &s_flush_task_handle);
+        esp_register_shutdown_handler(config_shutdown_handler);
+    }
+    
     // Open NVS handle
     nvs_handle_t nvs_handle;
     esp_err_t err = nvs_open(CONFIG_NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
@@ -171,6 +258,76 @@ esp_err_t config_manager_init(void) {
         ESP_LOGI(TAG, "Loaded SPDIF data pin: %d", s_app_config.spdif_data_pin);
     }
     
+    // Read channel selection
+    err = nvs_get_u8(nvs_handle, NVS_KEY_CHANNEL_MODE, &u8_value);
+    if (err == ESP_OK) {
+        s_app_config.channel_mode = u8_value;
+    }
+    
+    err = nvs_get_u8(nvs_handle, NVS_KEY_CHANNEL_SELECT, &u8_value);
+    if (err == ESP_OK) {
+        s_app_config.channel_select = u8_value;
+    }
+    
+    size_t matrix_len = sizeof(s_app_config.downmix_matrix);
+    err = nvs_get_str(nvs_handle, NVS_KEY_DOWNMIX_MATRIX, s_app_config.downmix_matrix, &matrix_len);
+    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGE(TAG, "Error reading downmix matrix: %s", esp_err_to_name(err));
+    }
+    
+    size_t eq_len = sizeof(s_app_config.eq_bands);
+    err = nvs_get_str(nvs_handle, NVS_KEY_EQ_BANDS, s_app_config.eq_bands, &eq_len);
+    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGE(TAG, "Error reading EQ bands: %s", esp_err_to_name(err));
+    }
+    
+    int8_t i8_value;
+    uint16_t u16_value;
+    err = nvs_get_u8(nvs_handle, NVS_KEY_COMP_ENABLED, &u8_value);
+    if (err == ESP_OK) {
+        s_app_config.compressor_enabled = (bool)u8_value;
+    }
+    
+    err = nvs_get_i8(nvs_handle, NVS_KEY_COMP_THRESHOLD, &i8_value);
+    if (err == ESP_OK) {
+        s_app_config.compressor_threshold_db = i8_value;
+    }
+    
+    err = nvs_get_u8(nvs_handle, NVS_KEY_COMP_RATIO, &u8_value);
+    if (err == ESP_OK) {
+        s_app_config.compressor_ratio = u8_value;
+    }
+    
+    err = nvs_get_u8(nvs_handle, NVS_KEY_COMP_ATTACK, &u8_value);
+    if (err == ESP_OK) {
+        s_app_config.compressor_attack_ms = u8_value;
+    }
+    
+    err = nvs_get_u16(nvs_handle, NVS_KEY_COMP_RELEASE, &u16_value);
+    if (err == ESP_OK) {
+        s_app_config.compressor_release_ms = u16_value;
+    }
+    
+    err = nvs_get_u8(nvs_handle, NVS_KEY_COMP_MAKEUP, &u8_value);
+    if (err == ESP_OK) {
+        s_app_config.compressor_makeup_db = u8_value;
+    }
+    
+    err = nvs_get_u8(nvs_handle, NVS_KEY_LIMITER_ENABLED, &u8_value);
+    if (err == ESP_OK) {
+        s_app_config.limiter_enabled = (bool)u8_value;
+    }
+    
+    err = nvs_get_i8(nvs_handle, NVS_KEY_LIMITER_CEILING, &i8_value);
+    if (err == ESP_OK) {
+        s_app_config.limiter_ceiling_db = i8_value;
+    }
+    
+    err = nvs_get_u8(nvs_handle, NVS_KEY_LOOKAHEAD_MS, &u8_value);
+    if (err == ESP_OK) {
+        s_app_config.lookahead_ms = u8_value;
+    }
+    
     // Read sleep settings
     uint32_t u32_value;
     err = nvs_get_u32(nvs_handle, NVS_KEY_SILENCE_THRES_MS, &u32_value);
@@ -188,7 +345,6 @@ esp_err_t config_manager_init(void) {
         s_app_config.activity_threshold_packets = u8_value;
     }
     
-    uint16_t u16_value;
     err = nvs_get_u16(nvs_handle, NVS_KEY_SILENCE_AMPLT, &u16_value);
     if (err == ESP_OK) {
         s_app_config.silence_amplitude_threshold = u16_value;
@@ -218,6 +374,18 @@ esp_err_t config_manager_init(void) {
         s_app_config.sender_destination_port = u16_value;
     }
     
+    size_t extra_len = sizeof(s_app_config.sender_extra_destinations);
+    err = nvs_get_str(nvs_handle, NVS_KEY_SENDER_EXTRA_DESTS, s_app_config.sender_extra_destinations, &extra_len);
+    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGE(TAG, "Error reading sender extra destinations: %s", esp_err_to_name(err));
+    }
+    
+    size_t name_len = sizeof(s_app_config.sender_destination_name);
+    err = nvs_get_str(nvs_handle, NVS_KEY_SENDER_DEST_NAME, s_app_config.sender_destination_name, &name_len);
+    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGE(TAG, "Error reading sender destination name: %s", esp_err_to_name(err));
+    }
+    
     // Read WiFi roaming settings
     int8_t rssi_threshold;
     err = nvs_get_i8(nvs_handle, NVS_KEY_RSSI_THRESHOLD, &rssi_threshold);
@@ -231,6 +399,49 @@ esp_err_t config_manager_init(void) {
         s_app_config.use_direct_write = (bool)u8_value;
     }
     
+    // Read USB DAC buffering settings
+    err = nvs_get_u8(nvs_handle, NVS_KEY_USB_BUFFER_CHUNKS, &u8_value);
+    if (err == ESP_OK) {
+        s_app_config.usb_buffer_chunks = u8_value;
+    }
+    
+    err = nvs_get_u8(nvs_handle, NVS_KEY_USB_THRESHOLD_CHUNKS, &u8_value);
+    if (err == ESP_OK) {
+        s_app_config.usb_threshold_chunks = u8_value;
+    }
+    
+    size_t zone_len = sizeof(s_app_config.usb_zone_channels);
+    err = nvs_get_str(nvs_handle, NVS_KEY_USB_ZONE_CHANNELS, s_app_config.usb_zone_channels, &zone_len);
+    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGE(TAG, "Error reading USB zone channels: %s", esp_err_to_name(err));
+    }
+    
+    // Read output settings
+    err = nvs_get_u8(nvs_handle, NVS_KEY_SPDIF_OUTPUT, &u8_value);
+    if (err == ESP_OK) {
+        s_app_config.enable_spdif_output = (bool)u8_value;
+    }
+    
+    err = nvs_get_u8(nvs_handle, NVS_KEY_I2S_OUTPUT, &u8_value);
+    if (err == ESP_OK) {
+        s_app_config.enable_i2s_output = (bool)u8_value;
+    }
+    
+    err = nvs_get_u8(nvs_handle, NVS_KEY_I2S_BCK_PIN, &u8_value);
+    if (err == ESP_OK) {
+        s_app_config.i2s_bck_pin = u8_value;
+    }
+    
+    err = nvs_get_u8(nvs_handle, NVS_KEY_I2S_WS_PIN, &u8_value);
+    if (err == ESP_OK) {
+        s_app_config.i2s_ws_pin = u8_value;
+    }
+    
+    err = nvs_get_u8(nvs_handle, NVS_KEY_I2S_DATA_PIN, &u8_value);
+    if (err == ESP_OK) {
+        s_app_config.i2s_data_pin = u8_value;
+    }
+    
     // Close NVS handle
     nvs_close(nvs_handle);
     
@@ -354,6 +565,98 @@ esp_err_t config_manager_save_config(void) {
     }
     ESP_LOGI(TAG, "Saved SPDIF data pin: %d", s_app_config.spdif_data_pin);
     
+    // Save channel selection
+    err = nvs_set_u8(nvs_handle, NVS_KEY_CHANNEL_MODE, s_app_config.channel_mode);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving channel mode: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        return err;
+    }
+    
+    err = nvs_set_u8(nvs_handle, NVS_KEY_CHANNEL_SELECT, s_app_config.channel_select);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving channel select: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        return err;
+    }
+    
+    err = nvs_set_str(nvs_handle, NVS_KEY_DOWNMIX_MATRIX, s_app_config.downmix_matrix);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving downmix matrix: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        return err;
+    }
+    
+    err = nvs_set_str(nvs_handle, NVS_KEY_EQ_BANDS, s_app_config.eq_bands);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving EQ bands: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        return err;
+    }
+    
+    err = nvs_set_u8(nvs_handle, NVS_KEY_COMP_ENABLED, (uint8_t)s_app_config.compressor_enabled);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving compressor setting: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        return err;
+    }
+    
+    err = nvs_set_i8(nvs_handle, NVS_KEY_COMP_THRESHOLD, s_app_config.compressor_threshold_db);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving compressor threshold: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        return err;
+    }
+    
+    err = nvs_set_u8(nvs_handle, NVS_KEY_COMP_RATIO, s_app_config.compressor_ratio);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving compressor ratio: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        return err;
+    }
+    
+    err = nvs_set_u8(nvs_handle, NVS_KEY_COMP_ATTACK, s_app_config.compressor_attack_ms);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving compressor attack: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        return err;
+    }
+    
+    err = nvs_set_u16(nvs_handle, NVS_KEY_COMP_RELEASE, s_app_config.compressor_release_ms);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving compressor release: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        return err;
+    }
+    
+    err = nvs_set_u8(nvs_handle, NVS_KEY_COMP_MAKEUP, s_app_config.compressor_makeup_db);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving compressor makeup gain: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        return err;
+    }
+    
+    err = nvs_set_u8(nvs_handle, NVS_KEY_LIMITER_ENABLED, (uint8_t)s_app_config.limiter_enabled);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving limiter setting: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        return err;
+    }
+    
+    err = nvs_set_i8(nvs_handle, NVS_KEY_LIMITER_CEILING, s_app_config.limiter_ceiling_db);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving limiter ceiling: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        return err;
+    }
+    
+    err = nvs_set_u8(nvs_handle, NVS_KEY_LOOKAHEAD_MS, s_app_config.lookahead_ms);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving look-ahead: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        return err;
+    }
+    
     // Save sleep settings
     err = nvs_set_u32(nvs_handle, NVS_KEY_SILENCE_THRES_MS, s_app_config.silence_threshold_ms);
     if (err != ESP_OK) {
@@ -412,6 +715,20 @@ esp_err_t config_manager_save_config(void) {
         return err;
     }
     
+    err = nvs_set_str(nvs_handle, NVS_KEY_SENDER_EXTRA_DESTS, s_app_config.sender_extra_destinations);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving sender extra destinations: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        return err;
+    }
+    
+    err = nvs_set_str(nvs_handle, NVS_KEY_SENDER_DEST_NAME, s_app_config.sender_destination_name);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving sender destination name: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        return err;
+    }
+    
     // Save WiFi roaming settings
     err = nvs_set_i8(nvs_handle, NVS_KEY_RSSI_THRESHOLD, s_app_config.rssi_threshold);
     if (err != ESP_OK) {
@@ -420,6 +737,64 @@ esp_err_t config_manager_save_config(void) {
         return err;
     }
     
+    // Save USB DAC buffering settings
+    err = nvs_set_u8(nvs_handle, NVS_KEY_USB_BUFFER_CHUNKS, s_app_config.usb_buffer_chunks);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving USB buffer chunks: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        return err;
+    }
+    
+    err = nvs_set_u8(nvs_handle, NVS_KEY_USB_THRESHOLD_CHUNKS, s_app_config.usb_threshold_chunks);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving USB threshold chunks: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        return err;
+    }
+    
+    err = nvs_set_str(nvs_handle, NVS_KEY_USB_ZONE_CHANNELS, s_app_config.usb_zone_channels);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving USB zone channels: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        return err;
+    }
+    
+    // Save output settings
+    err = nvs_set_u8(nvs_handle, NVS_KEY_SPDIF_OUTPUT, (uint8_t)s_app_config.enable_spdif_output);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving S/PDIF output setting: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        return err;
+    }
+    
+    err = nvs_set_u8(nvs_handle, NVS_KEY_I2S_OUTPUT, (uint8_t)s_app_config.enable_i2s_output);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving I2S output setting: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        return err;
+    }
+    
+    err = nvs_set_u8(nvs_handle, NVS_KEY_I2S_BCK_PIN, s_app_config.i2s_bck_pin);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving I2S BCK pin: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        return err;
+    }
+    
+    err = nvs_set_u8(nvs_handle, NVS_KEY_I2S_WS_PIN, s_app_config.i2s_ws_pin);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving I2S WS pin: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        return err;
+    }
+    
+    err = nvs_set_u8(nvs_handle, NVS_KEY_I2S_DATA_PIN, s_app_config.i2s_data_pin);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving I2S data pin: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        return err;
+    }
+    
     // Commit the changes
     err = nvs_commit(nvs_handle);
     if (err != ESP_OK) {
@@ -430,104 +805,243 @@ esp_err_t config_manager_save_config(void) {
     
     // Close NVS handle
     nvs_close(nvs_handle);
+    s_write_stats.nvs_commits++;
     
     ESP_LOGI(TAG, "Configuration saved successfully");
     return ESP_OK;
 }
 
 /**
- * Save a specific setting to NVS
+ * Update the in-memory value of a single setting
  */
-esp_err_t config_manager_save_setting(const char* key, void* value, size_t size) {
-    if (!key || !value) {
-        return ESP_ERR_INVALID_ARG;
-    }
-    
-    ESP_LOGI(TAG, "Saving setting %s to NVS", key);
-    
-    // Open NVS handle
-    nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(CONFIG_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
-    
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
-        return err;
-    }
-    
-    // Update in-memory configuration
+static esp_err_t apply_setting(const char* key, void* value, size_t size) {
     if (strcmp(key, NVS_KEY_PORT) == 0 && size == sizeof(uint16_t)) {
         s_app_config.port = *(uint16_t*)value;
-        err = nvs_set_u16(nvs_handle, key, *(uint16_t*)value);
     } else if (strcmp(key, NVS_KEY_AP_SSID) == 0) {
         strncpy(s_app_config.ap_ssid, (char*)value, WIFI_SSID_MAX_LENGTH);
         s_app_config.ap_ssid[WIFI_SSID_MAX_LENGTH] = '\0'; // Ensure null termination
-        err = nvs_set_str(nvs_handle, key, s_app_config.ap_ssid);
     } else if (strcmp(key, NVS_KEY_AP_PASSWORD) == 0) {
         strncpy(s_app_config.ap_password, (char*)value, WIFI_PASSWORD_MAX_LENGTH);
         s_app_config.ap_password[WIFI_PASSWORD_MAX_LENGTH] = '\0'; // Ensure null termination
-        err = nvs_set_str(nvs_handle, key, s_app_config.ap_password);
     } else if (strcmp(key, NVS_KEY_HIDE_AP_CONNECTED) == 0 && size == sizeof(bool)) {
         s_app_config.hide_ap_when_connected = *(bool*)value;
-        err = nvs_set_u8(nvs_handle, key, (uint8_t)s_app_config.hide_ap_when_connected);
     } else if (strcmp(key, NVS_KEY_INIT_BUF_SIZE) == 0 && size == sizeof(uint8_t)) {
         s_app_config.initial_buffer_size = *(uint8_t*)value;
-        err = nvs_set_u8(nvs_handle, key, *(uint8_t*)value);
     } else if (strcmp(key, NVS_KEY_BUF_GROW_STEP) == 0 && size == sizeof(uint8_t)) {
         s_app_config.buffer_grow_step_size = *(uint8_t*)value;
-        err = nvs_set_u8(nvs_handle, key, *(uint8_t*)value);
     } else if (strcmp(key, NVS_KEY_MAX_BUF_SIZE) == 0 && size == sizeof(uint8_t)) {
         s_app_config.max_buffer_size = *(uint8_t*)value;
-        err = nvs_set_u8(nvs_handle, key, *(uint8_t*)value);
     } else if (strcmp(key, NVS_KEY_MAX_GROW_SIZE) == 0 && size == sizeof(uint8_t)) {
         s_app_config.max_grow_size = *(uint8_t*)value;
-        err = nvs_set_u8(nvs_handle, key, *(uint8_t*)value);
     } else if (strcmp(key, NVS_KEY_SAMPLE_RATE) == 0 && size == sizeof(uint32_t)) {
         s_app_config.sample_rate = *(uint32_t*)value;
-        err = nvs_set_u32(nvs_handle, key, *(uint32_t*)value);
     } else if (strcmp(key, NVS_KEY_BIT_DEPTH) == 0 && size == sizeof(uint8_t)) {
         s_app_config.bit_depth = *(uint8_t*)value;
-        err = nvs_set_u8(nvs_handle, key, *(uint8_t*)value);
     } else if (strcmp(key, NVS_KEY_VOLUME) == 0 && size == sizeof(float)) {
         s_app_config.volume = *(float*)value;
-        uint32_t volume_int = (uint32_t)(s_app_config.volume * 100.0f);
-        err = nvs_set_u32(nvs_handle, key, volume_int);
     } else if (strcmp(key, NVS_KEY_SPDIF_DATA_PIN) == 0 && size == sizeof(uint8_t)) {
         s_app_config.spdif_data_pin = *(uint8_t*)value;
-        err = nvs_set_u8(nvs_handle, key, s_app_config.spdif_data_pin);
-        ESP_LOGI(TAG, "Saving SPDIF data pin value: %d", s_app_config.spdif_data_pin);
+    } else if (strcmp(key, NVS_KEY_CHANNEL_MODE) == 0 && size == sizeof(uint8_t)) {
+        s_app_config.channel_mode = *(uint8_t*)value;
+    } else if (strcmp(key, NVS_KEY_CHANNEL_SELECT) == 0 && size == sizeof(uint8_t)) {
+        s_app_config.channel_select = *(uint8_t*)value;
+    } else if (strcmp(key, NVS_KEY_DOWNMIX_MATRIX) == 0) {
+        strncpy(s_app_config.downmix_matrix, (char*)value, DOWNMIX_MATRIX_MAX_LENGTH);
+        s_app_config.downmix_matrix[DOWNMIX_MATRIX_MAX_LENGTH] = '\0'; // Ensure null termination
+    } else if (strcmp(key, NVS_KEY_EQ_BANDS) == 0) {
+        strncpy(s_app_config.eq_bands, (char*)value, EQ_BANDS_MAX_LENGTH);
+        s_app_config.eq_bands[EQ_BANDS_MAX_LENGTH] = '\0'; // Ensure null termination
+    } else if (strcmp(key, NVS_KEY_COMP_ENABLED) == 0 && size == sizeof(bool)) {
+        s_app_config.compressor_enabled = *(bool*)value;
+    } else if (strcmp(key, NVS_KEY_COMP_THRESHOLD) == 0 && size == sizeof(int8_t)) {
+        s_app_config.compressor_threshold_db = *(int8_t*)value;
+    } else if (strcmp(key, NVS_KEY_COMP_RATIO) == 0 && size == sizeof(uint8_t)) {
+        s_app_config.compressor_ratio = *(uint8_t*)value;
+    } else if (strcmp(key, NVS_KEY_COMP_ATTACK) == 0 && size == sizeof(uint8_t)) {
+        s_app_config.compressor_attack_ms = *(uint8_t*)value;
+    } else if (strcmp(key, NVS_KEY_COMP_RELEASE) == 0 && size == sizeof(uint16_t)) {
+        s_app_config.compressor_release_ms = *(uint16_t*)value;
+    } else if (strcmp(key, NVS_KEY_COMP_MAKEUP) == 0 && size == sizeof(uint8_t)) {
+        s_app_config.compressor_makeup_db = *(uint8_t*)value;
+    } else if (strcmp(key, NVS_KEY_LIMITER_ENABLED) == 0 && size == sizeof(bool)) {
+        s_app_config.limiter_enabled = *(bool*)value;
+    } else if (strcmp(key, NVS_KEY_LIMITER_CEILING) == 0 && size == sizeof(int8_t)) {
+        s_app_config.limiter_ceiling_db = *(int8_t*)value;
+    } else if (strcmp(key, NVS_KEY_LOOKAHEAD_MS) == 0 && size == sizeof(uint8_t)) {
+        s_app_config.lookahead_ms = *(uint8_t*)value;
     } else if (strcmp(key, NVS_KEY_SILENCE_THRES_MS) == 0 && size == sizeof(uint32_t)) {
         s_app_config.silence_threshold_ms = *(uint32_t*)value;
-        err = nvs_set_u32(nvs_handle, key, *(uint32_t*)value);
     } else if (strcmp(key, NVS_KEY_NET_CHECK_MS) == 0 && size == sizeof(uint32_t)) {
         s_app_config.network_check_interval_ms = *(uint32_t*)value;
-        err = nvs_set_u32(nvs_handle, key, *(uint32_t*)value);
     } else if (strcmp(key, NVS_KEY_ACTIVITY_PACKETS) == 0 && size == sizeof(uint8_t)) {
         s_app_config.activity_threshold_packets = *(uint8_t*)value;
-        err = nvs_set_u8(nvs_handle, key, *(uint8_t*)value);
     } else if (strcmp(key, NVS_KEY_SILENCE_AMPLT) == 0 && size == sizeof(uint16_t)) {
         s_app_config.silence_amplitude_threshold = *(uint16_t*)value;
-        err = nvs_set_u16(nvs_handle, key, *(uint16_t*)value);
     } else if (strcmp(key, NVS_KEY_NET_INACT_MS) == 0 && size == sizeof(uint32_t)) {
         s_app_config.network_inactivity_timeout_ms = *(uint32_t*)value;
-        err = nvs_set_u32(nvs_handle, key, *(uint32_t*)value);
     } else if (strcmp(key, NVS_KEY_ENABLE_USB_SENDER) == 0 && size == sizeof(bool)) {
         s_app_config.enable_usb_sender = *(bool*)value;
-        err = nvs_set_u8(nvs_handle, key, (uint8_t)s_app_config.enable_usb_sender);
     } else if (strcmp(key, NVS_KEY_SENDER_DEST_IP) == 0) {
         strncpy(s_app_config.sender_destination_ip, (char*)value, 15);
         s_app_config.sender_destination_ip[15] = '\0'; // Ensure null termination
-        err = nvs_set_str(nvs_handle, key, s_app_config.sender_destination_ip);
     } else if (strcmp(key, NVS_KEY_SENDER_DEST_PORT) == 0 && size == sizeof(uint16_t)) {
         s_app_config.sender_destination_port = *(uint16_t*)value;
-        err = nvs_set_u16(nvs_handle, key, s_app_config.sender_destination_port);
+    } else if (strcmp(key, NVS_KEY_SENDER_EXTRA_DESTS) == 0) {
+        strncpy(s_app_config.sender_extra_destinations, (char*)value, SENDER_EXTRA_DESTINATIONS_MAX_LENGTH);
+        s_app_config.sender_extra_destinations[SENDER_EXTRA_DESTINATIONS_MAX_LENGTH] = '\0'; // Ensure null termination
+    } else if (strcmp(key, NVS_KEY_SENDER_DEST_NAME) == 0) {
+        strncpy(s_app_config.sender_destination_name, (char*)value, SENDER_DESTINATION_NAME_MAX_LENGTH);
+        s_app_config.sender_destination_name[SENDER_DESTINATION_NAME_MAX_LENGTH] = '\0'; // Ensure null termination
     } else if (strcmp(key, NVS_KEY_RSSI_THRESHOLD) == 0 && size == sizeof(int8_t)) {
         s_app_config.rssi_threshold = *(int8_t*)value;
-        err = nvs_set_i8(nvs_handle, key, s_app_config.rssi_threshold);
     } else if (strcmp(key, NVS_KEY_USE_DIRECT_WRITE) == 0 && size == sizeof(bool)) {
         s_app_config.use_direct_write = *(bool*)value;
-        err = nvs_set_u8(nvs_handle, key, (uint8_t)s_app_config.use_direct_write);
+    } else if (strcmp(key, NVS_KEY_USB_BUFFER_CHUNKS) == 0 && size == sizeof(uint8_t)) {
+        s_app_config.usb_buffer_chunks = *(uint8_t*)value;
+    } else if (strcmp(key, NVS_KEY_USB_THRESHOLD_CHUNKS) == 0 && size == sizeof(uint8_t)) {
+        s_app_config.usb_threshold_chunks = *(uint8_t*)value;
+    } else if (strcmp(key, NVS_KEY_USB_ZONE_CHANNELS) == 0) {
+        strncpy(s_app_config.usb_zone_channels, (char*)value, USB_ZONE_CHANNELS_MAX_LENGTH);
+        s_app_config.usb_zone_channels[USB_ZONE_CHANNELS_MAX_LENGTH] = '\0'; // Ensure null termination
+    } else if (strcmp(key, NVS_KEY_SPDIF_OUTPUT) == 0 && size == sizeof(bool)) {
+        s_app_config.enable_spdif_output = *(bool*)value;
+    } else if (strcmp(key, NVS_KEY_I2S_OUTPUT) == 0 && size == sizeof(bool)) {
+        s_app_config.enable_i2s_output = *(bool*)value;
+    } else if (strcmp(key, NVS_KEY_I2S_BCK_PIN) == 0 && size == sizeof(uint8_t)) {
+        s_app_config.i2s_bck_pin = *(uint8_t*)value;
+    } else if (strcmp(key, NVS_KEY_I2S_WS_PIN) == 0 && size == sizeof(uint8_t)) {
+        s_app_config.i2s_ws_pin = *(uint8_t*)value;
+    } else if (strcmp(key, NVS_KEY_I2S_DATA_PIN) == 0 && size == sizeof(uint8_t)) {
+        s_app_config.i2s_data_pin = *(uint8_t*)value;
     } else {
-        err = ESP_ERR_INVALID_ARG;
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+/**
+ * Write the in-memory value of a single setting to an open NVS handle
+ */
+static esp_err_t write_setting(nvs_handle_t nvs_handle, const char* key) {
+    if (strcmp(key, NVS_KEY_PORT) == 0) {
+        return nvs_set_u16(nvs_handle, key, s_app_config.port);
+    } else if (strcmp(key, NVS_KEY_AP_SSID) == 0) {
+        return nvs_set_str(nvs_handle, key, s_app_config.ap_ssid);
+    } else if (strcmp(key, NVS_KEY_AP_PASSWORD) == 0) {
+        return nvs_set_str(nvs_handle, key, s_app_config.ap_password);
+    } else if (strcmp(key, NVS_KEY_HIDE_AP_CONNECTED) == 0) {
+        return nvs_set_u8(nvs_handle, key, (uint8_t)s_app_config.hide_ap_when_connected);
+    } else if (strcmp(key, NVS_KEY_INIT_BUF_SIZE) == 0) {
+        return nvs_set_u8(nvs_handle, key, s_app_config.initial_buffer_size);
+    } else if (strcmp(key, NVS_KEY_BUF_GROW_STEP) == 0) {
+        return nvs_set_u8(nvs_handle, key, s_app_config.buffer_grow_step_size);
+    } else if (strcmp(key, NVS_KEY_MAX_BUF_SIZE) == 0) {
+        return nvs_set_u8(nvs_handle, key, s_app_config.max_buffer_size);
+    } else if (strcmp(key, NVS_KEY_MAX_GROW_SIZE) == 0) {
+        return nvs_set_u8(nvs_handle, key, s_app_config.max_grow_size);
+    } else if (strcmp(key, NVS_KEY_SAMPLE_RATE) == 0) {
+        return nvs_set_u32(nvs_handle, key, s_app_config.sample_rate);
+    } else if (strcmp(key, NVS_KEY_BIT_DEPTH) == 0) {
+        return nvs_set_u8(nvs_handle, key, s_app_config.bit_depth);
+    } else if (strcmp(key, NVS_KEY_VOLUME) == 0) {
+        // Store volume as integer (float * 100) for NVS
+        return nvs_set_u32(nvs_handle, key, (uint32_t)(s_app_config.volume * 100.0f));
+    } else if (strcmp(key, NVS_KEY_SPDIF_DATA_PIN) == 0) {
+        ESP_LOGI(TAG, "Saving SPDIF data pin value: %d", s_app_config.spdif_data_pin);
+        return nvs_set_u8(nvs_handle, key, s_app_config.spdif_data_pin);
+    } else if (strcmp(key, NVS_KEY_CHANNEL_MODE) == 0) {
+        return nvs_set_u8(nvs_handle, key, s_app_config.channel_mode);
+    } else if (strcmp(key, NVS_KEY_CHANNEL_SELECT) == 0) {
+        return nvs_set_u8(nvs_handle, key, s_app_config.channel_select);
+    } else if (strcmp(key, NVS_KEY_DOWNMIX_MATRIX) == 0) {
+        return nvs_set_str(nvs_handle, key, s_app_config.downmix_matrix);
+    } else if (strcmp(key, NVS_KEY_EQ_BANDS) == 0) {
+        return nvs_set_str(nvs_handle, key, s_app_config.eq_bands);
+    } else if (strcmp(key, NVS_KEY_COMP_ENABLED) == 0) {
+        return nvs_set_u8(nvs_handle, key, (uint8_t)s_app_config.compressor_enabled);
+    } else if (strcmp(key, NVS_KEY_COMP_THRESHOLD) == 0) {
+        return nvs_set_i8(nvs_handle, key, s_app_config.compressor_threshold_db);
+    } else if (strcmp(key, NVS_KEY_COMP_RATIO) == 0) {
+        return nvs_set_u8(nvs_handle, key, s_app_config.compressor_ratio);
+    } else if (strcmp(key, NVS_KEY_COMP_ATTACK) == 0) {
+        return nvs_set_u8(nvs_handle, key, s_app_config.compressor_attack_ms);
+    } else if (strcmp(key, NVS_KEY_COMP_RELEASE) == 0) {
+        return nvs_set_u16(nvs_handle, key, s_app_config.compressor_release_ms);
+    } else if (strcmp(key, NVS_KEY_COMP_MAKEUP) == 0) {
+        return nvs_set_u8(nvs_handle, key, s_app_config.compressor_makeup_db);
+    } else if (strcmp(key, NVS_KEY_LIMITER_ENABLED) == 0) {
+        return nvs_set_u8(nvs_handle, key, (uint8_t)s_app_config.limiter_enabled);
+    } else if (strcmp(key, NVS_KEY_LIMITER_CEILING) == 0) {
+        return nvs_set_i8(nvs_handle, key, s_app_config.limiter_ceiling_db);
+    } else if (strcmp(key, NVS_KEY_LOOKAHEAD_MS) == 0) {
+        return nvs_set_u8(nvs_handle, key, s_app_config.lookahead_ms);
+    } else if (strcmp(key, NVS_KEY_SILENCE_THRES_MS) == 0) {
+        return nvs_set_u32(nvs_handle, key, s_app_config.silence_threshold_ms);
+    } else if (strcmp(key, NVS_KEY_NET_CHECK_MS) == 0) {
+        return nvs_set_u32(nvs_handle, key, s_app_config.network_check_interval_ms);
+    } else if (strcmp(key, NVS_KEY_ACTIVITY_PACKETS) == 0) {
+        return nvs_set_u8(nvs_handle, key, s_app_config.activity_threshold_packets);
+    } else if (strcmp(key, NVS_KEY_SILENCE_AMPLT) == 0) {
+        return nvs_set_u16(nvs_handle, key, s_app_config.silence_amplitude_threshold);
+    } else if (strcmp(key, NVS_KEY_NET_INACT_MS) == 0) {
+        return nvs_set_u32(nvs_handle, key, s_app_config.network_inactivity_timeout_ms);
+    } else if (strcmp(key, NVS_KEY_ENABLE_USB_SENDER) == 0) {
+        return nvs_set_u8(nvs_handle, key, (uint8_t)s_app_config.enable_usb_sender);
+    } else if (strcmp(key, NVS_KEY_SENDER_DEST_IP) == 0) {
+        return nvs_set_str(nvs_handle, key, s_app_config.sender_destination_ip);
+    } else if (strcmp(key, NVS_KEY_SENDER_DEST_PORT) == 0) {
+        return nvs_set_u16(nvs_handle, key, s_app_config.sender_destination_port);
+    } else if (strcmp(key, NVS_KEY_SENDER_EXTRA_DESTS) == 0) {
+        return nvs_set_str(nvs_handle, key, s_app_config.sender_extra_destinations);
+    } else if (strcmp(key, NVS_KEY_SENDER_DEST_NAME) == 0) {
+        return nvs_set_str(nvs_handle, key, s_app_config.sender_destination_name);
+    } else if (strcmp(key, NVS_KEY_RSSI_THRESHOLD) == 0) {
+        return nvs_set_i8(nvs_handle, key, s_app_config.rssi_threshold);
+    } else if (strcmp(key, NVS_KEY_USE_DIRECT_WRITE) == 0) {
+        return nvs_set_u8(nvs_handle, key, (uint8_t)s_app_config.use_direct_write);
+    } else if (strcmp(key, NVS_KEY_USB_BUFFER_CHUNKS) == 0) {
+        return nvs_set_u8(nvs_handle, key, s_app_config.usb_buffer_chunks);
+    } else if (strcmp(key, NVS_KEY_USB_THRESHOLD_CHUNKS) == 0) {
+        return nvs_set_u8(nvs_handle, key, s_app_config.usb_threshold_chunks);
+    } else if (strcmp(key, NVS_KEY_USB_ZONE_CHANNELS) == 0) {
+        return nvs_set_str(nvs_handle, key, s_app_config.usb_zone_channels);
+    } else if (strcmp(key, NVS_KEY_SPDIF_OUTPUT) == 0) {
+        return nvs_set_u8(nvs_handle, key, (uint8_t)s_app_config.enable_spdif_output);
+    } else if (strcmp(key, NVS_KEY_I2S_OUTPUT) == 0) {
+        return nvs_set_u8(nvs_handle, key, (uint8_t)s_app_config.enable_i2s_output);
+    } else if (strcmp(key, NVS_KEY_I2S_BCK_PIN) == 0) {
+        return nvs_set_u8(nvs_handle, key, s_app_config.i2s_bck_pin);
+    } else if (strcmp(key, NVS_KEY_I2S_WS_PIN) == 0) {
+        return nvs_set_u8(nvs_handle, key, s_app_config.i2s_ws_pin);
+    } else if (strcmp(key, NVS_KEY_I2S_DATA_PIN) == 0) {
+        return nvs_set_u8(nvs_handle, key, s_app_config.i2s_data_pin);
+    }
+    return ESP_ERR_INVALID_ARG;
+}
+
+/**
+ * Save a specific setting to NVS
+ */
+esp_err_t config_manager_save_setting(const char* key, void* value, size_t size) {
+    if (!key || !value) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    ESP_LOGI(TAG, "Saving setting %s to NVS", key);
+    
+    // Open NVS handle
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(CONFIG_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
+        return err;
+    }
+    
+    // Update in-memory configuration, then write it out
+    err = apply_setting(key, value, size);
+    if (err == ESP_OK) {
+        err = write_setting(nvs_handle, key);
     }
     
     if (err != ESP_OK) {
@@ -540,6 +1054,8 @@ esp_err_t config_manager_save_setting(const char* key, void* value, size_t size)
     err = nvs_commit(nvs_handle);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Error committing changes to NVS: %s", esp_err_to_name(err));
+    } else {
+        s_write_stats.nvs_commits++;
     }
     
     // Close NVS handle
@@ -548,14 +1064,142 @@ esp_err_t config_manager_save_setting(const char* key, void* value, size_t size)
     return err;
 }
 
+/**
+ * Find the slot of a key in the write-behind dirty mask
+ */
+static int deferred_key_index(const char* key) {
+    for (int i = 0; i < DEFERRED_KEY_COUNT; i++) {
+        if (strcmp(key, s_deferred_keys[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Update a setting in memory now and persist it once changes go quiet
+ */
+esp_err_t config_manager_save_setting_deferred(const char* key, void* value, size_t size) {
+    if (!key || !value) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    int index = deferred_key_index(key);
+    if (index < 0 || s_flush_task_handle == NULL) {
+        // Not cached, fall back to an immediate write
+        return config_manager_save_setting(key, value, size);
+    }
+    
+    esp_err_t err = apply_setting(key, value, size);
+    if (err != ESP_OK) {
+        return err;
+    }
+    
+    taskENTER_CRITICAL(&s_dirty_lock);
+    if (s_dirty_mask & (1UL << index)) {
+        s_write_stats.coalesced_updates++;
+    }
+    s_dirty_mask |= 1UL << index;
+    taskEXIT_CRITICAL(&s_dirty_lock);
+    s_write_stats.deferred_updates++;
+    
+    // (Re)start the quiet period in the flush task
+    xTaskNotifyGive(s_flush_task_handle);
+    return ESP_OK;
+}
+
+/**
+ * Write all dirty settings to NVS with a single commit
+ */
+esp_err_t config_manager_flush(void) {
+    taskENTER_CRITICAL(&s_dirty_lock);
+    uint32_t dirty = s_dirty_mask;
+    s_dirty_mask = 0;
+    taskEXIT_CRITICAL(&s_dirty_lock);
+    
+    if (dirty == 0) {
+        return ESP_OK;
+    }
+    
+    int written = 0;
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(CONFIG_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
+        goto restore;
+    }
+    
+    for (int i = 0; i < DEFERRED_KEY_COUNT; i++) {
+        if (!(dirty & (1UL << i))) {
+            continue;
+        }
+        err = write_setting(nvs_handle, s_deferred_keys[i]);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Error saving setting %s: %s", s_deferred_keys[i], esp_err_to_name(err));
+            nvs_close(nvs_handle);
+            goto restore;
+        }
+        written++;
+    }
+    
+    err = nvs_commit(nvs_handle);
+    nvs_close(nvs_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error committing changes to NVS: %s", esp_err_to_name(err));
+        goto restore;
+    }
+    
+    s_write_stats.nvs_commits++;
+    ESP_LOGI(TAG, "Flushed %d deferred setting(s), %" PRIu32 " update(s) coalesced so far",
+             written, s_write_stats.coalesced_updates);
+    return ESP_OK;
+    
+restore:
+    // Keep the keys dirty so the next flush retries them
+    taskENTER_CRITICAL(&s_dirty_lock);
+    s_dirty_mask |= dirty;
+    taskEXIT_CRITICAL(&s_dirty_lock);
+    return err;
+}
+
+/**
+ * Get the NVS write counters
+ */
+void config_manager_get_write_stats(config_write_stats_t *stats) {
+    *stats = s_write_stats;
+}
+
+/**
+ * Flush deferred settings after CONFIG_FLUSH_QUIET_MS without new changes
+ */
+static void config_flush_task(void *arg) {
+    while (true) {
+        // Sleep until the first deferred change
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        
+        // Every further change restarts the quiet period
+        while (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONFIG_FLUSH_QUIET_MS)) != 0) {
+        }
+        
+        config_manager_flush();
+    }
+}
+
+static void config_shutdown_handler(void) {
+    config_manager_flush();
+}
+
 /**
  * Reset configuration to defaults
  */
 esp_err_t config_manager_reset(void) {
     ESP_LOGI(TAG, "Resetting configuration to defaults");
     
-    // Reset in-memory configuration to defaults
+    // Reset in-memory configuration to defaults and drop pending deferred writes
     set_default_config();
+    taskENTER_CRITICAL(&s_dirty_lock);
+    s_dirty_mask = 0;
+    taskEXIT_CRITICAL(&s_dirty_lock);
     
     // Open NVS handle
     nvs_handle_t nvs_handle;
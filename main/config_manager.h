@@ -8,6 +8,17 @@
 // NVS namespace for storing configuration
 #define CONFIG_NVS_NAMESPACE "app_config"
 
+// Comma separated list of additional USB sender destinations
+#define SENDER_EXTRA_DESTINATIONS_MAX_LENGTH 127
+// mDNS instance name, hostname or "auto" of the receiver the USB sender follows
+#define SENDER_DESTINATION_NAME_MAX_LENGTH 63
+// Comma separated stream channel pair of each USB DAC zone
+#define USB_ZONE_CHANNELS_MAX_LENGTH 15
+// Downmix matrix text, two rows of per channel gains
+#define DOWNMIX_MATRIX_MAX_LENGTH 127
+// Equaliser bands text, up to ten "type freq gain q" bands
+#define EQ_BANDS_MAX_LENGTH 319
+
 typedef struct {
     // Network
     uint16_t port;
@@ -27,7 +38,31 @@ typedef struct {
     uint32_t sample_rate;
     uint8_t bit_depth;
     float volume;
-    uint8_t spdif_data_pin;  // Only used when IS_SPDIF is defined
+    uint8_t spdif_data_pin;  // Only used when the S/PDIF output is enabled
+    
+    // What this receiver plays out of a multichannel stream
+    uint8_t channel_mode;                  // channel_map_mode_t: 0 pair, 1 mono, 2 downmix
+    uint8_t channel_select;                // Pair index for pair mode, channel index for mono
+    char downmix_matrix[DOWNMIX_MATRIX_MAX_LENGTH + 1]; // "L gains;R gains", empty for the standard downmix
+    char eq_bands[EQ_BANDS_MAX_LENGTH + 1]; // "type freq gain q" per band separated by ';', empty for no EQ
+    
+    // Dynamics, applied after the equaliser
+    bool compressor_enabled;               // Compress the stream before the limiter
+    int8_t compressor_threshold_db;        // dBFS above which gain is reduced, -60 to 0
+    uint8_t compressor_ratio;              // Input dB over threshold per output dB, 1 to 20
+    uint8_t compressor_attack_ms;
+    uint16_t compressor_release_ms;
+    uint8_t compressor_makeup_db;          // Gain after compression, 0 to 18
+    bool limiter_enabled;                  // Hold peaks under limiter_ceiling_db
+    int8_t limiter_ceiling_db;             // Highest peak in dBFS, -20 to 0
+    uint8_t lookahead_ms;                  // Delay the compressor and limiter see ahead by, 1 to 5
+    
+    // Outputs fed alongside the USB DAC, applied at boot
+    bool enable_spdif_output;              // Send the stream to S/PDIF on spdif_data_pin
+    bool enable_i2s_output;                // Send the stream to an I2S DAC
+    uint8_t i2s_bck_pin;                   // I2S DAC bit clock
+    uint8_t i2s_ws_pin;                    // I2S DAC word select
+    uint8_t i2s_data_pin;                  // I2S DAC data out
     
     // Sleep configuration
     uint32_t silence_threshold_ms;
@@ -40,14 +75,28 @@ typedef struct {
     bool enable_usb_sender;                // Enable USB Scream Sender functionality
     char sender_destination_ip[16];        // Destination IP for audio packets
     uint16_t sender_destination_port;      // Destination port for audio packets
+    char sender_extra_destinations[SENDER_EXTRA_DESTINATIONS_MAX_LENGTH + 1]; // Extra unicast IPs, comma separated
+    char sender_destination_name[SENDER_DESTINATION_NAME_MAX_LENGTH + 1]; // Discovered receiver to send to, empty for manual IP
     
     // WiFi roaming configuration
     int8_t rssi_threshold;                 // RSSI threshold for roaming (-58 dBm default)
     
     // Audio processing configuration
     bool use_direct_write;                 // Use direct write instead of buffering
+    
+    // USB DAC isochronous buffering, applied when the DAC is opened
+    uint8_t usb_buffer_chunks;             // Chunks the USB host ring buffer holds
+    uint8_t usb_threshold_chunks;          // TX done fires when at most this many chunks are queued
+    char usb_zone_channels[USB_ZONE_CHANNELS_MAX_LENGTH + 1]; // Channel pair per DAC zone, e.g. ",1,2", empty entries play the receiver's mix
 } app_config_t;
 
+// NVS write counters, used to check how well deferred writes coalesce
+typedef struct {
+    uint32_t nvs_commits;          // NVS commits from any save path
+    uint32_t deferred_updates;     // Calls to config_manager_save_setting_deferred()
+    uint32_t coalesced_updates;    // Deferred updates that replaced a still pending one
+} config_write_stats_t;
+
 // Initialize configuration (load from NVS or use defaults)
 esp_err_t config_manager_init(void);
 
@@ -60,5 +109,16 @@ esp_err_t config_manager_save_config(void);
 // Save specific configuration to NVS
 esp_err_t config_manager_save_setting(const char* key, void* value, size_t size);
 
+// Update a setting in memory immediately and write it to NVS after a quiet
+// period, coalescing rapid changes. Keys without write-behind support are
+// saved immediately.
+esp_err_t config_manager_save_setting_deferred(const char* key, void* value, size_t size);
+
+// Write any pending deferred settings to NVS now
+esp_err_t config_manager_flush(void);
+
+// Get NVS write counters
+void config_manager_get_write_stats(config_write_stats_t *stats);
+
 // Reset configuration to defaults
 esp_err_t config_manager_reset(void);
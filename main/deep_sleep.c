@@ -0,0 +1,163 @@
+#include "deep_sleep.h"
+#include "config.h"
+#include "bq25895_integration.h"
+#include <inttypes.h>
+#include <string.h>
+#include <sys/time.h>
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "esp_wake_stub.h"
+#include "driver/rtc_io.h"
+#include "soc/rtc.h"
+#include "soc/rtc_io_reg.h"
+
+// Currents the charger can't measure since the receiver is off, estimates from the datasheets
+// Chip in deep sleep with the RTC peripherals kept on for the D+ pad
+#define DEEP_SLEEP_MA 0.05f
+// Charger's boost converter held on with nothing plugged in
+#define BOOST_IDLE_MA 3.0f
+// Wake stub from waking to sleeping again, the ROM boot is most of it
+#define WAKE_STUB_MA 25.0f
+#define WAKE_STUB_MS 3.0f
+// App boot with Wi-Fi off, waiting for the DAC to enumerate
+#define BOOT_MA 60.0f
+
+// Kept in RTC memory through deep sleep, zeroed on power on
+typedef struct {
+    int64_t since_us;           // Wall clock when the wait started, 0 when not waiting
+    uint64_t interval_us;       // Next check interval, doubled by each check that finds nothing
+    uint32_t checks;            // Wake stub checks that slept again
+    uint32_t stub_checks;       // Same since the last app boot
+    uint32_t boots;             // App boots that found no DAC
+    uint32_t awake_ms;          // Time those boots were awake
+    bool dp_stuck;              // D+ was already high going to sleep, only the timer wakes
+} dac_wait_t;
+
+static RTC_DATA_ATTR dac_wait_t s_wait;
+static bool s_woke = false;
+static deep_sleep_report_t s_report;
+
+static int64_t wall_us(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+// Runs from RTC memory before the app is loaded, only ROM functions, RTC
+// memory and registers are available. Shifts and compares keep 64-bit math
+// out of libgcc, which lives in flash.
+static void RTC_IRAM_ATTR dac_check_stub(void) {
+    bool timer = (esp_wake_stub_get_wakeup_cause() & RTC_TIMER_TRIG_EN) != 0;
+    bool dp_high = false;
+#ifdef IS_USB
+    dp_high = !s_wait.dp_stuck
+        && ((REG_GET_FIELD(RTC_GPIO_IN_REG, RTC_GPIO_IN_NEXT) >> USB_DP_GPIO) & 1);
+#endif
+    if (timer && !dp_high && s_wait.stub_checks < DAC_CHECK_BOOT_EVERY) {
+        s_wait.checks++;
+        s_wait.stub_checks++;
+        s_wait.interval_us <<= 1;
+        if (s_wait.interval_us > DAC_CHECK_MAX_SLEEP_MS * 1000ULL) {
+            s_wait.interval_us = DAC_CHECK_MAX_SLEEP_MS * 1000ULL;
+        }
+        esp_wake_stub_set_wakeup_time(s_wait.interval_us);
+        esp_wake_stub_sleep(&dac_check_stub);
+    }
+    // Plugged in, or time for the app to look for itself
+    esp_default_wake_deep_sleep();
+}
+
+void deep_sleep_start(void) {
+    if (s_woke && s_wait.since_us != 0) {
+        // Back to sleep after a boot that found nothing, keep backing off
+        s_wait.boots++;
+        s_wait.awake_ms += (uint32_t)(esp_timer_get_time() / 1000);
+        s_wait.interval_us <<= 1;
+        if (s_wait.interval_us > DAC_CHECK_MAX_SLEEP_MS * 1000ULL) {
+            s_wait.interval_us = DAC_CHECK_MAX_SLEEP_MS * 1000ULL;
+        }
+    } else {
+        memset(&s_wait, 0, sizeof(s_wait));
+        s_wait.since_us = wall_us();
+        s_wait.interval_us = DAC_CHECK_SLEEP_TIME_MS * 1000ULL;
+    }
+    s_wait.stub_checks = 0;
+
+    // Keep the USB port powered so a DAC plugged in while asleep shows on D+
+    bq25895_integration_hold_usb_power();
+    esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_PERIPH, ESP_PD_OPTION_ON);
+#ifdef IS_USB
+    rtc_gpio_init(USB_DP_GPIO);
+    rtc_gpio_set_direction(USB_DP_GPIO, RTC_GPIO_MODE_INPUT_ONLY);
+    rtc_gpio_pullup_dis(USB_DP_GPIO);
+    rtc_gpio_pulldown_en(USB_DP_GPIO);
+    esp_rom_delay_us(100);
+    // Waking on a line that's already high would boot straight away every time
+    s_wait.dp_stuck = rtc_gpio_get_level(USB_DP_GPIO) != 0;
+    if (s_wait.dp_stuck) {
+        ESP_LOGW(TAG, "USB D+ is high without a DAC, only waking on the timer");
+    } else {
+        esp_sleep_enable_ext1_wakeup(1ULL << USB_DP_GPIO, ESP_EXT1_WAKEUP_ANY_HIGH);
+    }
+#endif
+    esp_sleep_enable_timer_wakeup(s_wait.interval_us);
+    esp_set_deep_sleep_wake_stub(&dac_check_stub);
+
+    ESP_LOGI(TAG, "Deep sleep until a DAC shows up, checking in %" PRIu32 " ms",
+             (uint32_t)(s_wait.interval_us / 1000));
+    esp_deep_sleep_start();
+}
+
+bool deep_sleep_resume(void) {
+    bool from_sleep = esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_UNDEFINED;
+    s_woke = from_sleep && s_wait.since_us != 0;
+#ifdef IS_USB
+    // Hand the D+ pad back to the USB PHY
+    if (from_sleep) {
+        rtc_gpio_pulldown_dis(USB_DP_GPIO);
+        rtc_gpio_deinit(USB_DP_GPIO);
+    }
+#endif
+    if (s_woke) {
+        ESP_LOGI(TAG, "Woke from waiting for a DAC after %" PRIu32 " checks and %" PRIu32 " boots",
+                 s_wait.checks, s_wait.boots);
+    }
+    return s_woke;
+}
+
+void deep_sleep_dac_found(void) {
+    if (!s_woke || s_wait.since_us == 0) {
+        return;
+    }
+    int64_t uptime_us = esp_timer_get_time();
+    // Up to this boot, which found the DAC
+    float waited_ms = (wall_us() - uptime_us - s_wait.since_us) / 1000.0f;
+    if (waited_ms > 0) {
+        float stub_ms = s_wait.checks * WAKE_STUB_MS;
+        float asleep_ms = waited_ms - s_wait.awake_ms - stub_ms;
+        if (asleep_ms < 0) {
+            asleep_ms = 0;
+        }
+        s_report.valid = true;
+        s_report.hours = waited_ms / 3600000.0f;
+        s_report.checks = s_wait.checks;
+        s_report.boots = s_wait.boots;
+        s_report.interval_ms = (uint32_t)(s_wait.interval_us / 1000);
+        s_report.average_ma = (asleep_ms * (DEEP_SLEEP_MA + BOOST_IDLE_MA) + stub_ms * WAKE_STUB_MA
+                               + s_wait.awake_ms * BOOT_MA) / waited_ms;
+        // A full boot every DAC_CHECK_SLEEP_TIME_MS, each as long as the boots here took
+        float boot_ms = s_wait.boots ? (float)s_wait.awake_ms / s_wait.boots : DAC_WAKE_GRACE_MS;
+        s_report.full_boot_ma = (DAC_CHECK_SLEEP_TIME_MS * DEEP_SLEEP_MA + boot_ms * BOOT_MA)
+                                / (DAC_CHECK_SLEEP_TIME_MS + boot_ms);
+        ESP_LOGI(TAG, "DAC found after %.2f h, estimated %.2f mA while waiting, %.1f mA with a boot every %d ms",
+                 s_report.hours, s_report.average_ma, s_report.full_boot_ma, DAC_CHECK_SLEEP_TIME_MS);
+    }
+    memset(&s_wait, 0, sizeof(s_wait));
+}
+
+void deep_sleep_get_report(deep_sleep_report_t *report) {
+    *report = s_report;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Deep sleep until a DAC is likely plugged in, never returns. A DAC that gets
+ * power pulls USB D+ up and wakes the receiver at once. In between, a wake
+ * stub running from RTC memory checks D+ on a timer that backs off from
+ * DAC_CHECK_SLEEP_TIME_MS to DAC_CHECK_MAX_SLEEP_MS, and only every
+ * DAC_CHECK_BOOT_EVERY checks does the app boot to look for a DAC itself.
+ */
+void deep_sleep_start(void);
+
+/**
+ * @brief Call at boot before the USB host starts, hands D+ back to the USB PHY
+ *
+ * @return True when this boot is a wake from deep_sleep_start(), app_main
+ *         goes back to sleep if no DAC enumerates within DAC_WAKE_GRACE_MS
+ */
+bool deep_sleep_resume(void);
+
+/**
+ * @brief End the wait after a wake found a DAC, the next deep sleep starts
+ * checking at the shortest interval again
+ */
+void deep_sleep_dac_found(void);
+
+// The last wait for a DAC, see deep_sleep_get_report()
+typedef struct {
+    bool valid;                 // A wait has ended since the app started
+    float hours;                // Time spent waiting
+    uint32_t checks;            // Wake stub checks that found no DAC and slept again
+    uint32_t boots;             // App boots that found no DAC either
+    uint32_t interval_ms;       // Check interval the back-off had reached
+    float average_ma;           // Estimated average current while waiting
+    float full_boot_ma;         // Same for a full boot every DAC_CHECK_SLEEP_TIME_MS instead
+} deep_sleep_report_t;
+
+/**
+ * @brief Get the report of the last wait for a DAC, valid is false if none ended since boot
+ */
+void deep_sleep_get_report(deep_sleep_report_t *report);
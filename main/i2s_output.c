@@ -0,0 +1,88 @@
+#include "i2s_output.h"
+#include "driver/i2s.h"
+#include "soc/soc_caps.h"
+#include "esp_log.h"
+#include "config_manager.h"
+
+#define TAG "i2s_output"
+
+// S/PDIF owns port 0, the DAC needs a second I2S peripheral
+#if SOC_I2S_NUM > 1
+#define I2S_OUTPUT_NUM I2S_NUM_1
+#endif
+
+#define DMA_BUF_COUNT 4
+#define DMA_BUF_LEN 288     // Frames, one Scream chunk
+
+esp_err_t i2s_output_init(uint32_t rate)
+{
+#ifdef I2S_OUTPUT_NUM
+    app_config_t *config = config_manager_get_config();
+    i2s_config_t i2s_config = {
+        .mode = I2S_MODE_MASTER | I2S_MODE_TX,
+        .sample_rate = rate,
+        .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
+        .channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT,
+        .communication_format = I2S_COMM_FORMAT_STAND_I2S,
+        .intr_alloc_flags = 0,
+        .dma_buf_count = DMA_BUF_COUNT,
+        .dma_buf_len = DMA_BUF_LEN,
+        .use_apll = true,
+        .tx_desc_auto_clear = true,
+    };
+    i2s_pin_config_t pin_config = {
+        .mck_io_num = I2S_PIN_NO_CHANGE,
+        .bck_io_num = config->i2s_bck_pin,
+        .ws_io_num = config->i2s_ws_pin,
+        .data_out_num = config->i2s_data_pin,
+        .data_in_num = I2S_PIN_NO_CHANGE,
+    };
+
+    esp_err_t err = i2s_driver_install(I2S_OUTPUT_NUM, &i2s_config, 0, NULL);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to install I2S driver: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    err = i2s_set_pin(I2S_OUTPUT_NUM, &pin_config);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set I2S pins (bck=%d, ws=%d, data=%d): %s",
+                 pin_config.bck_io_num, pin_config.ws_io_num, pin_config.data_out_num, esp_err_to_name(err));
+        i2s_driver_uninstall(I2S_OUTPUT_NUM);
+        return err;
+    }
+    return ESP_OK;
+#else
+    ESP_LOGE(TAG, "This chip has no I2S port to spare for a DAC");
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t i2s_output_write(const uint8_t *data, size_t size, TickType_t timeout)
+{
+#ifdef I2S_OUTPUT_NUM
+    // The DMA keeps clocking out (silence once drained), so room always frees up
+    // within a buffer period and the whole chunk goes out
+    while (size > 0) {
+        size_t written = 0;
+        esp_err_t err = i2s_write(I2S_OUTPUT_NUM, data, size, &written, timeout);
+        if (err != ESP_OK) {
+            return err;
+        }
+        data += written;
+        size -= written;
+    }
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t i2s_output_set_sample_rate(uint32_t rate)
+{
+#ifdef I2S_OUTPUT_NUM
+    return i2s_set_sample_rates(I2S_OUTPUT_NUM, rate);
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+/*
+ * initialize a plain I2S DAC output on its own I2S port
+ *   rate: sampling rate, 44100Hz, 48000Hz etc.
+ *   returns ESP_OK on success, or error code on failure
+ */
+esp_err_t i2s_output_init(uint32_t rate);
+
+/*
+ * send 16bit PCM stereo data to the DAC
+ *   timeout: longest wait for each DMA buffer to free up
+ */
+esp_err_t i2s_output_write(const uint8_t *data, size_t size, TickType_t timeout);
+
+/*
+ * change sampling rate
+ */
+esp_err_t i2s_output_set_sample_rate(uint32_t rate);
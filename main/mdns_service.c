@@ -1,6 +1,12 @@
 #include "mdns_service.h"
+#include "config_manager.h"
+#include "channel_map.h"
 #include "mdns.h"
+#include "esp_mac.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "esp_netif.h"
 #include "esp_wifi.h"
 #include "lwip/sockets.h"
@@ -8,14 +14,40 @@
 #include "lwip/ip4_addr.h"
 
 #include <string.h>
+#include <stdlib.h>
 
 static const char *TAG = "MDNS_SERVICE";
 
-#define MDNS_INSTANCE_NAME "ESP32 Scream Receiver"
+// The last three MAC bytes are appended to both so receivers on one network stay apart
+#define MDNS_INSTANCE_PREFIX "ESP32 Scream Receiver"
+#define MDNS_HOSTNAME_PREFIX "scream-receiver"
 #define MDNS_SERVICE_TYPE "_scream"
 #define MDNS_PROTO "_udp"
 #define MDNS_PORT 4010 // Scream data port, not mDNS port (5353)
 #define MDNS_SCREAM_HOST "_sink._scream._udp"
+#define SCREAM_CHUNK_SIZE 1152 // PCM bytes per Scream packet, used for the advertised latency
+
+// Receiver discovery, runs in its own task so lookups never block audio
+#define MDNS_BROWSE_INTERVAL_MS 15000
+#define MDNS_BROWSE_TIMEOUT_MS 3000
+#define MDNS_BROWSE_MAX_RESULTS 16
+#define MDNS_BROWSE_TASK_STACK_SIZE 4096
+#define MDNS_BROWSE_TASK_PRIORITY 2
+// Used when a result carries no TTL
+#define MDNS_DEFAULT_TTL_S 120
+
+// Discovered receivers, expired entries are dropped on the next refresh
+typedef struct {
+    mdns_receiver_t info;
+    int64_t expires_us;
+} receiver_entry_t;
+
+static receiver_entry_t s_receivers[MDNS_MAX_RECEIVERS];
+static int s_receiver_count = 0;
+static portMUX_TYPE s_receivers_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t s_browse_task_handle = NULL;
+static char s_instance_name[sizeof(MDNS_INSTANCE_PREFIX) + 7];
+static char s_hostname[sizeof(MDNS_HOSTNAME_PREFIX) + 7];
 
 // Function to get the local IP address that would be used to reach a remote IP
 static esp_ip4_addr_t get_local_ip_for_remote(const esp_ip4_addr_t *remote_ip)
@@ -83,25 +115,69 @@ void mdns_service_start(void)
         return;
     }
 
+    uint8_t mac[6] = {0};
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    snprintf(s_hostname, sizeof(s_hostname), "%s-%02x%02x%02x", MDNS_HOSTNAME_PREFIX, mac[3], mac[4], mac[5]);
+    snprintf(s_instance_name, sizeof(s_instance_name), "%s %02X%02X%02X", MDNS_INSTANCE_PREFIX, mac[3], mac[4], mac[5]);
+
+    err = mdns_hostname_set(s_hostname);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "mdns_hostname_set failed: %d", err);
+        mdns_free(); // Clean up
+        return;
+    }
+
     // Set default instance
-    err = mdns_instance_name_set(MDNS_INSTANCE_NAME);
+    err = mdns_instance_name_set(s_instance_name);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "mdns_instance_name_set failed: %d", err);
         mdns_free(); // Clean up
         return;
     }
 
-    // Structure with TXT records
+    // Structure with TXT records, the format and latency let senders pick the best receiver
+    app_config_t *config = config_manager_get_config();
+    char bit_depth_str[4];
+    char sample_rate_str[8];
+    char latency_str[8];
+    char channels_str[4];
+    uint32_t chunk_us = (uint32_t)((uint64_t)SCREAM_CHUNK_SIZE * 1000000 /
+                                   (config->sample_rate * (config->bit_depth / 8) * 2));
+    snprintf(bit_depth_str, sizeof(bit_depth_str), "%u", config->bit_depth);
+    snprintf(sample_rate_str, sizeof(sample_rate_str), "%" PRIu32, config->sample_rate);
+    snprintf(latency_str, sizeof(latency_str), "%" PRIu32, config->initial_buffer_size * chunk_us / 1000);
+    // Stream channels the configured map plays, senders with more are ranked out by browsers
+    uint8_t channels;
+    const char *layout;
+    switch (config->channel_mode) {
+    case CHANNEL_MAP_MONO:
+        channels = config->channel_select + 1;
+        layout = "mono";
+        break;
+    case CHANNEL_MAP_DOWNMIX:
+        channels = SCREAM_MAX_CHANNELS;
+        layout = "downmix";
+        break;
+    default:
+        channels = 2 * (config->channel_select + 1);
+        layout = "stereo";
+        break;
+    }
+    if (channels > SCREAM_MAX_CHANNELS) {
+        channels = SCREAM_MAX_CHANNELS;
+    }
+    snprintf(channels_str, sizeof(channels_str), "%u", channels);
     mdns_txt_item_t serviceTxtData[] = {
         {"type", "sink"},
-        {"bit_depth", "16"},
-        {"sample_rate", "48000"},
-        {"channels", "2"},
-        {"channel_layout", "stereo"}
+        {"bit_depth", bit_depth_str},
+        {"sample_rate", sample_rate_str},
+        {"channels", channels_str},
+        {"channel_layout", layout},
+        {"latency_ms", latency_str}
     }; 
 
     // Add service
-    err = mdns_service_add(MDNS_INSTANCE_NAME, MDNS_SERVICE_TYPE, MDNS_PROTO, MDNS_PORT, serviceTxtData, sizeof(serviceTxtData) / sizeof(serviceTxtData[0]));
+    err = mdns_service_add(s_instance_name, MDNS_SERVICE_TYPE, MDNS_PROTO, MDNS_PORT, serviceTxtData, sizeof(serviceTxtData) / sizeof(serviceTxtData[0]));
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "mdns_service_add failed: %d", err);
         mdns_free(); // Clean up
@@ -136,7 +212,216 @@ void mdns_service_start(void)
         }
     }
 
-    ESP_LOGI(TAG, "mDNS service started: %s.%s.%s port %d", MDNS_INSTANCE_NAME, MDNS_SERVICE_TYPE, MDNS_PROTO, MDNS_PORT);
+    ESP_LOGI(TAG, "mDNS service started: %s.%s.%s port %d on %s.local", s_instance_name, MDNS_SERVICE_TYPE, MDNS_PROTO,
+             MDNS_PORT, s_hostname);
+}
+
+// Look up a TXT value of a browse result, NULL if the key isn't present
+static const char *find_txt(const mdns_result_t *result, const char *key)
+{
+    for (size_t i = 0; i < result->txt_count; i++) {
+        if (strcmp(result->txt[i].key, key) == 0) {
+            return result->txt[i].value;
+        }
+    }
+    return NULL;
+}
+
+static uint32_t txt_to_u32(const mdns_result_t *result, const char *key)
+{
+    const char *value = find_txt(result, key);
+    return value ? (uint32_t)strtoul(value, NULL, 10) : 0;
+}
+
+// Add or refresh a receiver in the cache
+static void cache_result(const mdns_result_t *result, uint32_t own_ip, int64_t now)
+{
+    if (result->instance_name == NULL) {
+        return;
+    }
+
+    // Use the first IPv4 address that isn't our own
+    uint32_t ip = 0;
+    for (mdns_ip_addr_t *addr = result->addr; addr != NULL; addr = addr->next) {
+        if (addr->addr.type == ESP_IPADDR_TYPE_V4 && addr->addr.u_addr.ip4.addr != own_ip) {
+            ip = addr->addr.u_addr.ip4.addr;
+            break;
+        }
+    }
+    if (ip == 0) {
+        return;
+    }
+
+    mdns_receiver_t info = {0};
+    strncpy(info.instance_name, result->instance_name, sizeof(info.instance_name) - 1);
+    if (result->hostname) {
+        strncpy(info.hostname, result->hostname, sizeof(info.hostname) - 1);
+    }
+    info.ip = ip;
+    info.port = result->port;
+    info.sample_rate = txt_to_u32(result, "sample_rate");
+    info.bit_depth = (uint8_t)txt_to_u32(result, "bit_depth");
+    info.channels = (uint8_t)txt_to_u32(result, "channels");
+    info.latency_ms = txt_to_u32(result, "latency_ms");
+    uint32_t ttl = result->ttl ? result->ttl : MDNS_DEFAULT_TTL_S;
+
+    taskENTER_CRITICAL(&s_receivers_lock);
+    int slot = -1;
+    for (int i = 0; i < s_receiver_count; i++) {
+        if (s_receivers[i].info.ip == ip && s_receivers[i].info.port == info.port) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0 && s_receiver_count < MDNS_MAX_RECEIVERS) {
+        slot = s_receiver_count++;
+    }
+    if (slot >= 0) {
+        s_receivers[slot].info = info;
+        s_receivers[slot].expires_us = now + (int64_t)ttl * 1000000;
+    }
+    taskEXIT_CRITICAL(&s_receivers_lock);
+}
+
+// Drop receivers whose TTL has run out
+static void expire_receivers(int64_t now)
+{
+    taskENTER_CRITICAL(&s_receivers_lock);
+    int kept = 0;
+    for (int i = 0; i < s_receiver_count; i++) {
+        if (s_receivers[i].expires_us > now) {
+            s_receivers[kept++] = s_receivers[i];
+        }
+    }
+    s_receiver_count = kept;
+    taskEXIT_CRITICAL(&s_receivers_lock);
+}
+
+static uint32_t get_own_ip(void)
+{
+    esp_netif_ip_info_t ip_info;
+    esp_netif_t *netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    if (netif == NULL || esp_netif_get_ip_info(netif, &ip_info) != ESP_OK) {
+        return 0;
+    }
+    return ip_info.ip.addr;
+}
+
+// Periodically browses for Scream receivers while the USB sender is enabled
+static void mdns_browse_task(void *arg)
+{
+    while (1) {
+        if (config_manager_get_config()->enable_usb_sender) {
+            mdns_search_once_t *search = mdns_query_async_new(NULL, MDNS_SERVICE_TYPE, MDNS_PROTO, MDNS_TYPE_PTR,
+                                                              MDNS_BROWSE_TIMEOUT_MS, MDNS_BROWSE_MAX_RESULTS, NULL);
+            if (search == NULL) {
+                ESP_LOGW(TAG, "Failed to start receiver browse");
+            } else {
+                mdns_result_t *results = NULL;
+                uint8_t num_results = 0;
+                // Only this task waits here, the query completes after MDNS_BROWSE_TIMEOUT_MS
+                mdns_query_async_get_results(search, MDNS_BROWSE_TIMEOUT_MS + 500, &results, &num_results);
+
+                int64_t now = esp_timer_get_time();
+                uint32_t own_ip = get_own_ip();
+                for (mdns_result_t *r = results; r != NULL; r = r->next) {
+                    cache_result(r, own_ip, now);
+                }
+                ESP_LOGD(TAG, "Receiver browse returned %u result(s)", num_results);
+                if (results) {
+                    mdns_query_results_free(results);
+                }
+                mdns_query_async_delete(search);
+            }
+        }
+
+        expire_receivers(esp_timer_get_time());
+        vTaskDelay(pdMS_TO_TICKS(MDNS_BROWSE_INTERVAL_MS));
+    }
+}
+
+void mdns_service_start_browse(void)
+{
+    if (s_browse_task_handle != NULL) {
+        return;
+    }
+
+    if (xTaskCreate(mdns_browse_task, "mdns_browse", MDNS_BROWSE_TASK_STACK_SIZE, NULL,
+                    MDNS_BROWSE_TASK_PRIORITY, &s_browse_task_handle) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create mDNS browse task");
+        s_browse_task_handle = NULL;
+    }
+}
+
+int mdns_service_get_receivers(mdns_receiver_t *receivers, int max_receivers)
+{
+    int64_t now = esp_timer_get_time();
+    int count = 0;
+
+    taskENTER_CRITICAL(&s_receivers_lock);
+    for (int i = 0; i < s_receiver_count && count < max_receivers; i++) {
+        if (s_receivers[i].expires_us > now) {
+            receivers[count] = s_receivers[i].info;
+            receivers[count].ttl_remaining_s = (uint32_t)((s_receivers[i].expires_us - now) / 1000000);
+            count++;
+        }
+    }
+    taskEXIT_CRITICAL(&s_receivers_lock);
+    return count;
+}
+
+// Higher is better, negative if the receiver can't play the format
+static int score_receiver(const mdns_receiver_t *rx, uint32_t sample_rate, uint8_t bit_depth, uint8_t channels)
+{
+    // Receivers that don't advertise a format are assumed to take anything, but rank last
+    if (rx->sample_rate == 0 && rx->bit_depth == 0 && rx->channels == 0) {
+        return 0;
+    }
+    if ((rx->sample_rate && rx->sample_rate != sample_rate) ||
+        (rx->bit_depth && rx->bit_depth != bit_depth) ||
+        (rx->channels && rx->channels < channels)) {
+        return -1;
+    }
+    // Prefer an exact channel match, then the lowest advertised latency
+    int score = 1000;
+    if (rx->channels == channels) {
+        score += 1000;
+    }
+    if (rx->latency_ms < 1000) {
+        score += 1000 - (int)rx->latency_ms;
+    }
+    return score;
+}
+
+bool mdns_service_find_receiver(const char *name, uint32_t sample_rate, uint8_t bit_depth, uint8_t channels,
+                                mdns_receiver_t *receiver)
+{
+    mdns_receiver_t receivers[MDNS_MAX_RECEIVERS];
+    int count = mdns_service_get_receivers(receivers, MDNS_MAX_RECEIVERS);
+    bool automatic = strcmp(name, MDNS_RECEIVER_AUTO) == 0;
+    int best = -1;
+    int best_score = -1;
+
+    for (int i = 0; i < count; i++) {
+        if (!automatic) {
+            if (strcmp(receivers[i].instance_name, name) == 0 || strcmp(receivers[i].hostname, name) == 0) {
+                *receiver = receivers[i];
+                return true;
+            }
+            continue;
+        }
+        int score = score_receiver(&receivers[i], sample_rate, bit_depth, channels);
+        if (score > best_score) {
+            best = i;
+            best_score = score;
+        }
+    }
+
+    if (best < 0) {
+        return false;
+    }
+    *receiver = receivers[best];
+    return true;
 }
 
 /**
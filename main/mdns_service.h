@@ -1,16 +1,43 @@
 #ifndef MDNS_SERVICE_H
 #define MDNS_SERVICE_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Receivers kept in the discovery cache
+#define MDNS_MAX_RECEIVERS 8
+
+// Receiver name that selects the best matching receiver instead of a fixed one
+#define MDNS_RECEIVER_AUTO "auto"
+
+/**
+ * @brief A Scream receiver found by browsing "_scream._udp".
+ *
+ * Format and latency fields are 0 when the receiver doesn't advertise them.
+ */
+typedef struct {
+    char instance_name[64];
+    char hostname[64];
+    uint32_t ip;                // IPv4 address, network byte order
+    uint16_t port;
+    uint32_t sample_rate;
+    uint8_t bit_depth;
+    uint8_t channels;
+    uint32_t latency_ms;        // Advertised buffering latency
+    uint32_t ttl_remaining_s;   // Seconds until the cache entry expires
+} mdns_receiver_t;
+
 /**
  * @brief Initializes and starts the mDNS service.
  *
  * Sets up the mDNS service with the delegate hostname "_sink._screamrouter" and advertises
- * the "_scream._udp" service on port 4010 (Scream data port).
- * Includes TXT records for service type and potentially audio settings later.
+ * the "_scream._udp" service on port 4010 (Scream data port). The hostname and instance
+ * name end in the last three MAC bytes, and the TXT records carry the format, latency
+ * and the stream channels the configured channel map plays.
  */
 void mdns_service_start(void);
 
@@ -19,6 +46,39 @@ void mdns_service_start(void);
  */
 void mdns_service_stop(void);
 
+/**
+ * @brief Starts browsing for Scream receivers in a background task.
+ *
+ * While the USB sender is enabled "_scream._udp" is queried periodically and
+ * the results are cached until their TTL runs out.
+ */
+void mdns_service_start_browse(void);
+
+/**
+ * @brief Copies the cached receivers, never blocks on the network.
+ *
+ * @param receivers Array receiving the cached receivers
+ * @param max_receivers Number of entries receivers can hold
+ * @return Number of entries filled in
+ */
+int mdns_service_get_receivers(mdns_receiver_t *receivers, int max_receivers);
+
+/**
+ * @brief Finds a cached receiver by instance name or hostname, never blocks on the network.
+ *
+ * With the name MDNS_RECEIVER_AUTO the receiver that best matches the given
+ * format is chosen, preferring an exact channel count and then the lowest latency.
+ *
+ * @param name Instance name, hostname or MDNS_RECEIVER_AUTO
+ * @param sample_rate Sample rate the sender transmits
+ * @param bit_depth Bit depth the sender transmits
+ * @param channels Channel count the sender transmits
+ * @param receiver Filled with the selected receiver
+ * @return true if a receiver was found
+ */
+bool mdns_service_find_receiver(const char *name, uint32_t sample_rate, uint8_t bit_depth, uint8_t channels,
+                                mdns_receiver_t *receiver);
+
 #ifdef __cplusplus
 }
 #endif
@@ -12,6 +12,7 @@
 #include "esp_log.h"
 #include "nvs_flash.h"
 #include "esp_sleep.h"
+#include "esp_timer.h"
 
 #include "lwip/err.h"
 #include "lwip/sys.h"
@@ -22,22 +23,18 @@
 #include <errno.h>
 #include <netdb.h>            // struct addrinfo
 #include <arpa/inet.h>
-#include <sys/select.h>       // Added for select()
 #include "esp_netif.h"
 #include "audio.h"
 #include "wifi_manager.h"
 
-// Reference to sleep mode monitoring variables
-extern volatile uint32_t packet_counter;
-extern volatile bool monitoring_active;
-extern volatile TickType_t last_packet_time;
-
 const uint16_t HEADER_SIZE = 5;                         // Scream Header byte size, non-configurable (Part of Scream)
 const uint16_t PACKET_SIZE = PCM_CHUNK_SIZE + HEADER_SIZE;
 bool use_tcp = false;
 bool connected = false;
 
 char server[16] = {0};
+// Connected ScreamRouter socket, -1 when there is none
+static int s_tcp_sock = -1;
 
 void udp_handler(void *);
 void tcp_handler(void *);
@@ -76,35 +73,15 @@ void tcp_handler(void *) {
       ESP_LOGI(TAG, "wifi isn't connecting");
   }
   ESP_LOGI(TAG, "Connected to ScreamRouter");
-  uint8_t data[PACKET_SIZE * 2];
+  // Offset so the PCM after the 5 byte header is word aligned for channel mapping
+  uint8_t rx[PACKET_SIZE * 2 + 3] __attribute__((aligned(4)));
+  uint8_t *data = rx + 3;
   uint16_t datahead = 0;
   resume_playback();
+  s_tcp_sock = sock;
   while (connected) {
-    fd_set read_fds;
-    struct timeval tv;
-    int select_result;
-
-    FD_ZERO(&read_fds);
-    FD_SET(sock, &read_fds);
-
-    tv.tv_sec = 0;
-    tv.tv_usec = 100000; // 100ms
-
-    select_result = select(sock + 1, &read_fds, NULL, NULL, &tv);
-
-    if (select_result < 0) {
-        ESP_LOGE(TAG, "TCP select error: errno %d", errno);
-        connected = false; // Or handle error differently
-        continue;
-    } else if (select_result == 0) {
-        // Timeout occurred, no data ready, loop continues (replaces vTaskDelay)
-        continue;
-    }
-    // Only proceed if select indicates data is ready (select_result > 0 and FD_ISSET)
-    if (!FD_ISSET(sock, &read_fds)) {
-        continue; // Should not happen if select_result > 0, but good practice
-    }
-
+    // Block until data arrives so the CPU can light sleep in between,
+    // restart_network() shuts the socket down to end the wait
 	int result = recv(sock, data + datahead, PACKET_SIZE, 0);
 	if (result <= 0) { // Handle error or closed connection
         if (result < 0) {
@@ -116,30 +93,16 @@ void tcp_handler(void *) {
         continue;
     }
 	datahead += result;
-	
-	// Track packet reception for activity detection during sleep mode
-	if (result > 0 && monitoring_active) {
-	    packet_counter++;
-	    last_packet_time = xTaskGetTickCount(); // Update last packet time
-        // Signal the network monitor task that a packet was received
-        if (s_network_activity_event_group != NULL) {
-            xEventGroupSetBits(s_network_activity_event_group, NETWORK_PACKET_RECEIVED_BIT);
-        }
-	}
-	
+
 	if (datahead >= PACKET_SIZE) {
-	    // Use direct write or buffered mode based on configuration
-	    if (config->use_direct_write) {
-		    audio_direct_write(data + HEADER_SIZE);
-	    } else {
-		    //push_chunk(data + HEADER_SIZE);
-            audio_direct_write(data + HEADER_SIZE);
-	    }
+	    // Buffered or direct write is chosen from the configuration, audio.c
+	    // also counts audible packets as activity for waking from sleep
+	    audio_receive(data, esp_timer_get_time());
 		memcpy(data, data + PACKET_SIZE, PACKET_SIZE);
 		datahead -= PACKET_SIZE;
 	}
-    // vTaskDelay(1) removed, replaced by select timeout
   }
+  s_tcp_sock = -1;
   close(sock);
   stop_playback();
   xTaskCreatePinnedToCore(udp_handler, "udp_handler", 8192, NULL, 1, NULL, 1);
@@ -147,7 +110,9 @@ void tcp_handler(void *) {
 }
 
 void udp_handler(void *) {
-	uint8_t data[PACKET_SIZE * 2];
+	// Offset so the PCM after the 5 byte header is word aligned for channel mapping
+	uint8_t rx[PACKET_SIZE * 2 + 3] __attribute__((aligned(4)));
+	uint8_t *data = rx + 3;
 	uint16_t datahead = 0;
 	empty_buffer();
     while (1) {
@@ -183,38 +148,13 @@ void udp_handler(void *) {
             ESP_LOGI(TAG, "Device is in sleep mode - not resuming playback");
         }
         while (1) {
-            fd_set read_fds;
-            struct timeval tv;
-            int select_result;
-
-            FD_ZERO(&read_fds);
-            FD_SET(sock, &read_fds);
-
-            tv.tv_sec = 0;
-            tv.tv_usec = 100000; // 100ms
-
-            select_result = select(sock + 1, &read_fds, NULL, NULL, &tv);
-
-            if (select_result < 0) {
-                ESP_LOGE(TAG, "UDP select error: errno %d", errno);
-                // Decide how to handle UDP select error, maybe break or continue
-                vTaskDelay(pdMS_TO_TICKS(100)); // Avoid busy-looping on error
-                continue;
-            } else if (select_result == 0) {
-                // Timeout occurred, no data ready, loop continues (replaces vTaskDelay)
-                continue;
-            }
-            // Only proceed if select indicates data is ready (select_result > 0 and FD_ISSET)
-             if (!FD_ISSET(sock, &read_fds)) {
-                continue; // Should not happen if select_result > 0
-            }
-
-            // Data is ready, proceed with recv
+            // Block without a timeout, nothing else runs in this task and a
+            // periodic wake would keep the CPU out of light sleep
             int result = recv(sock, data + datahead, PACKET_SIZE, 0);
 
             if (result < 0) {
                 ESP_LOGE(TAG, "UDP recv error: errno %d", errno);
-                // Handle recv error if necessary, maybe continue
+                vTaskDelay(pdMS_TO_TICKS(100)); // Avoid busy-looping on error
                 continue;
             }
             if (result == 0) {
@@ -224,18 +164,6 @@ void udp_handler(void *) {
                 continue;
             }
 
-			// Track packet reception for activity detection during sleep mode
-			if (result > 0 && monitoring_active) {
-			    packet_counter++;
-			    last_packet_time = xTaskGetTickCount(); // Update last packet time
-                // Signal the network monitor task that a packet was received
-                if (s_network_activity_event_group != NULL) {
-                    xEventGroupSetBits(s_network_activity_event_group, NETWORK_PACKET_RECEIVED_BIT);
-                }
-			    // If we're in sleep mode and detected sufficient activity,
-			    // this will be handled by the monitor task
-			}
-			
 			if (result && use_tcp) {
 				struct sockaddr_in addr;
 				socklen_t addrlen = sizeof(struct sockaddr_in);
@@ -249,17 +177,12 @@ void udp_handler(void *) {
 			}
 		 	datahead += result;
 			if (datahead >= PACKET_SIZE) {
-			    // Use direct write or buffered mode based on configuration
-			    if (config->use_direct_write) {
-				    audio_direct_write(data + HEADER_SIZE);
-			    } else {
-				    //push_chunk(data + HEADER_SIZE);
-                    audio_direct_write(data + HEADER_SIZE);
-			    }
+			    // Buffered or direct write is chosen from the configuration, audio.c
+			    // also counts audible packets as activity for waking from sleep
+			    audio_receive(data, esp_timer_get_time());
 				memcpy(data,data + PACKET_SIZE, PACKET_SIZE);
 				datahead -= PACKET_SIZE;
 			}
-             // vTaskDelay(1) removed, replaced by select timeout
         }
 
         if (sock != -1) {
@@ -277,6 +200,11 @@ void setup_network() {
 }	
 
 void restart_network() {
-  if (use_tcp)
+  if (use_tcp) {
     connected = false;
+    // Wake the blocked recv() so tcp_handler sees the flag
+    if (s_tcp_sock >= 0) {
+      shutdown(s_tcp_sock, SHUT_RDWR);
+    }
+  }
 }
@@ -0,0 +1,224 @@
+#include "power.h"
+#include "global.h"
+#include "audio.h"
+#include "buffer.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "sdkconfig.h"
+
+// Set by the silence detector in audio.c
+extern bool is_silent;
+
+#if CONFIG_PM_ENABLE
+// Full CPU clock for the pipeline, and no light sleep, which would stall USB, I2S and S/PDIF
+static esp_pm_lock_handle_t s_cpu_lock = NULL;
+static esp_pm_lock_handle_t s_awake_lock = NULL;
+// No light sleep while a USB DAC is enumerated, taken once per DAC
+static esp_pm_lock_handle_t s_usb_lock = NULL;
+#endif
+static bool s_audio_active = false;
+
+// Wi-Fi power save policy, evaluated once a second while audio flows
+#define WIFI_PS_INTERVAL_US 1000000
+// Jitter that turns power save off, and the level it has to stay under to turn it back on
+#define WIFI_PS_JITTER_HIGH_US 4000
+#define WIFI_PS_JITTER_LOW_US 1500
+// Chunks that have to stay in the buffer for the link to count as clean, running dry turns power save off
+#define WIFI_PS_LOW_WATER 1
+// Clean seconds before modem sleep returns, doubled whenever it had to be turned off again soon after
+#define WIFI_PS_HOLD_S 30
+#define WIFI_PS_MAX_HOLD_S 960
+// Receive current of a radio that never sleeps over modem sleep at DTIM 1, from the datasheet
+#define WIFI_PS_NONE_EXTRA_MA 65.0f
+
+static bool s_wifi_started = false;
+static esp_timer_handle_t s_wifi_ps_timer = NULL;
+// Mode while audio flows, silence sleep always uses WIFI_PS_MAX_MODEM
+static wifi_ps_type_t s_wifi_ps = WIFI_PS_MIN_MODEM;
+static uint32_t s_clean_s = 0;
+static uint32_t s_hold_s = WIFI_PS_HOLD_S;
+static int64_t s_modem_since_us = 0;
+static int64_t s_last_eval_us = 0;
+static int64_t s_none_us = 0;
+static uint32_t s_last_underruns = 0;
+static uint32_t s_switches = 0;
+static uint32_t s_jitter_us = 0;
+static unsigned int s_low_water = MAX_BUFFER_SIZE;
+
+static const char *const s_mode_names[POWER_MODE_COUNT] = { "playing", "idle", "sleep" };
+
+static const char *wifi_ps_name(wifi_ps_type_t mode) {
+    switch (mode) {
+    case WIFI_PS_NONE:
+        return "none";
+    case WIFI_PS_MAX_MODEM:
+        return "max_modem";
+    default:
+        return "min_modem";
+    }
+}
+
+static void apply_wifi_ps(wifi_ps_type_t mode) {
+    if (!s_wifi_started) {
+        return;
+    }
+    esp_err_t err = esp_wifi_set_ps(mode);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to set Wi-Fi power save %s: %s", wifi_ps_name(mode), esp_err_to_name(err));
+    }
+}
+
+static void set_wifi_ps(wifi_ps_type_t mode) {
+    s_wifi_ps = mode;
+    s_switches++;
+    ESP_LOGI(TAG, "Wi-Fi power save %s, jitter %" PRIu32 " us, %u chunks left at worst",
+             wifi_ps_name(mode), s_jitter_us, s_low_water);
+    apply_wifi_ps(mode);
+}
+
+// Power save off as soon as the link struggles, modem sleep back only after
+// s_hold_s clean evaluations in a row
+static void wifi_ps_evaluate(void *arg) {
+    buffer_status_t buffer;
+    buffer_get_status(&buffer);
+    s_jitter_us = audio_get_jitter_us();
+    s_low_water = buffer.low_water;
+    bool underrun = buffer.underruns != s_last_underruns;
+    s_last_underruns = buffer.underruns;
+
+    // Only a stream being played can suffer from late packets
+    bool playing = power_get_mode() == POWER_MODE_PLAYING;
+    bool stressed = playing && (underrun || s_jitter_us > WIFI_PS_JITTER_HIGH_US);
+    bool clean = !playing || (!underrun && s_jitter_us < WIFI_PS_JITTER_LOW_US
+                              && buffer.low_water >= WIFI_PS_LOW_WATER);
+
+    int64_t now = esp_timer_get_time();
+    if (s_wifi_ps == WIFI_PS_NONE) {
+        s_none_us += now - s_last_eval_us;
+        s_clean_s = clean ? s_clean_s + 1 : 0;
+        if (s_clean_s >= s_hold_s) {
+            s_modem_since_us = now;
+            set_wifi_ps(WIFI_PS_MIN_MODEM);
+        }
+    } else if (stressed) {
+        // Modem sleep that didn't last twice the hold time waits longer next time
+        if (s_modem_since_us != 0 && now - s_modem_since_us < (int64_t)s_hold_s * 2 * 1000000) {
+            s_hold_s = s_hold_s * 2 > WIFI_PS_MAX_HOLD_S ? WIFI_PS_MAX_HOLD_S : s_hold_s * 2;
+        } else {
+            s_hold_s = WIFI_PS_HOLD_S;
+        }
+        s_clean_s = 0;
+        set_wifi_ps(WIFI_PS_NONE);
+    }
+    s_last_eval_us = now;
+}
+
+void power_init(void) {
+#if CONFIG_PM_ENABLE
+    // Without a lock held the clock drops to the crystal and, with tickless
+    // idle, the chip light sleeps until the next timer or Wi-Fi beacon
+    esp_pm_config_t pm_config = {
+        .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = CONFIG_XTAL_FREQ,
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+        .light_sleep_enable = true,
+#endif
+    };
+    esp_err_t err = esp_pm_configure(&pm_config);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Power management not available: %s", esp_err_to_name(err));
+        return;
+    }
+    ESP_ERROR_CHECK(esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "audio_cpu", &s_cpu_lock));
+    ESP_ERROR_CHECK(esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "audio_awake", &s_awake_lock));
+    ESP_ERROR_CHECK(esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "usb_dac", &s_usb_lock));
+    ESP_LOGI(TAG, "Power management: %d-%d MHz, light sleep %s", pm_config.min_freq_mhz,
+             pm_config.max_freq_mhz, pm_config.light_sleep_enable ? "on" : "off");
+#else
+    ESP_LOGW(TAG, "Power management not enabled in menuconfig");
+#endif
+    power_set_audio_active(true);
+}
+
+void power_set_audio_active(bool active) {
+    if (active == s_audio_active) {
+        return;
+    }
+    s_audio_active = active;
+    if (s_wifi_ps_timer != NULL) {
+        if (active) {
+            s_last_eval_us = esp_timer_get_time();
+            esp_timer_start_periodic(s_wifi_ps_timer, WIFI_PS_INTERVAL_US);
+        } else {
+            esp_timer_stop(s_wifi_ps_timer);
+        }
+    }
+    // Silence sleep only needs to hear the packets that wake it, at every third beacon
+    apply_wifi_ps(active ? s_wifi_ps : WIFI_PS_MAX_MODEM);
+#if CONFIG_PM_ENABLE
+    if (s_cpu_lock == NULL) {
+        return;
+    }
+    if (active) {
+        esp_pm_lock_acquire(s_cpu_lock);
+        esp_pm_lock_acquire(s_awake_lock);
+    } else {
+        esp_pm_lock_release(s_awake_lock);
+        esp_pm_lock_release(s_cpu_lock);
+    }
+#endif
+}
+
+void power_set_dac_attached(bool attached) {
+#if CONFIG_PM_ENABLE
+    if (s_usb_lock == NULL) {
+        return;
+    }
+    // The lock counts, so each DAC holds it once
+    if (attached) {
+        esp_pm_lock_acquire(s_usb_lock);
+    } else {
+        esp_pm_lock_release(s_usb_lock);
+    }
+#endif
+}
+
+power_mode_t power_get_mode(void) {
+    if (device_sleeping) {
+        return POWER_MODE_SLEEP;
+    }
+    return is_playing() && !is_silent ? POWER_MODE_PLAYING : POWER_MODE_IDLE;
+}
+
+const char *power_mode_name(power_mode_t mode) {
+    return mode < POWER_MODE_COUNT ? s_mode_names[mode] : "unknown";
+}
+
+void power_start_wifi(void) {
+    s_wifi_started = true;
+    const esp_timer_create_args_t timer_args = {
+        .callback = wifi_ps_evaluate,
+        .name = "wifi_ps",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &s_wifi_ps_timer));
+    apply_wifi_ps(s_audio_active ? s_wifi_ps : WIFI_PS_MAX_MODEM);
+    if (s_audio_active) {
+        s_last_eval_us = esp_timer_get_time();
+        esp_timer_start_periodic(s_wifi_ps_timer, WIFI_PS_INTERVAL_US);
+    }
+}
+
+void power_get_wifi_status(power_wifi_status_t *status) {
+    wifi_ps_type_t mode = s_audio_active ? s_wifi_ps : WIFI_PS_MAX_MODEM;
+    status->mode = wifi_ps_name(mode);
+    status->jitter_us = s_jitter_us;
+    status->low_water = s_low_water;
+    status->switches = s_switches;
+    status->hold_s = s_hold_s;
+    status->none_seconds = s_none_us / 1000000.0f;
+    status->extra_ma = mode == WIFI_PS_NONE ? WIFI_PS_NONE_EXTRA_MA : 0.0f;
+    int64_t uptime_us = esp_timer_get_time();
+    status->average_extra_ma = uptime_us > 0 ? WIFI_PS_NONE_EXTRA_MA * s_none_us / uptime_us : 0.0f;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// What the receiver is doing, the power and latency reports are kept per mode
+typedef enum {
+    POWER_MODE_PLAYING,     // Audible audio going to the outputs
+    POWER_MODE_IDLE,        // Awake on a silent stream or with nothing to play to
+    POWER_MODE_SLEEP,       // Silence sleep, the CPU light sleeps between Wi-Fi beacons
+    POWER_MODE_COUNT
+} power_mode_t;
+
+/**
+ * @brief Set up frequency scaling and automatic light sleep, then take the locks
+ * that keep the CPU at full clock and awake while audio flows
+ */
+void power_init(void);
+
+/**
+ * @brief Hold the power management locks while audio flows, release them for
+ * silence sleep so the CPU can drop to the crystal clock and light sleep
+ */
+void power_set_audio_active(bool active);
+
+/**
+ * @brief Keep the chip out of light sleep while a USB DAC is enumerated, the USB
+ * host can't answer the bus from light sleep and the DAC would drop off it.
+ * Call once when each DAC opens and once when it goes away.
+ */
+void power_set_dac_attached(bool attached);
+
+power_mode_t power_get_mode(void);
+
+const char *power_mode_name(power_mode_t mode);
+
+// Wi-Fi power save chosen by the policy, see power_get_wifi_status()
+typedef struct {
+    const char *mode;           // "none", "min_modem", or "max_modem" in silence sleep
+    uint32_t jitter_us;         // Packet inter-arrival jitter at the last evaluation
+    unsigned int low_water;     // Fewest chunks buffered over the last evaluation
+    uint32_t switches;          // Times the policy changed the mode
+    uint32_t hold_s;            // Clean seconds needed before modem sleep returns
+    float none_seconds;         // Time spent with power save off
+    float extra_ma;             // Estimated radio current the current mode costs over modem sleep
+    float average_extra_ma;     // Same, averaged since boot
+} power_wifi_status_t;
+
+/**
+ * @brief Apply the Wi-Fi power save policy once Wi-Fi has started. While audio flows
+ * power save goes off when packets arrive late or the buffer runs low, and
+ * modem sleep returns once the link has stayed clean for a while.
+ */
+void power_start_wifi(void);
+
+void power_get_wifi_status(power_wifi_status_t *status);
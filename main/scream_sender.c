@@ -2,31 +2,60 @@
 #ifdef IS_USB
 #include "scream_sender.h"
 #include "config_manager.h"
+#include "gain.h"
 #include "esp_log.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
 #include "usb_device_uac.h"
 #include "lwip/err.h"
 #include "lwip/sockets.h"
 #include <lwip/netdb.h>
 #include <string.h>
-#include <math.h>
-#include "esp_rom_sys.h" // For ets_delay_us
+#include <stdlib.h>
+#include <stdatomic.h>
 
 #define TAG "scream_sender"
 
-// Scream header for 16-bit 48KHz stereo audio
-static const char header[] = {1, 16, 2, 0, 0};
-#define HEADER_SIZE sizeof(header)
+// Scream packets carry a 5 byte format header and a fixed 1152 byte PCM payload
+#define HEADER_SIZE 5
 #define CHUNK_SIZE 1152
 #define PACKET_SIZE (CHUNK_SIZE + HEADER_SIZE)
+// The header is placed so the PCM payload that follows it is 4 byte aligned
+#define PACKET_OFFSET (8 - HEADER_SIZE)
+
+// Input format of the USB audio device, the component delivers 16-bit PCM
+#ifdef CONFIG_UAC_SAMPLE_RATE
+#define USB_SAMPLE_RATE CONFIG_UAC_SAMPLE_RATE
+#else
+#define USB_SAMPLE_RATE 48000
+#endif
+#ifdef CONFIG_UAC_SPEAKER_CHANNEL_NUM
+#define USB_CHANNELS CONFIG_UAC_SPEAKER_CHANNEL_NUM
+#else
+#define USB_CHANNELS 2
+#endif
+#define USB_BIT_DEPTH 16
 
 // Socket options
 #define UDP_TX_BUFFER_SIZE (1024 * 32)
 #define UDP_SEND_TIMEOUT_MS 10
-#define MAX_SEND_RETRIES 3
+
+// Multicast packets stay on the local network
+#define MULTICAST_TTL 1
+
+#define TX_TASK_PRIORITY 5
+#define TX_TASK_STACK_SIZE 4096
+// Send an extra chunk in a tick when more than this many chunks are queued,
+// so the ring drains if the USB clock runs slightly faster than ours
+#define TX_CATCHUP_CHUNKS 3
+
+// Ring between the USB callback and the TX task, must be a power of two
+#define RING_SIZE (1024 * 16)
+#define RING_MASK (RING_SIZE - 1)
 
 // State variables
 static bool s_is_sender_initialized = false;
@@ -34,69 +63,247 @@ static bool s_is_sender_running = false;
 static bool s_is_muted = false;
 static uint32_t s_volume = 100;
 static int s_sock = -1;
-static struct sockaddr_in s_dest_addr;
 
-// Buffer for audio data
-static char s_data_out[PACKET_SIZE];
-static char s_data_in[CHUNK_SIZE * 16]; // Increased buffer size
-static int s_data_in_head = 0;
+// Destinations every packet is sent to, guarded by s_dest_lock.
+// Either a single multicast group or one or more unicast/broadcast addresses.
+static struct sockaddr_in s_dest_addr[SCREAM_SENDER_MAX_DESTINATIONS];
+static scream_sender_dest_stats_t s_dest_stats[SCREAM_SENDER_MAX_DESTINATIONS];
+static int s_dest_count = 0;
+static bool s_dest_multicast = false;
+static SemaphoreHandle_t s_dest_lock = NULL;
 
-// UAC callbacks
-static esp_err_t uac_device_output_cb(uint8_t *buf, size_t len, void *arg)
+// Outgoing packet, header followed by one chunk of PCM, starting at PACKET_OFFSET
+static uint8_t s_packet[PACKET_OFFSET + PACKET_SIZE] __attribute__((aligned(4)));
+static uint8_t *const s_data_out = s_packet + PACKET_OFFSET;
+
+// Format being sent and the pacing derived from it
+static scream_sender_format_t s_format;
+static uint32_t s_tx_interval_us = 0;
+static size_t s_frames_per_chunk = 0;
+
+// Single-producer (USB callback) / single-consumer (TX task) ring.
+// Head and tail are free-running byte counters, masked on access.
+static uint8_t s_ring[RING_SIZE];
+static atomic_uint_fast32_t s_ring_head = 0;
+static atomic_uint_fast32_t s_ring_tail = 0;
+
+static TaskHandle_t s_tx_task_handle = NULL;
+static esp_timer_handle_t s_tx_timer = NULL;
+
+// Volume applied to outgoing audio, ramps on every change
+static gain_stage_t s_gain;
+
+// Instrumentation, written by the callback and TX task, read by stats getter
+static scream_sender_stats_t s_stats;
+static int64_t s_last_send_us = 0;
+
+static size_t ring_used(void)
 {
-    if (s_is_muted || !s_is_sender_running)
-        return ESP_OK;
-    
-    // Copy the received data to our buffer
-    memcpy(s_data_in + s_data_in_head, buf, len);
-    s_data_in_head += len;
-    
-    // Process the data in chunks
-    while (s_data_in_head >= CHUNK_SIZE) {
-        // Get volume from config manager
-        app_config_t *config = config_manager_get_config();
-        float volume = config->volume;
-        
-        if (volume < 1.0f) {
-            // Apply volume scaling for 16-bit PCM audio
-            int16_t *samples = (int16_t*)s_data_in;
-            int num_samples = CHUNK_SIZE / 2; // 2 bytes per sample for 16-bit audio
-            
-            for (int i = 0; i < num_samples; i++) {
-                samples[i] = (int16_t)(samples[i] * volume);
+    return (uint32_t)(atomic_load_explicit(&s_ring_head, memory_order_acquire) -
+                      atomic_load_explicit(&s_ring_tail, memory_order_acquire));
+}
+
+// Copy up to len bytes into the ring, returns false if the data didn't fit
+static bool ring_push(const uint8_t *buf, size_t len)
+{
+    uint32_t head = atomic_load_explicit(&s_ring_head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&s_ring_tail, memory_order_acquire);
+    if (RING_SIZE - (head - tail) < len) {
+        return false;
+    }
+
+    uint32_t pos = head & RING_MASK;
+    size_t first = RING_SIZE - pos;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(s_ring + pos, buf, first);
+    memcpy(s_ring, buf + first, len - first);
+
+    atomic_store_explicit(&s_ring_head, head + len, memory_order_release);
+    return true;
+}
+
+// Copy exactly len bytes out of the ring, caller checks ring_used() first
+static void ring_pop(uint8_t *out, size_t len)
+{
+    uint32_t tail = atomic_load_explicit(&s_ring_tail, memory_order_relaxed);
+
+    uint32_t pos = tail & RING_MASK;
+    size_t first = RING_SIZE - pos;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(out, s_ring + pos, first);
+    memcpy(out + first, s_ring, len - first);
+
+    atomic_store_explicit(&s_ring_tail, tail + len, memory_order_release);
+}
+
+static void ring_reset(void)
+{
+    atomic_store(&s_ring_tail, atomic_load(&s_ring_head));
+}
+
+// Parse one IPv4 address, returns false for an empty or invalid entry
+static bool parse_destination(const char *ip, uint16_t port, struct sockaddr_in *addr)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons(port);
+    return inet_aton(ip, &addr->sin_addr) != 0;
+}
+
+// Rebuild the destination table from the primary and extra destinations in the config.
+// A multicast primary address replaces the list, receivers join the group instead.
+static void load_destinations(void)
+{
+    app_config_t *config = config_manager_get_config();
+    struct sockaddr_in addrs[SCREAM_SENDER_MAX_DESTINATIONS];
+    int count = 0;
+    bool multicast = false;
+
+    if (parse_destination(config->sender_destination_ip, config->sender_destination_port, &addrs[0])) {
+        multicast = IN_MULTICAST(ntohl(addrs[0].sin_addr.s_addr));
+        count = 1;
+    } else {
+        ESP_LOGE(TAG, "Invalid destination IP: %s", config->sender_destination_ip);
+    }
+
+    if (!multicast) {
+        char list[SENDER_EXTRA_DESTINATIONS_MAX_LENGTH + 1];
+        strncpy(list, config->sender_extra_destinations, sizeof(list) - 1);
+        list[sizeof(list) - 1] = '\0';
+        char *save = NULL;
+        for (char *ip = strtok_r(list, ", ", &save); ip != NULL; ip = strtok_r(NULL, ", ", &save)) {
+            if (count >= SCREAM_SENDER_MAX_DESTINATIONS) {
+                ESP_LOGW(TAG, "Too many destinations, ignoring %s and later entries", ip);
+                break;
             }
-        }
-        
-        memcpy(s_data_out + HEADER_SIZE, s_data_in, CHUNK_SIZE);
-        
-        // Send with retry logic
-        int sent = -1;
-        int retry_count = 0;
-        
-        while (sent < 0 && retry_count < MAX_SEND_RETRIES) {
-            sent = sendto(s_sock, s_data_out, PACKET_SIZE, 0, 
-                         (struct sockaddr *)&s_dest_addr, sizeof(s_dest_addr));
-                         
-            if (sent < 0) {
-                ESP_LOGW(TAG, "Failed to send UDP packet: errno %d, retry %d", 
-                         errno, retry_count + 1);
-                retry_count++;
-                
-                // Small delay before retry (500 microseconds)
-                esp_rom_delay_us(500);
-            } else if (sent != PACKET_SIZE) {
-                ESP_LOGW(TAG, "Incomplete UDP packet sent: %d of %d bytes", 
-                         sent, PACKET_SIZE);
+            if (!parse_destination(ip, config->sender_destination_port, &addrs[count])) {
+                ESP_LOGW(TAG, "Ignoring invalid destination IP: %s", ip);
+                continue;
             }
+            count++;
+        }
+    }
+
+    xSemaphoreTake(s_dest_lock, portMAX_DELAY);
+    memcpy(s_dest_addr, addrs, count * sizeof(addrs[0]));
+    memset(s_dest_stats, 0, sizeof(s_dest_stats));
+    for (int i = 0; i < count; i++) {
+        s_dest_stats[i].addr = s_dest_addr[i].sin_addr.s_addr;
+        s_dest_stats[i].port = config->sender_destination_port;
+    }
+    s_dest_count = count;
+    s_dest_multicast = multicast;
+    xSemaphoreGive(s_dest_lock);
+
+    if (multicast) {
+        ESP_LOGI(TAG, "Sending to multicast group %s:%u",
+                 config->sender_destination_ip, config->sender_destination_port);
+    } else {
+        ESP_LOGI(TAG, "Sending to %d destination(s) on port %u", count, config->sender_destination_port);
+    }
+}
+
+// Packetise one chunk from the ring and send it, never retries or blocks
+static void send_chunk(void)
+{
+    int16_t *samples = (int16_t *)(s_data_out + HEADER_SIZE);
+    ring_pop((uint8_t *)samples, CHUNK_SIZE);
+
+    gain_process_s16(&s_gain, samples, s_frames_per_chunk, s_format.channels);
+
+    // The same buffer goes to every destination, only the address changes
+    int64_t start = esp_timer_get_time();
+    int delivered = 0;
+    xSemaphoreTake(s_dest_lock, portMAX_DELAY);
+    for (int i = 0; i < s_dest_count; i++) {
+        int sent = sendto(s_sock, s_data_out, PACKET_SIZE, MSG_DONTWAIT,
+                          (struct sockaddr *)&s_dest_addr[i], sizeof(s_dest_addr[i]));
+        if (sent != PACKET_SIZE) {
+            s_dest_stats[i].send_failures++;
+            ESP_LOGD(TAG, "Failed to send UDP packet to destination %d: sent %d, errno %d", i, sent, errno);
+            continue;
         }
-        
-        // Move remaining data to the beginning of the buffer
-        s_data_in_head -= CHUNK_SIZE;
-        if (s_data_in_head > 0) {
-            memmove(s_data_in, s_data_in + CHUNK_SIZE, s_data_in_head);
+        s_dest_stats[i].packets_sent++;
+        delivered++;
+    }
+    s_stats.destination_count = s_dest_count;
+    xSemaphoreGive(s_dest_lock);
+
+    int64_t now = esp_timer_get_time();
+    uint32_t cost = (uint32_t)(now - start);
+    if (cost > s_stats.max_send_cost_us) {
+        s_stats.max_send_cost_us = cost;
+    }
+    // Exponential moving average with a 1/16 weight
+    s_stats.avg_send_cost_us += ((int32_t)cost - (int32_t)s_stats.avg_send_cost_us) / 16;
+
+    if (delivered == 0) {
+        s_stats.send_failures++;
+        return;
+    }
+
+    if (s_last_send_us != 0) {
+        int64_t interval = now - s_last_send_us;
+        uint32_t jitter = (uint32_t)llabs(interval - (int64_t)s_tx_interval_us);
+        if (jitter > s_stats.max_send_jitter_us) {
+            s_stats.max_send_jitter_us = jitter;
         }
+        // Exponential moving average with a 1/16 weight
+        s_stats.avg_send_jitter_us += ((int32_t)jitter - (int32_t)s_stats.avg_send_jitter_us) / 16;
     }
-    
+    s_last_send_us = now;
+    s_stats.packets_sent++;
+}
+
+static void tx_timer_cb(void *arg)
+{
+    xTaskNotifyGive(s_tx_task_handle);
+}
+
+// Sends one chunk per timer tick, plus one extra when the ring is backing up
+static void scream_sender_tx_task(void *arg)
+{
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (!s_is_sender_running) {
+            continue;
+        }
+
+        gain_set_target(&s_gain, config_manager_get_config()->volume);
+        size_t used = ring_used();
+        if (used < CHUNK_SIZE) {
+            s_stats.underruns++;
+            s_last_send_us = 0;
+            continue;
+        }
+        send_chunk();
+        if (used >= CHUNK_SIZE * TX_CATCHUP_CHUNKS) {
+            send_chunk();
+        }
+    }
+}
+
+// UAC callbacks
+static esp_err_t uac_device_output_cb(uint8_t *buf, size_t len, void *arg)
+{
+    if (s_is_muted || !s_is_sender_running)
+        return ESP_OK;
+
+    int64_t start = esp_timer_get_time();
+
+    if (!ring_push(buf, len)) {
+        s_stats.ring_drops++;
+    }
+
+    uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+    if (elapsed > s_stats.max_callback_us) {
+        s_stats.max_callback_us = elapsed;
+    }
+    s_stats.callback_count++;
     return ESP_OK;
 }
 
@@ -106,36 +313,41 @@ static void uac_device_set_mute_cb(uint32_t mute, void *arg)
     s_is_muted = !!mute;
 }
 
+// Windows UAC volume (0-100, not linear) to a linear 0-100 scale
+static const uint8_t s_uac_volume_map[101] = {
+      0,   0,   0,   1,   1,   1,   1,   1,   1,   2,
+      2,   2,   2,   2,   2,   3,   3,   3,   3,   3,
+      3,   4,   4,   4,   5,   5,   5,   6,   6,   7,
+      7,   8,   8,   9,   9,  10,  10,  11,  11,  12,
+     12,  13,  13,  14,  14,  15,  15,  16,  16,  17,
+     17,  18,  18,  19,  19,  20,  20,  21,  23,  24,
+     25,  26,  28,  29,  30,  31,  33,  34,  35,  36,
+     38,  39,  40,  41,  43,  44,  45,  46,  48,  49,
+     50,  52,  54,  56,  59,  61,  63,  65,  67,  69,
+     71,  73,  76,  78,  80,  83,  87,  90,  93,  97,
+    100,
+};
+
 static void uac_device_set_volume_cb(uint32_t volume, void *arg)
 {
-    ESP_LOGI(TAG, "UAC volume change: %"PRIu32"", volume);
+    int64_t start = esp_timer_get_time();
     
-    // Convert Windows UAC volume scale (which is not linear) to a 0-100 scale
-    if (volume <= 18) {
-        s_volume = round(volume / 6.0);
-    } else if (volume <= 26) {
-        s_volume = 4 + round((volume - 22) / 4.0);
-    } else if (volume <= 56) {
-        s_volume = 5 + round((volume - 26) / 2.0);
-    } else if (volume <= 80) {
-        s_volume = 20 + round((volume - 56) / 0.8);
-    } else if (volume <= 94) {
-        s_volume = 50 + round((volume - 80) / 0.47);
-    } else if (volume <= 100) {
-        s_volume = 80 + round((volume - 94) / 0.3);
+    if (volume > 100) {
+        volume = 100;
     }
+    s_volume = s_uac_volume_map[volume];
     
-    ESP_LOGI(TAG, "Mapped volume: %"PRIu32"", s_volume);
-    
-    // Update config manager's volume (convert from 0-100 to 0.0-1.0 scale)
+    // Update config manager's volume (convert from 0-100 to 0.0-1.0 scale).
+    // The NVS write is deferred so dragging the slider doesn't stall the callback.
     float config_volume = (float)s_volume / 100.0f;
-    app_config_t *config = config_manager_get_config();
-    config->volume = config_volume;
+    config_manager_save_setting_deferred("volume", &config_volume, sizeof(float));
     
-    // Save the new volume setting to NVS
-    config_manager_save_setting("volume", &config_volume, sizeof(float));
-    
-    ESP_LOGI(TAG, "Config volume updated to %.2f", config_volume);
+    uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+    if (elapsed > s_stats.max_volume_cb_us) {
+        s_stats.max_volume_cb_us = elapsed;
+    }
+    s_stats.volume_events++;
+    ESP_LOGD(TAG, "UAC volume change: %" PRIu32 " -> %" PRIu32 " (%" PRIu32 " us)", volume, s_volume, elapsed);
 }
 
 esp_err_t scream_sender_init(void)
@@ -180,15 +392,72 @@ esp_err_t scream_sender_init(void)
     }
     #endif
     
-    // Initialize the destination address from settings
-    app_config_t *config = config_manager_get_config();
-    memset(&s_dest_addr, 0, sizeof(s_dest_addr));
-    s_dest_addr.sin_family = AF_INET;
-    s_dest_addr.sin_addr.s_addr = inet_addr(config->sender_destination_ip);
-    s_dest_addr.sin_port = htons(config->sender_destination_port);
+    // Keep multicast on the local network and don't loop it back to ourselves
+    uint8_t ttl = MULTICAST_TTL;
+    if (setsockopt(s_sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0) {
+        ESP_LOGW(TAG, "Failed to set IP_MULTICAST_TTL: errno %d", errno);
+    }
+    uint8_t loop = 0;
+    if (setsockopt(s_sock, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0) {
+        ESP_LOGW(TAG, "Failed to set IP_MULTICAST_LOOP: errno %d", errno);
+    }
+    
+    // Initialize the destination addresses from settings
+    s_dest_lock = xSemaphoreCreateMutex();
+    if (s_dest_lock == NULL) {
+        ESP_LOGE(TAG, "Failed to create destination lock");
+        close(s_sock);
+        s_sock = -1;
+        return ESP_ERR_NO_MEM;
+    }
+    load_destinations();
     
-    // Initialize the Scream header in output buffer
-    memcpy(s_data_out, header, HEADER_SIZE);
+    // Initialize the Scream header in output buffer from the USB input format
+    s_format.sample_rate = USB_SAMPLE_RATE;
+    s_format.bit_depth = USB_BIT_DEPTH;
+    s_format.channels = USB_CHANNELS;
+    esp_err_t ret = scream_sender_encode_header(&s_format, s_data_out);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Unsupported USB format %" PRIu32 " Hz, %d-bit, %d channels",
+                 s_format.sample_rate, s_format.bit_depth, s_format.channels);
+        close(s_sock);
+        s_sock = -1;
+        vSemaphoreDelete(s_dest_lock);
+        s_dest_lock = NULL;
+        return ret;
+    }
+    uint32_t bytes_per_frame = (s_format.bit_depth / 8) * s_format.channels;
+    s_frames_per_chunk = CHUNK_SIZE / bytes_per_frame;
+    s_tx_interval_us = (uint32_t)((uint64_t)CHUNK_SIZE * 1000000 / (s_format.sample_rate * bytes_per_frame));
+    ESP_LOGI(TAG, "Sending %" PRIu32 " Hz, %d-bit, %d channels, one packet every %" PRIu32 " us",
+             s_format.sample_rate, s_format.bit_depth, s_format.channels, s_tx_interval_us);
+    
+    // Create the paced TX task and its timer
+    if (xTaskCreatePinnedToCore(scream_sender_tx_task, "scream_tx", TX_TASK_STACK_SIZE, NULL,
+                                TX_TASK_PRIORITY, &s_tx_task_handle, 1) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create TX task");
+        close(s_sock);
+        s_sock = -1;
+        vSemaphoreDelete(s_dest_lock);
+        s_dest_lock = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = tx_timer_cb,
+        .name = "scream_tx",
+    };
+    ret = esp_timer_create(&timer_args, &s_tx_timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create TX timer: %s", esp_err_to_name(ret));
+        vTaskDelete(s_tx_task_handle);
+        s_tx_task_handle = NULL;
+        close(s_sock);
+        s_sock = -1;
+        vSemaphoreDelete(s_dest_lock);
+        s_dest_lock = NULL;
+        return ret;
+    }
     
     // Initialize the UAC device
     uac_device_config_t uac_config = {
@@ -198,11 +467,17 @@ esp_err_t scream_sender_init(void)
         .cb_ctx = NULL,
     };
     
-    esp_err_t ret = uac_device_init(&uac_config);
+    ret = uac_device_init(&uac_config);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to initialize UAC device: %s", esp_err_to_name(ret));
+        esp_timer_delete(s_tx_timer);
+        s_tx_timer = NULL;
+        vTaskDelete(s_tx_task_handle);
+        s_tx_task_handle = NULL;
         close(s_sock);
         s_sock = -1;
+        vSemaphoreDelete(s_dest_lock);
+        s_dest_lock = NULL;
         return ret;
     }
     
@@ -224,10 +499,22 @@ esp_err_t scream_sender_start(void)
     
     ESP_LOGI(TAG, "Starting Scream sender");
     
-    // Reset the data buffer
-    s_data_in_head = 0;
+    // Reset the ring, the gain and the stats
+    ring_reset();
+    gain_init(&s_gain, config_manager_get_config()->volume, GAIN_RAMP_LINEAR);
+    memset(&s_stats, 0, sizeof(s_stats));
+    xSemaphoreTake(s_dest_lock, portMAX_DELAY);
+    memset(s_dest_stats, 0, sizeof(s_dest_stats));
+    xSemaphoreGive(s_dest_lock);
+    s_last_send_us = 0;
     
     s_is_sender_running = true;
+    esp_err_t ret = esp_timer_start_periodic(s_tx_timer, s_tx_interval_us);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start TX timer: %s", esp_err_to_name(ret));
+        s_is_sender_running = false;
+        return ret;
+    }
     return ESP_OK;
 }
 
@@ -246,6 +533,9 @@ esp_err_t scream_sender_stop(void)
     ESP_LOGI(TAG, "Stopping Scream sender");
     
     s_is_sender_running = false;
+    esp_timer_stop(s_tx_timer);
+    ESP_LOGI(TAG, "Sent %" PRIu32 " packets, %" PRIu32 " ring drops, %" PRIu32 " send failures, %" PRIu32 " underruns",
+             s_stats.packets_sent, s_stats.ring_drops, s_stats.send_failures, s_stats.underruns);
     return ESP_OK;
 }
 
@@ -270,6 +560,74 @@ void scream_sender_set_volume(uint32_t volume)
     ESP_LOGI(TAG, "Scream sender volume set to %"PRIu32"", volume);
 }
 
+// WAVEFORMATEXTENSIBLE speaker masks for common channel counts
+static uint16_t channel_mask_for(uint8_t channels)
+{
+    switch (channels) {
+    case 1: return 0x0004;  // FC
+    case 2: return 0x0003;  // FL FR
+    case 4: return 0x0033;  // FL FR BL BR
+    case 6: return 0x003F;  // 5.1
+    case 8: return 0x063F;  // 7.1
+    default: return 0;
+    }
+}
+
+esp_err_t scream_sender_encode_header(const scream_sender_format_t *format, uint8_t *header)
+{
+    // Byte 0: bit 7 selects the 44.1KHz base rate, bits 0-6 are the multiplier
+    uint8_t rate_byte;
+    if (format->sample_rate % 48000 == 0) {
+        rate_byte = format->sample_rate / 48000;
+    } else if (format->sample_rate % 44100 == 0) {
+        rate_byte = 0x80 | (format->sample_rate / 44100);
+    } else {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if ((rate_byte & 0x7F) == 0 || (rate_byte & 0x7F) > 4) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (format->bit_depth != 16 && format->bit_depth != 24 && format->bit_depth != 32) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (format->channels == 0 || format->channels > 8) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    uint16_t mask = channel_mask_for(format->channels);
+    header[0] = rate_byte;
+    header[1] = format->bit_depth;
+    header[2] = format->channels;
+    header[3] = mask & 0xFF;
+    header[4] = mask >> 8;
+    return ESP_OK;
+}
+
+void scream_sender_get_format(scream_sender_format_t *format)
+{
+    *format = s_format;
+}
+
+void scream_sender_get_stats(scream_sender_stats_t *stats)
+{
+    *stats = s_stats;
+    stats->ring_fill_bytes = ring_used();
+    stats->multicast = s_dest_multicast;
+}
+
+int scream_sender_get_destinations(scream_sender_dest_stats_t *dests, int max_dests)
+{
+    if (s_dest_lock == NULL) {
+        return 0;
+    }
+    
+    xSemaphoreTake(s_dest_lock, portMAX_DELAY);
+    int count = s_dest_count < max_dests ? s_dest_count : max_dests;
+    memcpy(dests, s_dest_stats, count * sizeof(dests[0]));
+    xSemaphoreGive(s_dest_lock);
+    return count;
+}
+
 esp_err_t scream_sender_update_destination(void)
 {
     if (!s_is_sender_initialized) {
@@ -277,15 +635,8 @@ esp_err_t scream_sender_update_destination(void)
         return ESP_ERR_INVALID_STATE;
     }
     
-    // Update the destination address from settings
-    app_config_t *config = config_manager_get_config();
-    memset(&s_dest_addr, 0, sizeof(s_dest_addr));
-    s_dest_addr.sin_family = AF_INET;
-    s_dest_addr.sin_addr.s_addr = inet_addr(config->sender_destination_ip);
-    s_dest_addr.sin_port = htons(config->sender_destination_port);
-    
-    ESP_LOGI(TAG, "Updated Scream sender destination to %s:%u", 
-             config->sender_destination_ip, config->sender_destination_port);
+    // Update the destination addresses from settings
+    load_destinations();
     
     return ESP_OK;
 }
@@ -4,6 +4,49 @@
 #include <stdint.h>
 #include "esp_err.h"
 
+/**
+ * PCM format of a Scream stream
+ */
+typedef struct {
+    uint32_t sample_rate;           // 44100, 48000, 88200, 96000, ...
+    uint8_t bit_depth;              // 16, 24 or 32
+    uint8_t channels;               // 1-8
+} scream_sender_format_t;
+
+// Receivers a single sender can fan out to, including the primary destination
+#define SCREAM_SENDER_MAX_DESTINATIONS 8
+
+/**
+ * Per-destination counters for the USB Scream sender
+ */
+typedef struct {
+    uint32_t addr;                  // IPv4 address, network byte order
+    uint16_t port;                  // UDP port
+    uint32_t packets_sent;          // Packets accepted by the network stack
+    uint32_t send_failures;         // sendto() failures for this destination
+} scream_sender_dest_stats_t;
+
+/**
+ * Runtime counters for the USB Scream sender
+ */
+typedef struct {
+    uint32_t packets_sent;          // Packets handed to the network stack
+    uint32_t send_failures;         // Packets no destination accepted, the packet is dropped
+    uint32_t ring_drops;            // USB callbacks whose data didn't fit in the ring
+    uint32_t underruns;             // TX ticks with less than one chunk queued
+    uint32_t callback_count;        // USB output callbacks seen
+    uint32_t max_callback_us;       // Longest USB output callback
+    uint32_t max_send_jitter_us;    // Worst deviation from the 6ms send interval
+    uint32_t avg_send_jitter_us;    // Moving average deviation from the send interval
+    uint32_t ring_fill_bytes;       // Bytes currently queued for sending
+    uint32_t volume_events;         // UAC volume change callbacks
+    uint32_t max_volume_cb_us;      // Longest UAC volume change callback
+    uint32_t destination_count;     // Destinations each packet is sent to
+    bool multicast;                 // Sending to a multicast group rather than a list
+    uint32_t max_send_cost_us;      // Longest time spent sending one packet to all destinations
+    uint32_t avg_send_cost_us;      // Moving average time spent sending one packet to all destinations
+} scream_sender_stats_t;
+
 /**
  * Initialize the USB Scream sender functionality
  * This sets up the necessary components but doesn't start sending
@@ -50,8 +93,42 @@ void scream_sender_set_mute(bool mute);
 void scream_sender_set_volume(uint32_t volume);
 
 /**
- * Update the destination IP and port for the USB Scream sender
- * This can be called while the sender is running to change the destination
+ * Encode the 5 byte Scream header for a format
+ *
+ * @param format Stream format
+ * @param header Receives the 5 header bytes
+ * @return ESP_OK, or ESP_ERR_NOT_SUPPORTED if Scream can't describe the format
+ */
+esp_err_t scream_sender_encode_header(const scream_sender_format_t *format, uint8_t *header);
+
+/**
+ * Get the format the USB Scream sender is transmitting
+ *
+ * @param format Filled with the current format
+ */
+void scream_sender_get_format(scream_sender_format_t *format);
+
+/**
+ * Get a snapshot of the USB Scream sender counters
+ *
+ * @param stats Filled with the current counters
+ */
+void scream_sender_get_stats(scream_sender_stats_t *stats);
+
+/**
+ * Get the per-destination counters of the USB Scream sender
+ *
+ * @param dests Array receiving one entry per destination
+ * @param max_dests Number of entries dests can hold
+ * @return Number of entries filled in
+ */
+int scream_sender_get_destinations(scream_sender_dest_stats_t *dests, int max_dests);
+
+/**
+ * Update the destination IPs and port for the USB Scream sender
+ * This can be called while the sender is running to change the destinations.
+ * A multicast destination IP is used on its own, otherwise the extra
+ * destinations from the config receive the same packets.
  *
  * @return ESP_OK on success, or an error code on failure
  */
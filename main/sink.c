@@ -0,0 +1,256 @@
+#include "sink.h"
+#include "global.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    const sink_ops_t *ops;
+    sink_drop_policy_t policy;
+    int lane;
+    TaskHandle_t task;
+    // Guards the indices below, chunks are only ever copied outside it
+    portMUX_TYPE lock;
+    // Chunk buffers. A slot belongs to the ring, to dispatch while it copies
+    // a chunk in, to the sink task while it writes one out, or is free.
+    uint8_t *slots;
+    uint32_t free_slots;
+    // Ring of queued slots, oldest first, and their packet arrival times
+    uint8_t order[SINK_QUEUE_CHUNKS];
+    int64_t arrival_us[SINK_QUEUE_CHUNKS];
+    unsigned int head;
+    unsigned int count;
+    // Set by sink_flush(), tells the task to drop the chunk it is holding
+    volatile bool flushed;
+    sink_stats_t stats;
+} sink_t;
+
+// The queue, one slot the task is writing and one dispatch is filling
+#define SINK_SLOTS (SINK_QUEUE_CHUNKS + 2)
+
+static sink_t *s_sinks[SINK_MAX];
+// Only grows, and only after the new slot is filled, so dispatch can run meanwhile
+static volatile int s_sink_count = 0;
+static sink_t *s_primary = NULL;
+static void (*s_room_callback)(void) = NULL;
+
+static void record_latency(sink_t *s, int64_t arrival_us) {
+    uint32_t latency = (uint32_t)(esp_timer_get_time() - arrival_us);
+    s->stats.latency_last_us = latency;
+    if (latency > s->stats.latency_max_us) {
+        s->stats.latency_max_us = latency;
+    }
+    // Exponential moving average with a 1/16 weight
+    s->stats.latency_avg_us += ((int32_t)latency - (int32_t)s->stats.latency_avg_us) / 16;
+}
+
+static inline uint8_t *slot_data(sink_t *s, int slot) {
+    return s->slots + slot * PCM_CHUNK_SIZE;
+}
+
+// Call with the lock held, -1 when every slot is taken
+static int slot_claim(sink_t *s) {
+    if (s->free_slots == 0) {
+        return -1;
+    }
+    int slot = __builtin_ctz(s->free_slots);
+    s->free_slots &= ~(1u << slot);
+    return slot;
+}
+
+static void slot_release(sink_t *s, int slot) {
+    taskENTER_CRITICAL(&s->lock);
+    s->free_slots |= 1u << slot;
+    taskEXIT_CRITICAL(&s->lock);
+}
+
+// Take the oldest queued chunk, the slot stays the task's until released
+static int sink_pop(sink_t *s, int64_t *arrival_us) {
+    taskENTER_CRITICAL(&s->lock);
+    if (s->count == 0) {
+        taskEXIT_CRITICAL(&s->lock);
+        return -1;
+    }
+    int slot = s->order[s->head];
+    *arrival_us = s->arrival_us[s->head];
+    s->head = (s->head + 1) % SINK_QUEUE_CHUNKS;
+    s->count--;
+    s->flushed = false;
+    taskEXIT_CRITICAL(&s->lock);
+    return slot;
+}
+
+static void sink_task(void *arg) {
+    sink_t *s = (sink_t *)arg;
+    const uint8_t *out = NULL;
+    size_t len = 0;
+    int slot = -1;
+    int64_t arrival_us = 0;
+
+    while (true) {
+        if (out != NULL && s->flushed) {
+            slot_release(s, slot);
+            out = NULL;
+        }
+        if (out == NULL) {
+            slot = sink_pop(s, &arrival_us);
+            if (slot < 0) {
+                ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+                continue;
+            }
+            if (s == s_primary && s_room_callback != NULL) {
+                s_room_callback();
+            }
+            len = PCM_CHUNK_SIZE;
+            out = s->ops->prepare ? s->ops->prepare(s->ops->ctx, slot_data(s, slot), &len) : slot_data(s, slot);
+        }
+
+        esp_err_t err = s->ops->write(s->ops->ctx, out, len, pdMS_TO_TICKS(SINK_WRITE_WAIT_MS));
+        if (err == ESP_OK) {
+            s->stats.written++;
+            record_latency(s, arrival_us);
+            slot_release(s, slot);
+            out = NULL;
+        } else {
+            s->stats.stalls++;
+            if (err == ESP_ERR_INVALID_STATE) {
+                // Device gone, hold the chunk until sink_wake() or a flush
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SINK_WRITE_WAIT_MS));
+            }
+        }
+    }
+}
+
+void sink_set_room_callback(void (*callback)(void)) {
+    s_room_callback = callback;
+}
+
+esp_err_t sink_register(const sink_ops_t *ops, sink_drop_policy_t policy, bool primary) {
+    if (s_sink_count >= SINK_MAX) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    sink_t *s = heap_caps_calloc(1, sizeof(sink_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (s == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    s->slots = heap_caps_malloc(SINK_SLOTS * PCM_CHUNK_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (s->slots == NULL) {
+        free(s);
+        return ESP_ERR_NO_MEM;
+    }
+    s->ops = ops;
+    s->policy = policy;
+    s->lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+    s->free_slots = (1u << SINK_SLOTS) - 1;
+    s->stats.name = ops->name;
+
+    char task_name[configMAX_TASK_NAME_LEN];
+    snprintf(task_name, sizeof(task_name), "sink_%s", ops->name);
+    if (xTaskCreatePinnedToCore(sink_task, task_name, 4096, s, 2, &s->task, 1) != pdPASS) {
+        free(s->slots);
+        free(s);
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_sinks[s_sink_count] = s;
+    s_sink_count = s_sink_count + 1;
+    if (primary || s_primary == NULL) {
+        if (s_primary != NULL) {
+            s_primary->stats.primary = false;
+        }
+        s_primary = s;
+        s->stats.primary = true;
+    }
+    ESP_LOGI(TAG, "Registered %s output%s", ops->name, s->stats.primary ? " (primary)" : "");
+    return ESP_OK;
+}
+
+void sink_set_lane(const char *name, int lane) {
+    for (int i = 0; i < s_sink_count; i++) {
+        if (strcmp(s_sinks[i]->ops->name, name) == 0) {
+            s_sinks[i]->lane = lane;
+        }
+    }
+}
+
+void sink_dispatch(const uint8_t *chunks, int lanes, int64_t arrival_us) {
+    for (int i = 0; i < s_sink_count; i++) {
+        sink_t *s = s_sinks[i];
+        const uint8_t *chunk = chunks + (s->lane < lanes ? s->lane : 0) * PCM_CHUNK_SIZE;
+
+        // Claim a free slot and fill it without the lock, nothing else touches it
+        taskENTER_CRITICAL(&s->lock);
+        int slot = -1;
+        if (s->count < SINK_QUEUE_CHUNKS || s->policy == SINK_DROP_OLDEST) {
+            slot = slot_claim(s);
+        }
+        if (slot < 0) {
+            s->stats.dropped++;
+            taskEXIT_CRITICAL(&s->lock);
+            continue;
+        }
+        taskEXIT_CRITICAL(&s->lock);
+        memcpy(slot_data(s, slot), chunk, PCM_CHUNK_SIZE);
+
+        // Then publish it, the task may have drained the queue meanwhile
+        taskENTER_CRITICAL(&s->lock);
+        if (s->count == SINK_QUEUE_CHUNKS) {
+            s->stats.dropped++;
+            if (s->policy == SINK_DROP_NEWEST) {
+                s->free_slots |= 1u << slot;
+                taskEXIT_CRITICAL(&s->lock);
+                continue;
+            }
+            s->free_slots |= 1u << s->order[s->head];
+            s->head = (s->head + 1) % SINK_QUEUE_CHUNKS;
+            s->count--;
+        }
+        unsigned int pos = (s->head + s->count) % SINK_QUEUE_CHUNKS;
+        s->order[pos] = (uint8_t)slot;
+        s->arrival_us[pos] = arrival_us;
+        s->count++;
+        s->stats.queued++;
+        taskEXIT_CRITICAL(&s->lock);
+        xTaskNotifyGive(s->task);
+    }
+}
+
+bool sink_primary_has_room(void) {
+    return s_primary == NULL || s_primary->count < SINK_QUEUE_CHUNKS;
+}
+
+void sink_flush(void) {
+    for (int i = 0; i < s_sink_count; i++) {
+        sink_t *s = s_sinks[i];
+        taskENTER_CRITICAL(&s->lock);
+        for (unsigned int n = 0; n < s->count; n++) {
+            s->free_slots |= 1u << s->order[(s->head + n) % SINK_QUEUE_CHUNKS];
+        }
+        s->count = 0;
+        s->flushed = true;
+        taskEXIT_CRITICAL(&s->lock);
+    }
+}
+
+void sink_wake(const char *name) {
+    for (int i = 0; i < s_sink_count; i++) {
+        if (strcmp(s_sinks[i]->ops->name, name) == 0) {
+            xTaskNotifyGive(s_sinks[i]->task);
+        }
+    }
+}
+
+int sink_get_stats(sink_stats_t *stats, int max) {
+    int n = 0;
+    for (int i = 0; i < s_sink_count && n < max; i++) {
+        stats[n] = s_sinks[i]->stats;
+        stats[n].queue_depth = s_sinks[i]->count;
+        n++;
+    }
+    return n;
+}
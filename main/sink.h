@@ -0,0 +1,103 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+// Most outputs that can run at once: three USB DACs, S/PDIF and I2S DAC
+#define SINK_MAX 5
+// Chunks each sink can queue, bounds how far a sink may lag the primary one
+#define SINK_QUEUE_CHUNKS 4
+// Longest a sink task waits inside one write before checking its queue again
+#define SINK_WRITE_WAIT_MS 20
+// Stereo mixes dispatched together: the receiver's own and one per USB DAC zone
+// bound to its own channel pair
+#define SINK_MAX_LANES 4
+
+typedef enum {
+    SINK_DROP_OLDEST,   // Discard the oldest queued chunk, keeps the sink's latency bounded
+    SINK_DROP_NEWEST,   // Discard the incoming chunk, keeps what is queued contiguous
+} sink_drop_policy_t;
+
+/**
+ * An audio output. Every enabled sink gets each chunk once it has been through
+ * the gain stage, and writes it from its own task so a slow or stalled sink
+ * only ever drops its own audio.
+ */
+typedef struct {
+    const char *name;
+    void *ctx;                      // Passed to the callbacks
+    // Convert a 16-bit stereo chunk to the sink's format, optional. Called once
+    // per chunk from the sink task, returns the data to write and its length.
+    const uint8_t *(*prepare)(void *ctx, const uint8_t *chunk, size_t *len);
+    // Write prepared data, waiting at most timeout for room. Returns ESP_ERR_TIMEOUT
+    // if it stayed full, or ESP_ERR_INVALID_STATE if the device is gone.
+    esp_err_t (*write)(void *ctx, const uint8_t *data, size_t len, TickType_t timeout);
+} sink_ops_t;
+
+// Per sink counters
+typedef struct {
+    const char *name;
+    bool primary;                // Paces how fast chunks leave the jitter buffer
+    uint32_t queued;             // Chunks handed to the sink
+    uint32_t written;            // Chunks the sink accepted
+    uint32_t dropped;            // Chunks discarded because the sink's queue was full
+    uint32_t stalls;             // Writes that timed out or found the device gone
+    uint32_t queue_depth;        // Chunks waiting right now
+    uint32_t latency_last_us;    // Packet arrival to sink submission, last chunk
+    uint32_t latency_avg_us;     // Packet arrival to sink submission, moving average
+    uint32_t latency_max_us;     // Packet arrival to sink submission, worst case
+} sink_stats_t;
+
+/**
+ * Set the callback run whenever the primary sink frees a queue slot
+ */
+void sink_set_room_callback(void (*callback)(void));
+
+/**
+ * Add an output and start its writer task, may be called while audio is dispatched
+ *
+ * @param ops Sink callbacks, must stay valid for the life of the program
+ * @param policy What to discard when the sink falls behind
+ * @param primary Pace the stream on this sink, the first sink registered is primary if none asks
+ * @return ESP_OK, ESP_ERR_NO_MEM, or ESP_ERR_INVALID_STATE when SINK_MAX sinks are registered
+ */
+esp_err_t sink_register(const sink_ops_t *ops, sink_drop_policy_t policy, bool primary);
+
+/**
+ * Choose the mix a sink plays, lane 0 until set
+ */
+void sink_set_lane(const char *name, int lane);
+
+/**
+ * Queue a chunk on every sink, never blocks
+ *
+ * @param chunks One PCM_CHUNK_SIZE block of 16-bit stereo per lane, back to back, copied
+ * @param lanes Number of lanes in chunks, sinks set to a missing lane play lane 0
+ * @param arrival_us When the chunk's packet was received
+ */
+void sink_dispatch(const uint8_t *chunks, int lanes, int64_t arrival_us);
+
+/**
+ * Whether the primary sink can queue another chunk, true when no sink is registered
+ */
+bool sink_primary_has_room(void);
+
+/**
+ * Discard every queued chunk, for when playback stops
+ */
+void sink_flush(void);
+
+/**
+ * Wake the writer task of a sink, called when its device has room or came back
+ */
+void sink_wake(const char *name);
+
+/**
+ * Copy the counters of every sink
+ *
+ * @return Number of sinks written to stats
+ */
+int sink_get_stats(sink_stats_t *stats, int max);
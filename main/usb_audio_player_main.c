@@ -15,11 +15,15 @@
 #include "driver/gpio.h"
 #include "esp_sleep.h"
 #include "global.h"
-#include "esp_pm.h" // For power management
+#include "power.h"
+#include "boot_profile.h"
+#include "deep_sleep.h"
+#include "esp_netif.h"
 #include "driver/i2c.h" // For I2C communication with USB-C power chip
 #ifdef IS_USB
 #include "usb/usb_host.h"
 #include "usb/uac_host.h"
+#include "usb_dac.h"
 #endif
 // Include our new modules
 #include "config_manager.h"
@@ -29,6 +33,7 @@
 #include "ntp_client.h"
 #ifdef IS_USB
 #include "scream_sender.h"
+#include "lwip/inet.h"
 #endif
 #include "bq25895_integration.h" // Include BQ25895 integration header
 
@@ -39,8 +44,11 @@
 #define DEFAULT_VOLUME          45
 #define RTC_CNTL_OPTION1_REG 0x6000812C
 #define RTC_CNTL_FORCE_DOWNLOAD_BOOT 1
-// Using DAC_CHECK_SLEEP_TIME_MS from config.h (2000ms)
+// Deep sleep checks for a DAC are timed by DAC_CHECK_SLEEP_TIME_MS and the back-off in config.h
 #define NETWORK_SLEEP_TIME_MS 10       // Light sleep between network operations
+// Holding either reset button this long wipes the WiFi configuration and settings
+#define RESET_HOLD_MS               3000
+#define RESET_POLL_MS               50
 
 // I2C configuration for USB-C PMID power management
 #define I2C_MASTER_SCL_IO           9       // GPIO for I2C SCL
@@ -146,25 +154,21 @@ void enter_deep_sleep_mode() {
     ESP_LOGI(TAG, "Entering deep sleep mode");
     device_sleeping = true;
     
+    // Persist any settings still waiting in the write-behind cache
+    config_manager_flush();
+    
     // Stop network activity and disconnect WiFi to save power
     esp_wifi_disconnect();
     esp_wifi_stop();
     
-    // Configure ESP32 to wake up every few seconds to check for DAC
-    esp_sleep_enable_timer_wakeup(DAC_CHECK_SLEEP_TIME_MS * 1000); // Convert to microseconds
-    
-    // Actually enter deep sleep (this function doesn't return)
+    // Wake when a DAC is plugged in, the wake stub checks for one on a backed off
+    // timer and only boots the app to look itself every few checks
     ESP_LOGI(TAG, "Going to deep sleep now");
-    esp_deep_sleep_start();
+    deep_sleep_start();
     
     // This code is never reached
 }
 
-// Forward declarations from audio.c for the silence tracking variables
-extern bool is_silent;
-extern uint32_t silence_duration_ms;
-extern TickType_t last_audio_time;
-
 // Function to exit sleep mode when DAC is connected - called after waking from deep sleep
 void exit_sleep_mode() {
     ESP_LOGI(TAG, "Exiting sleep mode after deep sleep wake");
@@ -177,10 +181,8 @@ void exit_sleep_mode() {
         esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_TIMER);
     }
     
-    // Reset audio silence tracking variables to prevent going back to sleep immediately
-    is_silent = false;
-    silence_duration_ms = 0;
-    last_audio_time = xTaskGetTickCount();
+    // Restart silence tracking to prevent going back to sleep immediately
+    audio_reset_silence();
     
     // Restart WiFi - we disconnected before sleeping
     wifi_init_sta();
@@ -191,16 +193,25 @@ static void uac_device_callback(uac_host_device_handle_t uac_device_handle, cons
     // Check for disconnect event - doesn't matter if we use UAC_HOST_DEVICE_EVENT_DISCONNECTED 
     // or UAC_HOST_DRIVER_EVENT_DISCONNECTED since they should be the same value
     if (event == UAC_HOST_DRIVER_EVENT_DISCONNECTED) {
-        // stop audio player first
-        s_spk_dev_handle = NULL;
-        //audio_player_stop();
-		stop_playback();
+        // Invalidate the handles before closing so nothing writes to a closed device.
+        // The main loop enters deep sleep if the primary DAC doesn't return within DAC_REPLUG_GRACE_MS.
+        if (uac_device_handle == s_spk_dev_handle) {
+            s_spk_dev_handle = NULL;
+        }
+        audio_dac_detached(uac_device_handle);
+        power_set_dac_attached(false);
         ESP_LOGI(TAG, "UAC Device disconnected");
-        ESP_ERROR_CHECK(uac_host_device_close(uac_device_handle));
-        vTaskDelay(2000); // Give two seconds for reconnect
-        if (!is_playing())
-            // Enter deep sleep mode when DAC disconnects
-            enter_deep_sleep_mode();
+        esp_err_t err = uac_host_device_close(uac_device_handle);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to close disconnected DAC: %s", esp_err_to_name(err));
+        }
+        return;
+    }
+    
+    // The DAC has room again, wake its output task if it is waiting to write. This is
+    // handled here rather than through the event queue to keep the wakeup latency low.
+    if (event == UAC_HOST_DEVICE_EVENT_TX_DONE) {
+        usb_dac_tx_done(uac_device_handle);
         return;
     }
     
@@ -247,6 +258,7 @@ static void usb_lib_task(void *arg)
 
     ESP_ERROR_CHECK(usb_host_install(&host_config));
     ESP_LOGI(TAG, "USB Host installed");
+    boot_profile_mark("usb_host");
     xTaskNotifyGive(arg);
 
     while (usb_host_running) {
@@ -292,21 +304,35 @@ static void uac_lib_task(void *arg)
                 case UAC_HOST_DRIVER_EVENT_TX_CONNECTED: {
                     uac_host_dev_info_t dev_info;
                     uac_host_device_handle_t uac_device_handle = NULL;
+                    // USB host ring buffer size and the fill level TX done fires at
+                    app_config_t *config = config_manager_get_config();
                     const uac_host_device_config_t dev_config = {
                         .addr = addr,
                         .iface_num = iface_num,
-                        .buffer_size = PCM_CHUNK_SIZE * 4,
-                        .buffer_threshold = 0,
+                        .buffer_size = PCM_CHUNK_SIZE * config->usb_buffer_chunks,
+                        .buffer_threshold = PCM_CHUNK_SIZE * config->usb_threshold_chunks,
                         .callback = uac_device_callback,
                         .callback_arg = NULL,
                     };
                     ESP_ERROR_CHECK(uac_host_device_open(&dev_config, &uac_device_handle));
+                    // Until it is closed, see uac_device_callback()
+                    power_set_dac_attached(true);
                     ESP_ERROR_CHECK(uac_host_get_device_info(uac_device_handle, &dev_info));
                     ESP_LOGI(TAG, "UAC Device connected: SPK");
+                    boot_profile_mark("dac");
                     uac_host_printf_device_param(uac_device_handle);
                     //ESP_ERROR_CHECK(uac_host_device_start(uac_device_handle, &stm_config));
-                    s_spk_dev_handle = uac_device_handle;
-                    start_playback(s_spk_dev_handle);
+                    // The first DAC is the primary zone, DACs behind a hub take the next free one
+                    int zone = start_playback(uac_device_handle);
+                    if (zone == 0) {
+                        s_spk_dev_handle = uac_device_handle;
+                    } else if (zone < 0) {
+                        ESP_LOGW(TAG, "No free zone for DAC, closing it");
+                        uac_host_device_close(uac_device_handle);
+                        power_set_dac_attached(false);
+                    } else {
+                        ESP_LOGI(TAG, "DAC playing as zone %d", zone);
+                    }
 					//audio_player_play(s_fp);
                    
                     break;
@@ -328,6 +354,7 @@ static void uac_lib_task(void *arg)
                 case UAC_HOST_DEVICE_EVENT_RX_DONE:
                     break;
                 case UAC_HOST_DEVICE_EVENT_TX_DONE:
+                    // Handled directly in uac_device_callback
                     break;
                 case UAC_HOST_DEVICE_EVENT_TRANSFER_ERROR:
                     break;
@@ -474,9 +501,6 @@ void enter_silence_sleep_mode() {
     }
 #endif
     
-    // Configure WiFi for max power saving
-    ESP_ERROR_CHECK(esp_wifi_set_ps(WIFI_PS_MAX_MODEM));
-
     // Suppress WiFi warnings (including "exceed max band" messages)
     esp_log_level_set("wifi", ESP_LOG_ERROR);
 
@@ -501,54 +525,38 @@ void enter_silence_sleep_mode() {
         vTaskResume(network_monitor_task_handle);
     }
     
-    // Instead of using deep sleep, use light sleep to maintain WiFi connection
+    // Instead of using deep sleep, use light sleep to maintain WiFi connection.
+    // With the audio locks released Wi-Fi goes to max modem sleep and the CPU
+    // drops to the crystal clock. It only light sleeps between beacons once no
+    // DAC is left on the bus, see power_set_dac_attached().
     ESP_LOGI(TAG, "Entering light sleep mode with network monitoring");
-    
-    // Enable automatic light sleep - CPU will sleep between task operations
-    #if CONFIG_PM_ENABLE
-    // Light sleep is handled by the power management module
-    ESP_LOGI(TAG, "Light sleep enabled through power management");
-    #else
-    // No power management, use manual light sleep in the monitoring task
-    ESP_LOGW(TAG, "Power management not enabled, using manual light sleep in monitor task");
-    #endif
+    power_set_audio_active(false);
 }
 
-// External declaration for audio silence tracking variables that need to be reset
-extern bool is_silent;
-extern uint32_t silence_duration_ms;
-extern TickType_t last_audio_time;
-
 // Exit silence sleep mode and reconnect USB device
 void exit_silence_sleep_mode() {
     
     ESP_LOGI(TAG, "Exiting silence sleep mode");
+    power_set_audio_active(true);
     device_sleeping = false;
     
     // Stop the network monitoring
     monitoring_active = false;
     
-    // Set WiFi back to normal power saving mode
-    ESP_ERROR_CHECK(esp_wifi_set_ps(WIFI_PS_MIN_MODEM));
-
     // Suppress WiFi warnings (including "exceed max band" messages)
     esp_log_level_set("wifi", ESP_LOG_ERROR);
     
-    // Reset silence tracking variables to prevent immediate re-entry into sleep mode
-    is_silent = false;
-    silence_duration_ms = 0;
-    last_audio_time = xTaskGetTickCount(); // Reset to current time
+    // Restart silence tracking to prevent immediate re-entry into sleep mode
+    audio_reset_silence();
     
 #ifdef IS_USB
     // Check if we have saved device parameters
     if (saved_usb_device.valid && s_spk_dev_handle != NULL) {
         ESP_LOGI(TAG, "Reconnecting USB DAC device");
         
-        // Restart the device with saved parameters
-        ESP_ERROR_CHECK(uac_host_device_start(s_spk_dev_handle, &saved_usb_device.stream_config));
-        ESP_ERROR_CHECK(uac_host_device_set_volume(s_spk_dev_handle, VOLUME)); // Use the volume variable from audio.c
-        
-        resume_playback();
+        // Restarts the DAC with the format it had, the chunks that woke us
+        // have been buffered meanwhile and play first
+        audio_wake_from_sleep();
     }
 #endif
     
@@ -583,6 +591,99 @@ bool is_gpio_pressed(gpio_num_t pin) {
     return gpio_get_level(pin) == 0; // Returns true if pin is low (pressed)
 }
 
+static TaskHandle_t s_reset_button_task = NULL;
+
+// Level interrupt on a pressed button, disabled until the task has seen it released
+static void reset_button_isr(void *arg)
+{
+    gpio_intr_disable((gpio_num_t)(intptr_t)arg);
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(s_reset_button_task, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+// Wipe the WiFi credentials and all settings, then reboot into AP mode
+static void factory_reset(void)
+{
+    ESP_LOGI(TAG, "Reset button held! Wiping WiFi configuration...");
+    
+    // Clear WiFi credentials from NVS
+    wifi_manager_clear_credentials();
+    
+    // Clear WiFi credentials from ESP's internal WiFi storage, fails harmlessly before WiFi started
+    esp_wifi_restore();
+    
+    // Reset all settings to defaults
+    config_manager_reset();
+    
+    // To be extra safe, erase the entire NVS (all namespaces)
+    nvs_flash_erase();
+    
+    ESP_LOGI(TAG, "All settings reset to defaults. Rebooting...");
+    vTaskDelay(pdMS_TO_TICKS(1000)); // Wait 1 second for logs to be printed
+    esp_restart(); // Restart the ESP32
+}
+
+// Sleeps until GPIO 0 or 1 goes low, the low level also wakes the CPU from
+// light sleep, then polls only for as long as the button stays down
+static void reset_button_task(void *arg)
+{
+    const gpio_num_t pins[] = { GPIO_NUM_0, GPIO_NUM_1 };
+    s_reset_button_task = xTaskGetCurrentTaskHandle();
+    
+    // Configure GPIO pins 0 and 1 as inputs with pull-up resistors
+    gpio_config_t io_conf = {
+        .pin_bit_mask = (1ULL << GPIO_NUM_0) | (1ULL << GPIO_NUM_1),
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_LOW_LEVEL
+    };
+    gpio_config(&io_conf);
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "Reset button not available: %s", esp_err_to_name(err));
+        vTaskDelete(NULL);
+        return;
+    }
+    for (size_t i = 0; i < sizeof(pins) / sizeof(pins[0]); i++) {
+        gpio_isr_handler_add(pins[i], reset_button_isr, (void *)(intptr_t)pins[i]);
+        gpio_wakeup_enable(pins[i], GPIO_INTR_LOW_LEVEL);
+    }
+    esp_sleep_enable_gpio_wakeup();
+    
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        // A press shorter than RESET_HOLD_MS does nothing
+        uint32_t held_ms = 0;
+        while (is_gpio_pressed(GPIO_NUM_0) || is_gpio_pressed(GPIO_NUM_1)) {
+            if (held_ms >= RESET_HOLD_MS) {
+                factory_reset();
+            }
+            vTaskDelay(pdMS_TO_TICKS(RESET_POLL_MS));
+            held_ms += RESET_POLL_MS;
+        }
+        for (size_t i = 0; i < sizeof(pins) / sizeof(pins[0]); i++) {
+            gpio_intr_enable(pins[i]);
+        }
+    }
+}
+
+// Runs on core 1 while app_main starts everything else
+static void charger_init_task(void *arg)
+{
+    // Initialize BQ25895 Battery Charger
+    ESP_LOGI(TAG, "Initializing BQ25895 battery charger");
+    esp_err_t bq_err = bq25895_integration_init();
+    if (bq_err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize BQ25895: %s", esp_err_to_name(bq_err));
+    } else {
+        ESP_LOGI(TAG, "BQ25895 initialized successfully");
+        boot_profile_mark("charger");
+    }
+    vTaskDelete(NULL);
+}
+
 // I2C master initialization
 static esp_err_t i2c_master_init(void)
 {
@@ -743,25 +844,22 @@ static esp_err_t usb_c_pmid_init(void)
 
 void app_main(void)
 {
+    boot_profile_mark("app_main");
+
+    // The charger's boost converter powers the DAC, bring it up on the other
+    // core first so the DAC enumerates while the rest of the system starts
+    BaseType_t ret = xTaskCreatePinnedToCore(charger_init_task, "charger_init", 4096, NULL,
+                                             USER_TASK_PRIORITY, NULL, 1);
+    assert(ret == pdTRUE);
+    
     // Initialize NVS (required for USB subsystem)
-    BaseType_t ret = nvs_flash_init();
+    ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
       ESP_ERROR_CHECK(nvs_flash_erase());
       ret = nvs_flash_init();
     }
     ESP_ERROR_CHECK(ret);
-
-    // Initialize BQ25895 Battery Charger
-    ESP_LOGI(TAG, "Initializing BQ25895 battery charger");
-    esp_err_t bq_err = bq25895_integration_init();
-    if (bq_err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize BQ25895: %s", esp_err_to_name(bq_err));
-        // Decide if this is a critical failure or if the app can continue
-    } else {
-        ESP_LOGI(TAG, "BQ25895 initialized successfully");
-    }
-    
-    // USB-C PMID output is now handled by the BQ25895 driver
+    boot_profile_mark("nvs");
 
     // Create the event group for network activity signaling
     s_network_activity_event_group = xEventGroupCreate();
@@ -771,68 +869,30 @@ void app_main(void)
         esp_restart();
     }
     
-    // Get the wake cause (why the device booted)
-    esp_sleep_wakeup_cause_t wakeup_cause = esp_sleep_get_wakeup_cause();
-    
-    // Only check GPIO pins for reset if this was a power-on or hard reset, not waking from sleep
-    if (wakeup_cause == ESP_SLEEP_WAKEUP_UNDEFINED) {
-        // This is a power-on or hard reset, not a wake from sleep
-        
-        // Configure GPIO pins 0 and 1 as inputs with pull-up resistors
-        gpio_config_t io_conf = {
-            .pin_bit_mask = (1ULL << GPIO_NUM_0) | (1ULL << GPIO_NUM_1),
-            .mode = GPIO_MODE_INPUT,
-            .pull_up_en = GPIO_PULLUP_ENABLE,
-            .pull_down_en = GPIO_PULLDOWN_DISABLE,
-            .intr_type = GPIO_INTR_DISABLE
-        };
-        gpio_config(&io_conf);
-        
-        // Wait 3 seconds and check if pins 0 or 1 are pressed
-        ESP_LOGI(TAG, "Starting 3-second WiFi reset window. Press GPIO 0 or 1 to reset WiFi config...");
-        for (int i = 0; i < 30; i++) { // 30 * 100ms = 3 seconds
-            vTaskDelay(pdMS_TO_TICKS(100));
-            
-            // Check if either pin is pressed
-            if (is_gpio_pressed(GPIO_NUM_0) || is_gpio_pressed(GPIO_NUM_1)) {
-                ESP_LOGI(TAG, "GPIO pin pressed! Wiping WiFi configuration...");
-                
-                // Initialize WiFi manager if it's not already initialized
-                wifi_manager_init();
-                
-                // Clear WiFi credentials from NVS
-                wifi_manager_clear_credentials();
-                
-                // Clear WiFi credentials from ESP's internal WiFi storage
-                esp_wifi_restore();
-                
-                // Reset all settings to defaults
-                config_manager_reset();
-                
-                // To be extra safe, erase the entire NVS (all namespaces)
-                nvs_flash_erase();
-                // Reset all settings to defaults
-                config_manager_reset();
-                
-                // To be extra safe, erase the entire NVS (all namespaces)
-                nvs_flash_erase();
-                
-                ESP_LOGI(TAG, "All settings reset to defaults. Rebooting...");
-                vTaskDelay(pdMS_TO_TICKS(1000)); // Wait 1 second for logs to be printed
-                esp_restart(); // Restart the ESP32
-            }
-        }
-        ESP_LOGI(TAG, "WiFi reset window closed. Continuing with normal startup...");
-    } else {
-        // This is a wake from sleep, skip the GPIO reset check
-        ESP_LOGI(TAG, "Waking from sleep (cause: %d), skipping WiFi reset window", wakeup_cause);
-    }
+#ifdef IS_USB
+    // Before the USB host takes the D+ pad back
+    bool woke_for_dac = deep_sleep_resume();
+#endif
     
+    // Holding GPIO 0 or 1 for RESET_HOLD_MS wipes the WiFi configuration, at
+    // any time instead of in a window boot used to wait through
+    ret = xTaskCreatePinnedToCore(reset_button_task, "reset_button", 3072, NULL,
+                                  USER_TASK_PRIORITY, NULL, 0);
+    assert(ret == pdTRUE);
 
     // Initialize configuration manager
     ESP_LOGI(TAG, "Initializing configuration manager");
     ESP_ERROR_CHECK(config_manager_init());
     app_config_t *current_config = config_manager_get_config();
+    boot_profile_mark("config");
+    
+    // Frequency scaling and light sleep whenever silence sleep releases the audio locks
+    power_init();
+    
+    // The outputs are registered before the USB host starts, a DAC can attach as soon as it does
+    setup_buffer(audio_lane_count());
+    setup_audio();
+    boot_profile_mark("audio");
 
 #ifdef IS_USB
     // Only initialize USB host for DAC detection if sender mode is NOT enabled
@@ -847,97 +907,47 @@ void app_main(void)
         ret = xTaskCreatePinnedToCore(usb_lib_task, "usb_events", 4096, (void *)uac_task_handle,
                                     USB_HOST_TASK_PRIORITY, NULL, 0);
         assert(ret == pdTRUE);
-    
-        // Give USB system enough time to detect and enumerate devices
-        ESP_LOGI(TAG, "Waiting for USB device detection...");
-        // USB enumeration can take time, need to wait for it to complete
-        for (int i = 0; i < 10; i++) {
-            vTaskDelay(pdMS_TO_TICKS(200)); // Total 2 seconds waiting time, checking every 200ms
-            
-            // Check if device was detected during the delay
-            if (s_spk_dev_handle != NULL) {
-                ESP_LOGI(TAG, "DAC detected during enumeration");
-                break;
-            }
-            
-            ESP_LOGI(TAG, "Waiting for DAC... %" PRIu16 "/10", i+1);
-        }
+        // Enumeration carries on while WiFi connects, uac_lib_task starts the
+        // DAC whenever it shows up and the main loop sleeps if it never does
         
-        // Check if DAC is connected
-        if (s_spk_dev_handle == NULL) {
-            ESP_LOGI(TAG, "No DAC detected after waiting");
-            
-            // Only deep sleep if no DAC AND WiFi is configured
-            if (wifi_manager_has_credentials()) {
-                ESP_LOGI(TAG, "No DAC detected and WiFi is configured, going to deep sleep");
-                // Configure timer wakeup
-                //esp_sleep_enable_timer_wakeup(DAC_CHECK_SLEEP_TIME_MS * 1000);
-                // Go to deep sleep immediately
-                //esp_deep_sleep_start();
-                //return; // Never reached
-            } else {
-                ESP_LOGI(TAG, "No DAC detected but no WiFi configured, continuing with WiFi setup");
+        // Woken from waiting for a DAC, sleep again before WiFi costs anything if none enumerates
+        if (woke_for_dac) {
+            for (int waited_ms = 0; waited_ms < DAC_WAKE_GRACE_MS && s_spk_dev_handle == NULL; waited_ms += 50) {
+                vTaskDelay(pdMS_TO_TICKS(50));
             }
+            if (s_spk_dev_handle == NULL) {
+                ESP_LOGI(TAG, "No DAC after %d ms, back to deep sleep", DAC_WAKE_GRACE_MS);
+                enter_deep_sleep_mode();
+            }
+            deep_sleep_dac_found();
         }
-        // Only initialize the rest of the system if DAC is connected
-        ESP_LOGI(TAG, "DAC detected, initializing full system with power optimizations");
     }
 #endif
     
-    // Set CPU to lower frequency to save power
-    #if CONFIG_PM_ENABLE
-    // Configure dynamic frequency scaling based on chip type
-    ESP_LOGI(TAG, "Configuring power management (reduced CPU clock)");
-    
-    #if CONFIG_IDF_TARGET_ESP32
-    esp_pm_config_esp32_t pm_config = {
-        .max_freq_mhz = 80,  // Reduced from 240MHz
-        .min_freq_mhz = 40,
-    #if CONFIG_FREERTOS_USE_TICKLESS_IDLE
-        .light_sleep_enable = true
-    #else
-        .light_sleep_enable = false
-    #endif
-    };
-    #elif CONFIG_IDF_TARGET_ESP32S3
-    esp_pm_config_esp32s3_t pm_config = {
-        .max_freq_mhz = 80,  // Reduced from 240MHz
-        .min_freq_mhz = 40,
-    #if CONFIG_FREERTOS_USE_TICKLESS_IDLE
-        .light_sleep_enable = true
-    #else
-        .light_sleep_enable = false
-    #endif
-    };
-    #endif
-    
-    esp_err_t err = esp_pm_configure(&pm_config);
-    if (err == ESP_ERR_NOT_SUPPORTED) {
-        ESP_LOGW(TAG, "Power management not supported or not enabled in menuconfig");
-    } else {
-        ESP_ERROR_CHECK(err);
-    }
-    #else
-    ESP_LOGW(TAG, "Power management not enabled in menuconfig");
-    #endif
+    // The receive socket binds to any address, it only needs the TCP/IP stack
+    // and is ready before the connection is
+    ESP_ERROR_CHECK(esp_netif_init());
+    setup_network();
+    boot_profile_mark("network");
     
     ESP_LOGI(TAG, "ESP_WIFI_MODE_STA with power saving");
     wifi_init_sta();
+    boot_profile_mark("wifi");
     
-    // Enable WiFi power save mode
-    ESP_ERROR_CHECK(esp_wifi_set_ps(WIFI_PS_MIN_MODEM));
+    // Modem sleep unless the link needs the radio kept awake, max modem sleep in silence sleep
+    power_start_wifi();
 
     // Suppress WiFi warnings (including "exceed max band" messages)
     esp_log_level_set("wifi", ESP_LOG_ERROR);
     
-    setup_buffer();
-    setup_audio();
-    setup_network();
     initialize_ntp_client();
     ESP_LOGI(TAG, "Starting mDNS service for Scream discovery");
     mdns_service_start();
     
 #ifdef IS_USB
+    // Browse for receivers the sender can follow by name
+    mdns_service_start_browse();
+    
     // Initialize the USB Scream Sender if USB mode is enabled
     app_config_t *config = config_manager_get_config();
     if (config->enable_usb_sender) {
@@ -955,6 +965,7 @@ void app_main(void)
         static bool previous_sender_state = false;
         static char previous_dest_ip[16] = {0};
         static uint16_t previous_dest_port = 0;
+        static char previous_extra_dests[SENDER_EXTRA_DESTINATIONS_MAX_LENGTH + 1] = {0};
         
         // Get current config
         app_config_t *current_config = config_manager_get_config();
@@ -978,10 +989,40 @@ void app_main(void)
             previous_sender_state = current_config->enable_usb_sender;
         }
         
+        // Give an unplugged DAC a grace period to come back before sleeping
+        uint32_t detached_ms = audio_dac_detached_ms();
+        if (detached_ms > DAC_REPLUG_GRACE_MS && !device_sleeping) {
+            ESP_LOGI(TAG, "DAC not replugged after %" PRIu32 " ms, entering deep sleep", detached_ms);
+            enter_deep_sleep_mode();
+        }
+        
+        // Follow a receiver discovered over mDNS, the lookup only reads the cache
+        if (current_config->enable_usb_sender && current_config->sender_destination_name[0] != '\0') {
+            scream_sender_format_t format;
+            mdns_receiver_t receiver;
+            scream_sender_get_format(&format);
+            if (mdns_service_find_receiver(current_config->sender_destination_name, format.sample_rate,
+                                           format.bit_depth, format.channels, &receiver)) {
+                char ip_str[16];
+                struct in_addr addr = { .s_addr = receiver.ip };
+                inet_ntoa_r(addr, ip_str, sizeof(ip_str));
+                if (strcmp(ip_str, current_config->sender_destination_ip) != 0 ||
+                    receiver.port != current_config->sender_destination_port) {
+                    ESP_LOGI(TAG, "Receiver '%s' resolved to %s (%s:%u)", current_config->sender_destination_name,
+                             receiver.instance_name, ip_str, receiver.port);
+                    // Only updated in memory, the change below applies it to the sender
+                    strncpy(current_config->sender_destination_ip, ip_str, sizeof(current_config->sender_destination_ip) - 1);
+                    current_config->sender_destination_ip[sizeof(current_config->sender_destination_ip) - 1] = '\0';
+                    current_config->sender_destination_port = receiver.port;
+                }
+            }
+        }
+        
         // Check if destination has changed while sender is running
         if (current_config->enable_usb_sender && scream_sender_is_running() &&
             (strcmp(previous_dest_ip, current_config->sender_destination_ip) != 0 ||
-             previous_dest_port != current_config->sender_destination_port)) {
+             previous_dest_port != current_config->sender_destination_port ||
+             strcmp(previous_extra_dests, current_config->sender_extra_destinations) != 0)) {
              
             ESP_LOGI(TAG, "USB Scream Sender destination changed to %s:%d", 
                     current_config->sender_destination_ip, current_config->sender_destination_port);
@@ -991,6 +1032,8 @@ void app_main(void)
             strncpy(previous_dest_ip, current_config->sender_destination_ip, sizeof(previous_dest_ip) - 1);
             previous_dest_ip[sizeof(previous_dest_ip) - 1] = '\0'; // Ensure null termination
             previous_dest_port = current_config->sender_destination_port;
+            strncpy(previous_extra_dests, current_config->sender_extra_destinations, sizeof(previous_extra_dests) - 1);
+            previous_extra_dests[sizeof(previous_extra_dests) - 1] = '\0';
         }
 #endif
         vTaskDelay(pdMS_TO_TICKS(1000));
@@ -1010,8 +1053,15 @@ void wifi_init_sta(void)
     // Initialize roaming functionality
     ESP_ERROR_CHECK(wifi_manager_init_roaming());
     
-    // Try to connect to the strongest network first
-    esp_err_t ret = wifi_manager_connect_to_strongest();
+    // Try to connect to the strongest network first, unless the access point of
+    // the last connection is cached, a scan of every channel takes longer than
+    // connecting to it and falls back to a scan when it's gone anyway
+    esp_err_t ret = ESP_FAIL;
+    if (wifi_manager_has_fast_connect()) {
+        ESP_LOGI(TAG, "Cached access point found, skipping the scan");
+    } else {
+        ret = wifi_manager_connect_to_strongest();
+    }
     
     // If connecting to strongest network fails, fall back to normal behavior:
     // 1. Connect using stored credentials if available
@@ -0,0 +1,418 @@
+#include "global.h"
+#ifdef IS_USB
+#include "usb_dac.h"
+#include "sink.h"
+#include "converter.h"
+#include "config_manager.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    // Guards handle so a write never races the DAC being unplugged
+    SemaphoreHandle_t lock;
+    uac_host_device_handle_t handle;
+    // Given on every TX done event, the output task waits on it when the DAC is full
+    SemaphoreHandle_t tx_done_sem;
+    // Stream config of the last successful start, reused when the DAC is replugged
+    uac_host_stream_config_t stream_config;
+    bool stream_config_valid;
+    // Rate of the stream the zone was started for, a chunk is PCM_CHUNK_SIZE / 4 frames of it
+    uint32_t stream_rate;
+    bool started;
+    bool registered;
+    int8_t channel_pair;
+    // Converts the 16-bit stream when the DAC doesn't support its format natively
+    converter_t converter;
+    bool convert;
+    uint8_t *convert_out;
+    uint32_t prepare_avg_us;
+    uint32_t prepare_max_us;
+    char name[8];
+    sink_ops_t sink;
+} usb_dac_t;
+
+static usb_dac_t s_dacs[USB_DAC_MAX];
+static portMUX_TYPE s_zone_lock = portMUX_INITIALIZER_UNLOCKED;
+static void (*s_write_callback)(int zone) = NULL;
+
+// Rates the DAC is asked for when it can't take the stream rate, the resampler handles these ratios
+static const uint32_t s_fallback_rates[] = { 48000, 96000, 44100, 88200 };
+
+static bool alt_supports_rate(const uac_host_dev_alt_param_t *alt, uint32_t rate) {
+    if (alt->sample_freq_type == 0) {
+        // Continuous range
+        return rate >= alt->sample_freq_lower && rate <= alt->sample_freq_upper;
+    }
+    for (int i = 0; i < alt->sample_freq_type && i < UAC_FREQ_NUM_MAX; i++) {
+        if (alt->sample_freq[i] == rate) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Lower is better: the stream rate beats any resampling, then the nearest rate,
+// then the narrowest bit depth
+static uint32_t format_cost(uint32_t in_rate, uint32_t rate, uint8_t bits) {
+    uint32_t cost = (bits - 16) / 8;
+    if (rate != in_rate) {
+        cost += 100 + (rate > in_rate ? rate - in_rate : in_rate - rate) / 100;
+    }
+    return cost;
+}
+
+// Choose the stereo format the DAC advertises that is closest to the stream format
+static esp_err_t negotiate_format(usb_dac_t *dac, uint32_t in_rate, uac_host_stream_config_t *stm_config) {
+    uac_host_dev_info_t dev_info;
+    memset(stm_config, 0, sizeof(*stm_config));
+    stm_config->channels = 2;
+    stm_config->bit_resolution = 16;
+    stm_config->sample_freq = in_rate;
+    if (uac_host_get_device_info(dac->handle, &dev_info) != ESP_OK || dev_info.iface_alt_num == 0) {
+        // Nothing advertised, try the stream format as is
+        return ESP_OK;
+    }
+
+    uint32_t best_cost = UINT32_MAX;
+    for (uint8_t i = 1; i <= dev_info.iface_alt_num; i++) {
+        uac_host_dev_alt_param_t alt;
+        if (uac_host_get_device_alt_param(dac->handle, i, &alt) != ESP_OK) {
+            continue;
+        }
+        if (alt.channels != 2 || (alt.bit_resolution != 16 && alt.bit_resolution != 24 && alt.bit_resolution != 32)) {
+            continue;
+        }
+        uint32_t rate = 0;
+        if (alt_supports_rate(&alt, in_rate)) {
+            rate = in_rate;
+        } else {
+            uint32_t best_rate_cost = UINT32_MAX;
+            for (size_t r = 0; r < sizeof(s_fallback_rates) / sizeof(s_fallback_rates[0]); r++) {
+                uint32_t cost = format_cost(in_rate, s_fallback_rates[r], alt.bit_resolution);
+                if (alt_supports_rate(&alt, s_fallback_rates[r]) && cost < best_rate_cost) {
+                    rate = s_fallback_rates[r];
+                    best_rate_cost = cost;
+                }
+            }
+        }
+        if (rate == 0) {
+            continue;
+        }
+        uint32_t cost = format_cost(in_rate, rate, alt.bit_resolution);
+        if (cost < best_cost) {
+            best_cost = cost;
+            stm_config->bit_resolution = alt.bit_resolution;
+            stm_config->sample_freq = rate;
+        }
+    }
+    return best_cost == UINT32_MAX ? ESP_ERR_NOT_SUPPORTED : ESP_OK;
+}
+
+// Set up the converter between the 16-bit stream and the negotiated DAC format,
+// called with the DAC lock held since the output task converts under it
+static esp_err_t setup_converter(usb_dac_t *dac, uint32_t in_rate, const uac_host_stream_config_t *stm_config) {
+    converter_deinit(&dac->converter);
+    free(dac->convert_out);
+    dac->convert_out = NULL;
+    dac->convert = false;
+    if (stm_config->sample_freq == in_rate && stm_config->bit_resolution == 16) {
+        return ESP_OK;
+    }
+
+    if (!converter_init(&dac->converter, in_rate, stm_config->sample_freq,
+                        stm_config->bit_resolution, stm_config->channels)) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    size_t out_size = converter_max_output(&dac->converter, PCM_CHUNK_SIZE / 4);
+    dac->convert_out = malloc(out_size);
+    if (dac->convert_out == NULL) {
+        converter_deinit(&dac->converter);
+        return ESP_ERR_NO_MEM;
+    }
+    dac->convert = true;
+    return ESP_OK;
+}
+
+// Convert a gain-adjusted chunk to the DAC format, runs on the zone's output task
+static const uint8_t *usb_sink_prepare(void *ctx, const uint8_t *chunk, size_t *len) {
+    usb_dac_t *dac = (usb_dac_t *)ctx;
+    const uint8_t *out = chunk;
+    int64_t start = esp_timer_get_time();
+    xSemaphoreTake(dac->lock, portMAX_DELAY);
+    if (dac->convert) {
+        *len = converter_process(&dac->converter, (const int16_t *)chunk, PCM_CHUNK_SIZE / 4, dac->convert_out);
+        out = dac->convert_out;
+    }
+    xSemaphoreGive(dac->lock);
+
+    uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+    if (elapsed > dac->prepare_max_us) {
+        dac->prepare_max_us = elapsed;
+    }
+    // Exponential moving average with a 1/16 weight
+    dac->prepare_avg_us += ((int32_t)elapsed - (int32_t)dac->prepare_avg_us) / 16;
+    return out;
+}
+
+// Write to the DAC without waiting, ESP_ERR_INVALID_STATE when no DAC is attached
+static esp_err_t dac_try_write(usb_dac_t *dac, const uint8_t *data, size_t len) {
+    esp_err_t err = ESP_ERR_INVALID_STATE;
+    xSemaphoreTake(dac->lock, portMAX_DELAY);
+    if (dac->handle != NULL && dac->started) {
+        err = uac_host_device_write(dac->handle, (uint8_t *)data, len, 0);
+    }
+    xSemaphoreGive(dac->lock);
+    return err;
+}
+
+// Write a chunk to the DAC, waiting on TX done events for room but never longer than timeout
+static esp_err_t usb_sink_write(void *ctx, const uint8_t *data, size_t len, TickType_t timeout) {
+    usb_dac_t *dac = (usb_dac_t *)ctx;
+    int64_t deadline = esp_timer_get_time() + (int64_t)timeout * portTICK_PERIOD_MS * 1000;
+    // Drop a stale TX done so the wait below is for room made after this write
+    xSemaphoreTake(dac->tx_done_sem, 0);
+    esp_err_t err;
+    while ((err = dac_try_write(dac, data, len)) != ESP_OK) {
+        int64_t remaining_us = deadline - esp_timer_get_time();
+        if (err == ESP_ERR_INVALID_STATE) {
+            return err;
+        }
+        if (remaining_us <= 0) {
+            return ESP_ERR_TIMEOUT;
+        }
+        xSemaphoreTake(dac->tx_done_sem, pdMS_TO_TICKS(remaining_us / 1000) + 1);
+    }
+    if (s_write_callback != NULL) {
+        s_write_callback(dac - s_dacs);
+    }
+    return ESP_OK;
+}
+
+int usb_dac_zone_pair(int zone) {
+    const char *p = config_manager_get_config()->usb_zone_channels;
+    for (int i = 0; i < zone && p != NULL; i++) {
+        p = strchr(p, ',');
+        if (p != NULL) {
+            p++;
+        }
+    }
+    if (p == NULL) {
+        return -1;
+    }
+    while (*p == ' ') {
+        p++;
+    }
+    if (*p < '0' || *p > '3') {
+        return -1;
+    }
+    return *p - '0';
+}
+
+int usb_dac_zone_lane(int zone) {
+    if (usb_dac_zone_pair(zone) < 0) {
+        return 0;
+    }
+    // Zones bound to a pair take the lanes after the receiver's own, in zone order
+    int lane = 1;
+    for (int i = 0; i < zone; i++) {
+        if (usb_dac_zone_pair(i) >= 0) {
+            lane++;
+        }
+    }
+    return lane;
+}
+
+// Locks and the output of a zone are made on first use, the DAC can enumerate before setup_audio()
+static esp_err_t zone_init(int zone) {
+    usb_dac_t *dac = &s_dacs[zone];
+    if (dac->registered) {
+        return ESP_OK;
+    }
+    if (dac->lock == NULL) {
+        dac->lock = xSemaphoreCreateMutex();
+        dac->tx_done_sem = xSemaphoreCreateBinary();
+        if (dac->lock == NULL || dac->tx_done_sem == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    snprintf(dac->name, sizeof(dac->name), "usb%d", zone);
+    dac->sink.name = dac->name;
+    dac->sink.ctx = dac;
+    dac->sink.prepare = usb_sink_prepare;
+    dac->sink.write = usb_sink_write;
+    // Zone 0 paces playback, the others drop their oldest audio if their DAC falls behind
+    esp_err_t err = sink_register(&dac->sink, SINK_DROP_OLDEST, zone == 0);
+    if (err == ESP_OK) {
+        dac->registered = true;
+    }
+    return err;
+}
+
+esp_err_t usb_dac_init(void (*write_callback)(int zone)) {
+    s_write_callback = write_callback;
+    return zone_init(0);
+}
+
+int usb_dac_attach(uac_host_device_handle_t handle) {
+    int zone = -1;
+    taskENTER_CRITICAL(&s_zone_lock);
+    for (int i = 0; i < USB_DAC_MAX; i++) {
+        if (s_dacs[i].handle == NULL) {
+            zone = i;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&s_zone_lock);
+    if (zone < 0) {
+        ESP_LOGW(TAG, "No free zone for another USB DAC, at most %d are supported", USB_DAC_MAX);
+        return -1;
+    }
+
+    esp_err_t err = zone_init(zone);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set up zone %d output: %s", zone, esp_err_to_name(err));
+        return -1;
+    }
+    usb_dac_t *dac = &s_dacs[zone];
+    xSemaphoreTake(dac->lock, portMAX_DELAY);
+    dac->handle = handle;
+    dac->started = false;
+    dac->channel_pair = usb_dac_zone_pair(zone);
+    xSemaphoreGive(dac->lock);
+    sink_set_lane(dac->name, usb_dac_zone_lane(zone));
+    if (dac->channel_pair >= 0) {
+        ESP_LOGI(TAG, "USB DAC attached as zone %d, channel pair %d", zone, dac->channel_pair);
+    } else {
+        ESP_LOGI(TAG, "USB DAC attached as zone %d, playing the receiver's mix", zone);
+    }
+    return zone;
+}
+
+int usb_dac_detach(uac_host_device_handle_t handle) {
+    for (int zone = 0; zone < USB_DAC_MAX; zone++) {
+        usb_dac_t *dac = &s_dacs[zone];
+        if (dac->lock == NULL || dac->handle != handle) {
+            continue;
+        }
+        xSemaphoreTake(dac->lock, portMAX_DELAY);
+        dac->handle = NULL;
+        dac->started = false;
+        xSemaphoreGive(dac->lock);
+        ESP_LOGI(TAG, "USB DAC in zone %d detached", zone);
+        return zone;
+    }
+    return -1;
+}
+
+esp_err_t usb_dac_start(int zone, uint32_t in_rate) {
+    usb_dac_t *dac = &s_dacs[zone];
+    if (dac->handle == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uac_host_stream_config_t stm_config;
+    esp_err_t err = negotiate_format(dac, in_rate, &stm_config);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Zone %d DAC supports no stereo format that %" PRIu32 " Hz can be converted to", zone, in_rate);
+        return err;
+    }
+    xSemaphoreTake(dac->lock, portMAX_DELAY);
+    err = setup_converter(dac, in_rate, &stm_config);
+    xSemaphoreGive(dac->lock);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set up format converter for zone %d: %s", zone, esp_err_to_name(err));
+        return err;
+    }
+    ESP_LOGI(TAG, "Starting zone %d DAC (SR: %" PRIu32 ", BD: %" PRIu8 ") from stream (SR: %" PRIu32 ")%s",
+             zone, stm_config.sample_freq, stm_config.bit_resolution, in_rate, dac->convert ? ", converting" : "");
+
+    dac->stream_config = stm_config;
+    dac->stream_config_valid = true;
+    dac->stream_rate = in_rate;
+    return usb_dac_restart(zone);
+}
+
+esp_err_t usb_dac_restart(int zone) {
+    usb_dac_t *dac = &s_dacs[zone];
+    if (dac->handle == NULL || !dac->stream_config_valid) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t err = uac_host_device_start(dac->handle, &dac->stream_config);
+    if (err == ESP_OK) {
+        // Volume is applied in software by the gain stage, keep the DAC at full scale
+        err = uac_host_device_set_volume(dac->handle, 100);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start zone %d DAC: %s", zone, esp_err_to_name(err));
+        return err;
+    }
+    dac->started = true;
+    sink_wake(dac->name);
+    return ESP_OK;
+}
+
+void usb_dac_stop(int zone) {
+    usb_dac_t *dac = &s_dacs[zone];
+    if (dac->lock == NULL) {
+        return;
+    }
+    xSemaphoreTake(dac->lock, portMAX_DELAY);
+    if (dac->handle != NULL && dac->started) {
+        uac_host_device_stop(dac->handle);
+    }
+    dac->started = false;
+    xSemaphoreGive(dac->lock);
+}
+
+bool usb_dac_connected(int zone) {
+    return s_dacs[zone].handle != NULL;
+}
+
+void usb_dac_tx_done(uac_host_device_handle_t handle) {
+    for (int zone = 0; zone < USB_DAC_MAX; zone++) {
+        if (s_dacs[zone].handle == handle && s_dacs[zone].tx_done_sem != NULL) {
+            xSemaphoreGive(s_dacs[zone].tx_done_sem);
+            return;
+        }
+    }
+}
+
+int usb_dac_get_info(usb_dac_info_t *info, int max) {
+    int n = 0;
+    for (int zone = 0; zone < USB_DAC_MAX && n < max; zone++) {
+        usb_dac_t *dac = &s_dacs[zone];
+        usb_dac_info_t *out = &info[n++];
+        memset(out, 0, sizeof(*out));
+        out->connected = dac->handle != NULL;
+        out->started = dac->started;
+        out->channel_pair = dac->channel_pair;
+        out->prepare_avg_us = dac->prepare_avg_us;
+        out->prepare_max_us = dac->prepare_max_us;
+        if (dac->stream_config_valid) {
+            uint32_t rate = dac->stream_config.sample_freq;
+            uint32_t frame_bytes = dac->stream_config.channels * (dac->stream_config.bit_resolution == 24 ? 3 : dac->stream_config.bit_resolution / 8);
+            out->sample_rate = rate;
+            out->bit_depth = dac->stream_config.bit_resolution;
+            // One packet a frame, sized for the most samples a 1ms frame can carry
+            if (out->connected) {
+                out->bus_bytes_per_ms = ((rate + 999) / 1000) * frame_bytes + USB_FS_ISO_OVERHEAD_BYTES;
+            }
+            // A chunk is PCM_CHUNK_SIZE / 4 frames of the stream this zone was started for
+            uint32_t chunk_period_us = dac->stream_rate ? (uint32_t)((uint64_t)(PCM_CHUNK_SIZE / 4) * 1000000 / dac->stream_rate) : 0;
+            out->cpu_permille = chunk_period_us ? dac->prepare_avg_us * 1000 / chunk_period_us : 0;
+        }
+        if (dac->convert) {
+            out->converting = true;
+            out->converter_avg_cycles = dac->converter.avg_cycles;
+            out->converter_max_cycles = dac->converter.max_cycles;
+        }
+    }
+    return n;
+}
+#endif
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "usb/uac_host.h"
+
+// USB DACs that can play at once, behind a hub
+#define USB_DAC_MAX 3
+// Bytes per 1ms frame a full speed bus can give periodic transfers (90% of 1500)
+#define USB_FS_PERIODIC_BYTES_PER_MS 1350
+// Per transaction cost of an isochronous OUT on a full speed bus, in byte times
+#define USB_FS_ISO_OVERHEAD_BYTES 9
+
+/**
+ * USB DACs by zone. Zone 0 is the primary DAC that paces playback, further
+ * DACs connected through a hub take the next free zone and play from their
+ * own output queue, either the receiver's mix or the channel pair the zone is
+ * bound to. Each zone negotiates its own format and converts to it on its own
+ * output task.
+ */
+typedef struct {
+    bool connected;
+    bool started;
+    int8_t channel_pair;            // Stream channel pair the zone plays, 0 is channels 1 and 2, -1 the receiver's mix
+    uint32_t sample_rate;           // Rate negotiated with the DAC, 0 before it starts
+    uint8_t bit_depth;              // Bit depth negotiated with the DAC
+    bool converting;
+    uint32_t bus_bytes_per_ms;      // Full speed bus time the stream takes, overhead included
+    uint32_t prepare_avg_us;        // Conversion cost per chunk on the output task, moving average
+    uint32_t prepare_max_us;        // Conversion cost per chunk, worst case
+    uint32_t cpu_permille;          // prepare_avg_us as a share of the chunk period
+    uint32_t converter_avg_cycles;  // Format conversion cost per chunk, 0 when not converting
+    uint32_t converter_max_cycles;  // Format conversion cost per chunk, worst case
+} usb_dac_info_t;
+
+/**
+ * Register the output of the primary zone so it paces playback from boot
+ *
+ * @param write_callback Run after every chunk a DAC accepts, may be NULL
+ */
+esp_err_t usb_dac_init(void (*write_callback)(int zone));
+
+/**
+ * Stream channel pair a zone is bound to by the usb_zone_channels setting
+ *
+ * @return Pair index, or -1 if the zone plays the receiver's own mix
+ */
+int usb_dac_zone_pair(int zone);
+
+/**
+ * Sink lane carrying the audio of a zone, 0 is the receiver's own mix
+ */
+int usb_dac_zone_lane(int zone);
+
+/**
+ * Take a free zone for a newly opened DAC and register its output
+ *
+ * @return Zone of the DAC, or -1 when all zones are taken
+ */
+int usb_dac_attach(uac_host_device_handle_t handle);
+
+/**
+ * Release the zone of an unplugged DAC, its output keeps queueing until one returns
+ *
+ * @return Zone the DAC had, or -1 for an unknown handle
+ */
+int usb_dac_detach(uac_host_device_handle_t handle);
+
+/**
+ * Pick the DAC format closest to the stream, set up conversion and start it
+ *
+ * @param in_rate Rate of the 16-bit stereo stream
+ * @return ESP_OK, ESP_ERR_INVALID_STATE without a DAC, or ESP_ERR_NOT_SUPPORTED
+ *         when the DAC takes no format the stream can be converted to
+ */
+esp_err_t usb_dac_start(int zone, uint32_t in_rate);
+
+/**
+ * Start a replugged DAC with the format of its last successful start
+ */
+esp_err_t usb_dac_restart(int zone);
+
+void usb_dac_stop(int zone);
+
+bool usb_dac_connected(int zone);
+
+/**
+ * Called on TX done, wakes the output task of the DAC if it is waiting for room
+ */
+void usb_dac_tx_done(uac_host_device_handle_t handle);
+
+/**
+ * Copy the state of every zone
+ *
+ * @return Number of zones written to info, always USB_DAC_MAX when max allows
+ */
+int usb_dac_get_info(usb_dac_info_t *info, int max);
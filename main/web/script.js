@@ -43,6 +43,98 @@ function openTab(evt, tabName) {
     // Show the specific tab content and add active class to the button
     document.getElementById(tabName).classList.add('active');
     evt.currentTarget.classList.add('active');
+
+    // Meters only stream while someone is looking at them
+    if (tabName !== 'status-tab') {
+        stopMeters();
+    }
+}
+
+// Level meters from /ws/meters, see web_server.c for the frame layout
+let meterSocket = null;
+// Meters show this many dB below full scale
+const METER_RANGE_DB = 60;
+
+function startMeters() {
+    if (meterSocket) {
+        return;
+    }
+    meterSocket = new WebSocket('ws://' + window.location.host + '/ws/meters');
+    meterSocket.binaryType = 'arraybuffer';
+    meterSocket.onopen = () => setSpectrum(document.getElementById('show_spectrum').checked);
+    meterSocket.onmessage = event => drawMeters(new Uint8Array(event.data));
+    meterSocket.onclose = () => {
+        meterSocket = null;
+    };
+}
+
+function stopMeters() {
+    if (meterSocket) {
+        meterSocket.close();
+        meterSocket = null;
+    }
+}
+
+function setSpectrum(enabled) {
+    document.getElementById('spectrum').classList.toggle('hidden', !enabled);
+    if (meterSocket && meterSocket.readyState === WebSocket.OPEN) {
+        meterSocket.send(new Uint8Array([enabled ? 1 : 0]));
+    }
+}
+
+// Level codes count half dB steps down from full scale, 255 is silence
+function levelDb(code) {
+    return code === 255 ? -Infinity : -code / 2;
+}
+
+function formatDb(db) {
+    return db === -Infinity ? '-' : db.toFixed(1);
+}
+
+function drawMeters(frame) {
+    if (frame[0] !== 1) {
+        return;
+    }
+    const lanes = frame[1];
+    const bands = frame[2];
+    const playing = frame[3] & 1;
+    const rows = [];
+    for (let lane = 0; lane < lanes; lane++) {
+        for (let ch = 0; ch < 2; ch++) {
+            rows.push({
+                name: (lane === 0 ? 'Receiver' : 'Zone ' + lane) + (ch === 0 ? ' L' : ' R'),
+                peak: levelDb(frame[4 + lane * 4 + ch]),
+                rms: levelDb(frame[4 + lane * 4 + 2 + ch]),
+            });
+        }
+    }
+    fillStatusTable(document.getElementById('meters'), [
+        { title: playing ? 'Playing' : 'Idle', value: r => r.name },
+        { title: 'RMS', value: r => {
+            const bar = document.createElement('meter');
+            bar.min = -METER_RANGE_DB;
+            bar.max = 0;
+            bar.high = -6;
+            bar.value = Math.max(r.rms, -METER_RANGE_DB);
+            return bar;
+        } },
+        { title: 'RMS (dB)', value: r => formatDb(r.rms) },
+        { title: 'Peak (dB)', value: r => formatDb(r.peak) },
+    ], rows);
+
+    const canvas = document.getElementById('spectrum');
+    if (bands === 0 || canvas.classList.contains('hidden')) {
+        return;
+    }
+    const ctx = canvas.getContext('2d');
+    const width = canvas.width / bands;
+    ctx.clearRect(0, 0, canvas.width, canvas.height);
+    ctx.fillStyle = '#4caf50';
+    for (let band = 0; band < bands; band++) {
+        const db = Math.max(levelDb(frame[4 + lanes * 4 + band]), -METER_RANGE_DB);
+        const height = canvas.height * (1 + db / METER_RANGE_DB);
+        ctx.fillRect(band * width + 1, canvas.height - height, width - 2, height);
+    }
 }
 
 function loadSettings() {
@@ -71,18 +163,45 @@ function loadSettings() {
             document.getElementById('sample_rate').value = settings.sample_rate;
             document.getElementById('bit_depth').value = settings.bit_depth;
             document.getElementById('volume').value = settings.volume;
+            document.getElementById('channel_mode').value = settings.channel_mode;
+            document.getElementById('channel_select').value = settings.channel_select;
+            document.getElementById('downmix_matrix').value = settings.downmix_matrix || '';
+            document.getElementById('eq_bands').value = settings.eq_bands || '';
+            document.getElementById('compressor_enabled').checked = settings.compressor_enabled;
+            document.getElementById('compressor_threshold_db').value = settings.compressor_threshold_db;
+            document.getElementById('compressor_ratio').value = settings.compressor_ratio;
+            document.getElementById('compressor_attack_ms').value = settings.compressor_attack_ms;
+            document.getElementById('compressor_release_ms').value = settings.compressor_release_ms;
+            document.getElementById('compressor_makeup_db').value = settings.compressor_makeup_db;
+            document.getElementById('limiter_enabled').checked = settings.limiter_enabled;
+            document.getElementById('limiter_ceiling_db').value = settings.limiter_ceiling_db;
+            document.getElementById('lookahead_ms').value = settings.lookahead_ms;
+            loadFirStatus();
             document.getElementById('use_direct_write').checked = settings.use_direct_write;
             
-            // SPDIF settings (only if element exists)
-            if (document.getElementById('spdif_data_pin') && settings.spdif_data_pin !== undefined) {
-                document.getElementById('spdif_data_pin').value = settings.spdif_data_pin;
+            // USB DAC buffering settings (only if elements exist)
+            if (document.getElementById('usb_buffer_chunks')) {
+                document.getElementById('usb_buffer_chunks').value = settings.usb_buffer_chunks;
+                document.getElementById('usb_threshold_chunks').value = settings.usb_threshold_chunks;
+                document.getElementById('usb_zone_channels').value = settings.usb_zone_channels || '';
             }
             
+            // Output settings
+            document.getElementById('spdif_data_pin').value = settings.spdif_data_pin;
+            document.getElementById('enable_spdif_output').checked = settings.enable_spdif_output;
+            document.getElementById('enable_i2s_output').checked = settings.enable_i2s_output;
+            document.getElementById('i2s_bck_pin').value = settings.i2s_bck_pin;
+            document.getElementById('i2s_ws_pin').value = settings.i2s_ws_pin;
+            document.getElementById('i2s_data_pin').value = settings.i2s_data_pin;
+            
             // USB Sender settings (only if elements exist)
             if (document.getElementById('enable_usb_sender')) {
                 document.getElementById('enable_usb_sender').checked = settings.enable_usb_sender;
                 document.getElementById('sender_destination_ip').value = settings.sender_destination_ip || '192.168.1.255';
                 document.getElementById('sender_destination_port').value = settings.sender_destination_port || 4010;
+                document.getElementById('sender_extra_destinations').value = settings.sender_extra_destinations || '';
+                document.getElementById('sender_destination_name').value = settings.sender_destination_name || '';
+                loadReceivers();
                 
                 // Update visibility of sender options
                 updateSenderOptionsVisibility();
@@ -102,6 +221,222 @@ function loadSettings() {
         });
 }
 
+// Offer receivers discovered over mDNS as choices for the receiver name
+function loadReceivers() {
+    fetch('/status')
+        .then(response => response.json())
+        .then(status => {
+            const list = document.getElementById('sender_receivers');
+            if (!list) return;
+            list.innerHTML = '';
+            const auto = document.createElement('option');
+            auto.value = 'auto';
+            list.appendChild(auto);
+            (status.receivers || []).forEach(receiver => {
+                const option = document.createElement('option');
+                option.value = receiver.name;
+                option.textContent = receiver.name + ' (' + receiver.ip + ', ' + receiver.latency_ms + ' ms)';
+                list.appendChild(option);
+            });
+        })
+        .catch(error => {
+            console.error('Error loading receivers:', error);
+        });
+}
+
+function fillStatusTable(table, columns, rows) {
+    table.innerHTML = '';
+    const header = table.insertRow();
+    columns.forEach(column => {
+        const cell = document.createElement('th');
+        cell.textContent = column.title;
+        header.appendChild(cell);
+    });
+    rows.forEach(row => {
+        const tr = table.insertRow();
+        columns.forEach(column => {
+            const value = column.value(row);
+            const cell = tr.insertCell();
+            if (value instanceof Node) {
+                cell.appendChild(value);
+            } else {
+                cell.textContent = value;
+            }
+        });
+    });
+}
+
+function loadOutputStatus() {
+    fetch('/status')
+        .then(response => response.json())
+        .then(status => {
+            fillStatusTable(document.getElementById('sink-status'), [
+                { title: 'Output', value: s => s.name + (s.primary ? ' (primary)' : '') },
+                { title: 'Written', value: s => s.written },
+                { title: 'Dropped', value: s => s.dropped },
+                { title: 'Stalls', value: s => s.stalls },
+                { title: 'Queued', value: s => s.queue_depth },
+                { title: 'Latency (ms)', value: s => (s.latency_avg_us / 1000).toFixed(1) },
+            ], status.sinks || []);
+
+            fillStatusTable(document.getElementById('pipeline-status'), [
+                { title: 'Stage', value: p => p.name },
+                { title: 'Blocks', value: p => p.runs },
+                { title: 'Avg cycles', value: p => p.avg_cycles },
+                { title: 'Max cycles', value: p => p.max_cycles },
+                { title: 'Enabled', value: p => {
+                    const box = document.createElement('input');
+                    box.type = 'checkbox';
+                    box.checked = p.enabled;
+                    box.onchange = () => setPipelineStage(p.name, box.checked);
+                    return box;
+                } },
+            ], status.pipeline || []);
+
+            const audio = status.audio || {};
+            document.getElementById('dynamics-status').textContent =
+                'Gain reduction: ' + (audio.gain_reduction_db || 0).toFixed(1) + ' dB now, '
+                + (audio.gain_reduction_peak_db || 0).toFixed(1) + ' dB peak';
+
+            const power = status.power || {};
+            document.getElementById('silence-status').textContent =
+                'Silent chunks: ' + (audio.silent_chunks || 0) + ', slept ' + (audio.silence_sleeps || 0)
+                + ' times for ' + (power.sleep_hours || 0).toFixed(1) + ' h. '
+                + (audio.wakes
+                    ? 'Last wake: DAC started in ' + (audio.wake_dac_start_us / 1000).toFixed(1)
+                        + ' ms, first sound ' + (audio.wake_to_sound_us / 1000).toFixed(1) + ' ms after the audio arrived. '
+                    : '')
+                + (power.valid
+                    ? 'Sleep saves an estimated ' + power.saved_mwh_per_idle_hour.toFixed(0) + ' mWh per idle hour ('
+                        + power.awake_idle_mw.toFixed(0) + ' mW awake, ' + power.sleep_mw.toFixed(0)
+                        + ' mW asleep into the battery), ' + power.saved_mwh.toFixed(0) + ' mWh so far.'
+                    : 'Energy saved is estimated once the charger has been at its input limit both awake and asleep.')
+                + (power.measures ? ' Based on ' + power.measures + '.' : '');
+
+            // Current is what the battery gets on USB input at the input limit, delay is how far packets lag the stream's pace
+            fillStatusTable(document.getElementById('power-modes'), [
+                { title: 'Mode', value: m => m.name + (m.name === power.mode ? ' (now)' : '') },
+                { title: 'Charge current', value: m => m.samples ? m.charge_ma.toFixed(0) + ' mA' : '-' },
+                { title: 'Draw over sleep', value: m => m.samples && m.name !== 'sleep' ? m.extra_ma.toFixed(0) + ' mA' : '-' },
+                { title: 'Packet delay avg', value: m => (m.delivery_delay_avg_us / 1000).toFixed(1) + ' ms' },
+                { title: 'Packet delay max', value: m => (m.delivery_delay_max_us / 1000).toFixed(1) + ' ms' },
+            ], power.modes || []);
+
+            const wifiPs = status.wifi_ps || {};
+            document.getElementById('wifi-ps-status').textContent =
+                'Wi-Fi power save: ' + ({ none: 'off', min_modem: 'modem sleep', max_modem: 'max modem sleep' }[wifiPs.mode] || '-')
+                + ', jitter ' + ((wifiPs.jitter_us || 0) / 1000).toFixed(1) + ' ms, ' + (wifiPs.switches || 0) + ' switches. '
+                + 'Off for ' + (wifiPs.none_seconds || 0).toFixed(0) + ' s, an estimated ' + (wifiPs.extra_ma || 0).toFixed(0)
+                + ' mA now and ' + (wifiPs.average_extra_ma || 0).toFixed(1) + ' mA on average. Modem sleep returns after '
+                + (wifiPs.hold_s || 0) + ' s of clean link.';
+
+            const boot = status.boot || {};
+            const bootStep = ms => ms ? (ms / 1000).toFixed(2) + ' s' : 'not yet';
+            document.getElementById('boot-status').textContent =
+                'Boot: associated after ' + bootStep(boot.associated_ms)
+                + (boot.fast_connect ? ' with the cached access point' : ' after a scan')
+                + (boot.fast_connect_failures ? ' (cached access point missing)' : '')
+                + ', IP address after ' + bootStep(boot.got_ip_ms) + (boot.static_lease ? ' from the cached lease' : '')
+                + ', first audio after ' + bootStep(boot.first_audio_ms) + '.';
+
+            // Init steps in the order they finished, the gap is the time since the previous one
+            const stages = boot.stages || [];
+            fillStatusTable(document.getElementById('boot-stages'), [
+                { title: 'Step', value: st => st.name },
+                { title: 'Done after', value: st => st.ms + ' ms' },
+                { title: 'Gap', value: st => {
+                    const i = stages.indexOf(st);
+                    return i > 0 ? '+' + (st.ms - stages[i - 1].ms) + ' ms' : '-';
+                } },
+                { title: 'Core', value: st => st.core },
+            ], stages);
+
+            // Only there after a wake from deep sleep found the DAC
+            const deepSleep = status.deep_sleep;
+            document.getElementById('deep-sleep-status').textContent = deepSleep
+                ? 'Waited ' + deepSleep.hours.toFixed(2) + ' h in deep sleep for a DAC: ' + deepSleep.checks
+                    + ' wake stub checks, ' + deepSleep.boots + ' boots, checking every '
+                    + (deepSleep.interval_ms / 1000).toFixed(0) + ' s at the end. Estimated '
+                    + deepSleep.average_ma.toFixed(2) + ' mA on average, '
+                    + deepSleep.full_boot_ma.toFixed(1) + ' mA with a full boot every check.'
+                : '';
+
+            const dacTable = document.getElementById('usb-dac-status');
+            if (dacTable) {
+                document.getElementById('usb-bus-status').textContent =
+                    'Full speed bus in use: ' + status.usb_bus_percent + '%';
+                fillStatusTable(dacTable, [
+                    { title: 'Zone', value: d => d.zone },
+                    { title: 'State', value: d => d.started ? 'Playing' : (d.connected ? 'Connected' : 'Empty') },
+                    { title: 'Channels', value: d => d.channel_pair < 0 ? 'Receiver mix' : (d.channel_pair * 2 + 1) + '-' + (d.channel_pair * 2 + 2) },
+                    { title: 'Format', value: d => d.sample_rate ? d.sample_rate + ' Hz / ' + d.bit_depth + ' bit' : '-' },
+                    { title: 'Bus (B/ms)', value: d => d.bus_bytes_per_ms },
+                    { title: 'CPU', value: d => (d.cpu_permille / 10).toFixed(1) + '%' },
+                ], status.usb_dacs || []);
+            }
+        })
+        .catch(error => {
+            console.error('Error loading status:', error);
+        });
+}
+
+function loadFirStatus() {
+    fetch('/status')
+        .then(response => response.json())
+        .then(status => {
+            const audio = status.audio || {};
+            let text = 'No impulse response loaded';
+            if (audio.fir_taps) {
+                text = audio.fir_taps + ' taps at ' + audio.fir_sample_rate + ' Hz'
+                    + (audio.fir_active ? ', active' : ', waiting for a stream of this rate');
+            }
+            document.getElementById('fir-status').textContent = text;
+        })
+        .catch(error => {
+            console.error('Error loading room correction status:', error);
+        });
+}
+
+function uploadFir() {
+    const file = document.getElementById('fir_file').files[0];
+    if (!file) {
+        return;
+    }
+    fetch('/api/fir', { method: 'POST', body: file })
+        .then(response => response.ok ? null : response.text())
+        .then(error => {
+            if (error) {
+                showSettingsAlert('Upload failed: ' + error);
+            } else {
+                showSettingsSuccess('Impulse response loaded');
+            }
+            loadFirStatus();
+        })
+        .catch(error => {
+            console.error('Error uploading impulse response:', error);
+        });
+}
+
+function removeFir() {
+    fetch('/api/fir', { method: 'DELETE' })
+        .then(() => loadFirStatus())
+        .catch(error => {
+            console.error('Error removing impulse response:', error);
+        });
+}
+
+function setPipelineStage(name, enabled) {
+    fetch('/api/pipeline', {
+        method: 'POST',
+        headers: { 'Content-Type': 'application/json' },
+        body: JSON.stringify({ stage: name, enabled: enabled })
+    })
+        .then(() => loadOutputStatus())
+        .catch(error => {
+            console.error('Error switching pipeline stage:', error);
+        });
+}
+
 function saveSettings(event) {
     event.preventDefault();
     
@@ -112,7 +447,7 @@ function saveSettings(event) {
     // Convert form data to JSON object
     for (let [key, value] of formData.entries()) {
         // Convert numeric values
-        if (!isNaN(value) && key !== 'ap_password') {
+        if (!isNaN(value) && key !== 'ap_password' && key !== 'sender_extra_destinations' && key !== 'sender_destination_name' && key !== 'usb_zone_channels' && key !== 'downmix_matrix' && key !== 'eq_bands') {
             if (key === 'volume') {
                 settings[key] = parseFloat(value);
             } else {
@@ -126,6 +461,10 @@ function saveSettings(event) {
     // Handle checkbox values (checkboxes are only included in formData when checked)
     settings.hide_ap_when_connected = document.getElementById('hide_ap_when_connected').checked;
     settings.use_direct_write = document.getElementById('use_direct_write').checked;
+    settings.enable_spdif_output = document.getElementById('enable_spdif_output').checked;
+    settings.enable_i2s_output = document.getElementById('enable_i2s_output').checked;
+    settings.compressor_enabled = document.getElementById('compressor_enabled').checked;
+    settings.limiter_enabled = document.getElementById('limiter_enabled').checked;
     
     // Handle USB Sender checkbox (only exists in USB mode)
     if (document.getElementById('enable_usb_sender')) {
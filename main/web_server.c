@@ -4,9 +4,17 @@
 #include "config.h"
 #include "bq25895/bq25895_web.h"
 #include "bq25895/bq25895.h"
-
-// External function from audio.c to apply volume changes
-extern void resume_playback(void);
+#include "bq25895_integration.h"
+#include "boot_profile.h"
+#include "deep_sleep.h"
+
+// Volume changes and PCM handler counters from audio.c
+#include "audio.h"
+#include "sink.h"
+#include "channel_map.h"
+#include "eq.h"
+#include "fir.h"
+#include "meter.h"
 
 // External declarations for embedded web files
 extern const uint8_t index_html_start[] asm("_binary_index_html_start");
@@ -44,14 +52,23 @@ const char html_apple_cna[] =
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_netif.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "cJSON.h"
 #include "lwip/dns.h"
 #include <string.h>
+#include <stdio.h>
+#include <unistd.h>
 #include <sys/socket.h>
 #include <netdb.h>
 #include <arpa/inet.h>
 #ifdef IS_USB
 #include "usb/uac_host.h"
+#include "usb_dac.h"
+#include "scream_sender.h"
+#include "mdns_service.h"
 #endif
 
 #define TAG "web_server"
@@ -79,6 +96,10 @@ static esp_err_t bq25895_html_handler(httpd_req_t *req);
 static esp_err_t bq25895_css_handler(httpd_req_t *req);
 static esp_err_t bq25895_js_handler(httpd_req_t *req);
 static esp_err_t bq25895_api_handler(httpd_req_t *req);
+static esp_err_t pipeline_post_handler(httpd_req_t *req);
+static esp_err_t fir_post_handler(httpd_req_t *req);
+static esp_err_t fir_delete_handler(httpd_req_t *req);
+static esp_err_t meters_ws_handler(httpd_req_t *req);
 static void dns_server_task(void *pvParameters);
 
 /**
@@ -618,11 +639,6 @@ extern void enter_deep_sleep_mode(void);
 extern uac_host_device_handle_t s_spk_dev_handle; // DAC handle from usb_audio_player_main.c
 #endif
 
-#ifdef IS_SPDIF
-// Add external declaration for SPDIF functions
-extern esp_err_t spdif_set_sample_rates(int rate);
-#endif
-
 /**
  * POST handler for connecting to a WiFi network
  */
@@ -886,6 +902,249 @@ static esp_err_t status_get_handler(httpd_req_t *req)
         }
     }
 
+#ifdef IS_USB
+    // USB Scream sender counters
+    if (scream_sender_is_running()) {
+        scream_sender_stats_t stats;
+        scream_sender_format_t format;
+        scream_sender_get_stats(&stats);
+        scream_sender_get_format(&format);
+        cJSON *sender = cJSON_AddObjectToObject(root, "sender");
+        cJSON_AddNumberToObject(sender, "sample_rate", format.sample_rate);
+        cJSON_AddNumberToObject(sender, "bit_depth", format.bit_depth);
+        cJSON_AddNumberToObject(sender, "channels", format.channels);
+        cJSON_AddNumberToObject(sender, "packets_sent", stats.packets_sent);
+        cJSON_AddNumberToObject(sender, "send_failures", stats.send_failures);
+        cJSON_AddNumberToObject(sender, "ring_drops", stats.ring_drops);
+        cJSON_AddNumberToObject(sender, "underruns", stats.underruns);
+        cJSON_AddNumberToObject(sender, "max_callback_us", stats.max_callback_us);
+        cJSON_AddNumberToObject(sender, "max_send_jitter_us", stats.max_send_jitter_us);
+        cJSON_AddNumberToObject(sender, "avg_send_jitter_us", stats.avg_send_jitter_us);
+        cJSON_AddNumberToObject(sender, "ring_fill_bytes", stats.ring_fill_bytes);
+        cJSON_AddNumberToObject(sender, "volume_events", stats.volume_events);
+        cJSON_AddNumberToObject(sender, "max_volume_cb_us", stats.max_volume_cb_us);
+        cJSON_AddBoolToObject(sender, "multicast", stats.multicast);
+        cJSON_AddNumberToObject(sender, "max_send_cost_us", stats.max_send_cost_us);
+        cJSON_AddNumberToObject(sender, "avg_send_cost_us", stats.avg_send_cost_us);
+
+        scream_sender_dest_stats_t dests[SCREAM_SENDER_MAX_DESTINATIONS];
+        int dest_count = scream_sender_get_destinations(dests, SCREAM_SENDER_MAX_DESTINATIONS);
+        cJSON *dest_array = cJSON_AddArrayToObject(sender, "destinations");
+        for (int i = 0; i < dest_count; i++) {
+            char ip_str[16];
+            struct in_addr addr = { .s_addr = dests[i].addr };
+            inet_ntoa_r(addr, ip_str, sizeof(ip_str));
+            cJSON *dest = cJSON_CreateObject();
+            cJSON_AddStringToObject(dest, "ip", ip_str);
+            cJSON_AddNumberToObject(dest, "port", dests[i].port);
+            cJSON_AddNumberToObject(dest, "packets_sent", dests[i].packets_sent);
+            cJSON_AddNumberToObject(dest, "send_failures", dests[i].send_failures);
+            cJSON_AddItemToArray(dest_array, dest);
+        }
+    }
+
+    // Receivers discovered over mDNS
+    mdns_receiver_t receivers[MDNS_MAX_RECEIVERS];
+    int receiver_count = mdns_service_get_receivers(receivers, MDNS_MAX_RECEIVERS);
+    cJSON *receiver_array = cJSON_AddArrayToObject(root, "receivers");
+    for (int i = 0; i < receiver_count; i++) {
+        char ip_str[16];
+        struct in_addr addr = { .s_addr = receivers[i].ip };
+        inet_ntoa_r(addr, ip_str, sizeof(ip_str));
+        cJSON *receiver = cJSON_CreateObject();
+        cJSON_AddStringToObject(receiver, "name", receivers[i].instance_name);
+        cJSON_AddStringToObject(receiver, "hostname", receivers[i].hostname);
+        cJSON_AddStringToObject(receiver, "ip", ip_str);
+        cJSON_AddNumberToObject(receiver, "port", receivers[i].port);
+        cJSON_AddNumberToObject(receiver, "sample_rate", receivers[i].sample_rate);
+        cJSON_AddNumberToObject(receiver, "bit_depth", receivers[i].bit_depth);
+        cJSON_AddNumberToObject(receiver, "channels", receivers[i].channels);
+        cJSON_AddNumberToObject(receiver, "latency_ms", receivers[i].latency_ms);
+        cJSON_AddNumberToObject(receiver, "ttl", receivers[i].ttl_remaining_s);
+        cJSON_AddItemToArray(receiver_array, receiver);
+    }
+#endif
+
+    // PCM handler counters
+    audio_stats_t audio_stats;
+    audio_get_stats(&audio_stats);
+    cJSON *audio = cJSON_AddObjectToObject(root, "audio");
+    cJSON_AddNumberToObject(audio, "wakeups", audio_stats.wakeups);
+    cJSON_AddNumberToObject(audio, "idle_wakeups", audio_stats.idle_wakeups);
+    cJSON_AddNumberToObject(audio, "chunks_written", audio_stats.chunks_written);
+    cJSON_AddNumberToObject(audio, "sink_full", audio_stats.sink_full);
+    cJSON_AddNumberToObject(audio, "run_time", audio_stats.run_time);
+    cJSON_AddNumberToObject(audio, "write_timeouts", audio_stats.write_timeouts);
+    cJSON_AddNumberToObject(audio, "latency_last_us", audio_stats.latency_last_us);
+    cJSON_AddNumberToObject(audio, "latency_avg_us", audio_stats.latency_avg_us);
+    cJSON_AddNumberToObject(audio, "latency_max_us", audio_stats.latency_max_us);
+    cJSON_AddNumberToObject(audio, "replugs", audio_stats.replugs);
+    cJSON_AddNumberToObject(audio, "time_to_first_sample_us", audio_stats.time_to_first_sample_us);
+    cJSON_AddNumberToObject(audio, "replug_gap_ms", audio_stats.replug_gap_ms);
+    cJSON_AddNumberToObject(audio, "dac_sample_rate", audio_stats.dac_sample_rate);
+    cJSON_AddNumberToObject(audio, "dac_bit_depth", audio_stats.dac_bit_depth);
+    cJSON_AddNumberToObject(audio, "converter_avg_cycles", audio_stats.converter_avg_cycles);
+    cJSON_AddNumberToObject(audio, "converter_max_cycles", audio_stats.converter_max_cycles);
+    cJSON_AddNumberToObject(audio, "stream_sample_rate", audio_stats.stream_sample_rate);
+    cJSON_AddNumberToObject(audio, "stream_bit_depth", audio_stats.stream_bit_depth);
+    cJSON_AddNumberToObject(audio, "stream_channels", audio_stats.stream_channels);
+    cJSON_AddNumberToObject(audio, "stream_channel_mask", audio_stats.stream_channel_mask);
+    cJSON_AddNumberToObject(audio, "lanes", audio_stats.lanes);
+    cJSON_AddNumberToObject(audio, "bad_headers", audio_stats.bad_headers);
+    cJSON_AddNumberToObject(audio, "channel_map_avg_cycles", audio_stats.channel_map_avg_cycles);
+    cJSON_AddNumberToObject(audio, "channel_map_max_cycles", audio_stats.channel_map_max_cycles);
+    cJSON_AddNumberToObject(audio, "fir_taps", audio_stats.fir_taps);
+    cJSON_AddNumberToObject(audio, "fir_sample_rate", audio_stats.fir_sample_rate);
+    cJSON_AddBoolToObject(audio, "fir_active", audio_stats.fir_active);
+    cJSON_AddNumberToObject(audio, "gain_reduction_db", audio_stats.gain_reduction_db);
+    cJSON_AddNumberToObject(audio, "gain_reduction_peak_db", audio_stats.gain_reduction_peak_db);
+    cJSON_AddNumberToObject(audio, "silent_chunks", audio_stats.silent_chunks);
+    cJSON_AddNumberToObject(audio, "silence_max_cycles", audio_stats.silence_max_cycles);
+    cJSON_AddNumberToObject(audio, "silence_sleeps", audio_stats.silence_sleeps);
+    cJSON_AddNumberToObject(audio, "wakes", audio_stats.wakes);
+    cJSON_AddNumberToObject(audio, "wake_dac_start_us", audio_stats.wake_dac_start_us);
+    cJSON_AddNumberToObject(audio, "wake_to_sound_us", audio_stats.wake_to_sound_us);
+    cJSON_AddNumberToObject(audio, "uptime_us", esp_timer_get_time());
+
+    // Energy silence sleep saves, estimated from the charger's ADC
+    bq25895_energy_report_t energy;
+    bq25895_integration_get_energy_report(&energy);
+    cJSON *power = cJSON_AddObjectToObject(root, "power");
+    cJSON_AddBoolToObject(power, "valid", energy.valid);
+    cJSON_AddBoolToObject(power, "estimate", true);
+    cJSON_AddStringToObject(power, "measures",
+                            "battery charge current in 50 mA steps, sampled on USB input at its current limit");
+    cJSON_AddNumberToObject(power, "awake_idle_mw", energy.awake_idle_mw);
+    cJSON_AddNumberToObject(power, "sleep_mw", energy.sleep_mw);
+    cJSON_AddNumberToObject(power, "saved_mwh_per_idle_hour", energy.saved_mwh_per_idle_hour);
+    cJSON_AddNumberToObject(power, "sleep_hours", energy.sleep_hours);
+    cJSON_AddNumberToObject(power, "saved_mwh", energy.saved_mwh);
+    cJSON_AddStringToObject(power, "mode", power_mode_name(power_get_mode()));
+    cJSON *modes = cJSON_AddArrayToObject(power, "modes");
+    for (int mode = 0; mode < POWER_MODE_COUNT; mode++) {
+        cJSON *entry = cJSON_CreateObject();
+        cJSON_AddStringToObject(entry, "name", power_mode_name(mode));
+        cJSON_AddNumberToObject(entry, "samples", energy.modes[mode].samples);
+        cJSON_AddNumberToObject(entry, "charge_ma", energy.modes[mode].charge_ma);
+        cJSON_AddNumberToObject(entry, "extra_ma", energy.modes[mode].extra_ma);
+        cJSON_AddNumberToObject(entry, "delivery_delay_avg_us", audio_stats.delivery_delay_avg_us[mode]);
+        cJSON_AddNumberToObject(entry, "delivery_delay_max_us", audio_stats.delivery_delay_max_us[mode]);
+        cJSON_AddItemToArray(modes, entry);
+    }
+
+    // Boot connection, with or without the cached access point and lease, and when each init step finished
+    wifi_connect_timing_t connect_timing;
+    wifi_manager_get_connect_timing(&connect_timing);
+    cJSON *boot = cJSON_AddObjectToObject(root, "boot");
+    cJSON_AddBoolToObject(boot, "fast_connect", connect_timing.fast);
+    cJSON_AddBoolToObject(boot, "static_lease", connect_timing.static_lease);
+    cJSON_AddNumberToObject(boot, "fast_connect_failures", connect_timing.fast_failures);
+    cJSON_AddNumberToObject(boot, "associated_ms", connect_timing.associated_ms);
+    cJSON_AddNumberToObject(boot, "got_ip_ms", connect_timing.got_ip_ms);
+    cJSON_AddNumberToObject(boot, "first_audio_ms", audio_stats.boot_to_first_audio_ms);
+    boot_stage_t stages[BOOT_PROFILE_MAX_STAGES];
+    size_t stage_count = boot_profile_get(stages, BOOT_PROFILE_MAX_STAGES);
+    cJSON *stages_json = cJSON_AddArrayToObject(boot, "stages");
+    for (size_t i = 0; i < stage_count; i++) {
+        cJSON *entry = cJSON_CreateObject();
+        cJSON_AddStringToObject(entry, "name", stages[i].name);
+        cJSON_AddNumberToObject(entry, "ms", stages[i].at_ms);
+        cJSON_AddNumberToObject(entry, "core", stages[i].core);
+        cJSON_AddItemToArray(stages_json, entry);
+    }
+
+    // Last wait for a DAC in deep sleep, and what waking with a full boot every check would have cost
+    deep_sleep_report_t deep_sleep;
+    deep_sleep_get_report(&deep_sleep);
+    if (deep_sleep.valid) {
+        cJSON *deep_sleep_json = cJSON_AddObjectToObject(root, "deep_sleep");
+        cJSON_AddNumberToObject(deep_sleep_json, "hours", deep_sleep.hours);
+        cJSON_AddNumberToObject(deep_sleep_json, "checks", deep_sleep.checks);
+        cJSON_AddNumberToObject(deep_sleep_json, "boots", deep_sleep.boots);
+        cJSON_AddNumberToObject(deep_sleep_json, "interval_ms", deep_sleep.interval_ms);
+        cJSON_AddNumberToObject(deep_sleep_json, "average_ma", deep_sleep.average_ma);
+        cJSON_AddNumberToObject(deep_sleep_json, "full_boot_ma", deep_sleep.full_boot_ma);
+    }
+
+    // Wi-Fi power save policy
+    power_wifi_status_t wifi_ps;
+    power_get_wifi_status(&wifi_ps);
+    cJSON *wifi_ps_json = cJSON_AddObjectToObject(root, "wifi_ps");
+    cJSON_AddStringToObject(wifi_ps_json, "mode", wifi_ps.mode);
+    cJSON_AddNumberToObject(wifi_ps_json, "jitter_us", wifi_ps.jitter_us);
+    cJSON_AddNumberToObject(wifi_ps_json, "low_water", wifi_ps.low_water);
+    cJSON_AddNumberToObject(wifi_ps_json, "switches", wifi_ps.switches);
+    cJSON_AddNumberToObject(wifi_ps_json, "hold_s", wifi_ps.hold_s);
+    cJSON_AddNumberToObject(wifi_ps_json, "none_seconds", wifi_ps.none_seconds);
+    cJSON_AddNumberToObject(wifi_ps_json, "extra_ma", wifi_ps.extra_ma);
+    cJSON_AddNumberToObject(wifi_ps_json, "average_extra_ma", wifi_ps.average_extra_ma);
+
+    // Per output counters
+    sink_stats_t sinks[SINK_MAX];
+    int sink_count = sink_get_stats(sinks, SINK_MAX);
+    cJSON *sink_array = cJSON_AddArrayToObject(root, "sinks");
+    for (int i = 0; i < sink_count; i++) {
+        cJSON *sink = cJSON_CreateObject();
+        cJSON_AddStringToObject(sink, "name", sinks[i].name);
+        cJSON_AddBoolToObject(sink, "primary", sinks[i].primary);
+        cJSON_AddNumberToObject(sink, "queued", sinks[i].queued);
+        cJSON_AddNumberToObject(sink, "written", sinks[i].written);
+        cJSON_AddNumberToObject(sink, "dropped", sinks[i].dropped);
+        cJSON_AddNumberToObject(sink, "stalls", sinks[i].stalls);
+        cJSON_AddNumberToObject(sink, "queue_depth", sinks[i].queue_depth);
+        cJSON_AddNumberToObject(sink, "latency_last_us", sinks[i].latency_last_us);
+        cJSON_AddNumberToObject(sink, "latency_avg_us", sinks[i].latency_avg_us);
+        cJSON_AddNumberToObject(sink, "latency_max_us", sinks[i].latency_max_us);
+        cJSON_AddItemToArray(sink_array, sink);
+    }
+
+    // Per stage cost of the processing pipeline
+    pipeline_stage_stats_t stages[PIPELINE_MAX_STAGES];
+    int stage_count = audio_get_pipeline_stats(stages, PIPELINE_MAX_STAGES);
+    cJSON *stage_array = cJSON_AddArrayToObject(root, "pipeline");
+    for (int i = 0; i < stage_count; i++) {
+        cJSON *stage = cJSON_CreateObject();
+        cJSON_AddStringToObject(stage, "name", stages[i].name);
+        cJSON_AddBoolToObject(stage, "enabled", stages[i].enabled);
+        cJSON_AddNumberToObject(stage, "runs", stages[i].runs);
+        cJSON_AddNumberToObject(stage, "avg_cycles", stages[i].avg_cycles);
+        cJSON_AddNumberToObject(stage, "max_cycles", stages[i].max_cycles);
+        cJSON_AddItemToArray(stage_array, stage);
+    }
+
+#ifdef IS_USB
+    // Per zone USB DAC state and the share of the full speed bus they take
+    usb_dac_info_t dacs[USB_DAC_MAX];
+    int dac_count = usb_dac_get_info(dacs, USB_DAC_MAX);
+    uint32_t bus_bytes_per_ms = 0;
+    cJSON *dac_array = cJSON_AddArrayToObject(root, "usb_dacs");
+    for (int i = 0; i < dac_count; i++) {
+        cJSON *dac = cJSON_CreateObject();
+        cJSON_AddNumberToObject(dac, "zone", i);
+        cJSON_AddBoolToObject(dac, "connected", dacs[i].connected);
+        cJSON_AddBoolToObject(dac, "started", dacs[i].started);
+        cJSON_AddNumberToObject(dac, "channel_pair", dacs[i].channel_pair);
+        cJSON_AddNumberToObject(dac, "sample_rate", dacs[i].sample_rate);
+        cJSON_AddNumberToObject(dac, "bit_depth", dacs[i].bit_depth);
+        cJSON_AddBoolToObject(dac, "converting", dacs[i].converting);
+        cJSON_AddNumberToObject(dac, "bus_bytes_per_ms", dacs[i].bus_bytes_per_ms);
+        cJSON_AddNumberToObject(dac, "prepare_avg_us", dacs[i].prepare_avg_us);
+        cJSON_AddNumberToObject(dac, "prepare_max_us", dacs[i].prepare_max_us);
+        cJSON_AddNumberToObject(dac, "cpu_permille", dacs[i].cpu_permille);
+        cJSON_AddItemToArray(dac_array, dac);
+        bus_bytes_per_ms += dacs[i].bus_bytes_per_ms;
+    }
+    cJSON_AddNumberToObject(root, "usb_bus_percent", bus_bytes_per_ms * 100 / USB_FS_PERIODIC_BYTES_PER_MS);
+#endif
+
+    // NVS write counters
+    config_write_stats_t write_stats;
+    config_manager_get_write_stats(&write_stats);
+    cJSON *nvs = cJSON_AddObjectToObject(root, "nvs");
+    cJSON_AddNumberToObject(nvs, "commits", write_stats.nvs_commits);
+    cJSON_AddNumberToObject(nvs, "deferred_updates", write_stats.deferred_updates);
+    cJSON_AddNumberToObject(nvs, "coalesced_updates", write_stats.coalesced_updates);
+
     // Convert JSON to string
     char *json_str = cJSON_Print(root);
     if (!json_str) {
@@ -940,20 +1199,43 @@ static esp_err_t settings_get_handler(httpd_req_t *req)
     cJSON_AddNumberToObject(root, "sample_rate", config->sample_rate);
     cJSON_AddNumberToObject(root, "bit_depth", config->bit_depth);
     cJSON_AddNumberToObject(root, "volume", config->volume);
-
-    // SPDIF settings (only relevant when IS_SPDIF is defined)
-#ifdef IS_SPDIF
+    cJSON_AddNumberToObject(root, "channel_mode", config->channel_mode);
+    cJSON_AddNumberToObject(root, "channel_select", config->channel_select);
+    cJSON_AddStringToObject(root, "downmix_matrix", config->downmix_matrix);
+    cJSON_AddStringToObject(root, "eq_bands", config->eq_bands);
+    cJSON_AddBoolToObject(root, "compressor_enabled", config->compressor_enabled);
+    cJSON_AddNumberToObject(root, "compressor_threshold_db", config->compressor_threshold_db);
+    cJSON_AddNumberToObject(root, "compressor_ratio", config->compressor_ratio);
+    cJSON_AddNumberToObject(root, "compressor_attack_ms", config->compressor_attack_ms);
+    cJSON_AddNumberToObject(root, "compressor_release_ms", config->compressor_release_ms);
+    cJSON_AddNumberToObject(root, "compressor_makeup_db", config->compressor_makeup_db);
+    cJSON_AddBoolToObject(root, "limiter_enabled", config->limiter_enabled);
+    cJSON_AddNumberToObject(root, "limiter_ceiling_db", config->limiter_ceiling_db);
+    cJSON_AddNumberToObject(root, "lookahead_ms", config->lookahead_ms);
+
+    // Output settings
     cJSON_AddNumberToObject(root, "spdif_data_pin", config->spdif_data_pin);
-#endif
+    cJSON_AddBoolToObject(root, "enable_spdif_output", config->enable_spdif_output);
+    cJSON_AddBoolToObject(root, "enable_i2s_output", config->enable_i2s_output);
+    cJSON_AddNumberToObject(root, "i2s_bck_pin", config->i2s_bck_pin);
+    cJSON_AddNumberToObject(root, "i2s_ws_pin", config->i2s_ws_pin);
+    cJSON_AddNumberToObject(root, "i2s_data_pin", config->i2s_data_pin);
 
     // USB Scream Sender settings
     cJSON_AddBoolToObject(root, "enable_usb_sender", config->enable_usb_sender);
     cJSON_AddStringToObject(root, "sender_destination_ip", config->sender_destination_ip);
     cJSON_AddNumberToObject(root, "sender_destination_port", config->sender_destination_port);
+    cJSON_AddStringToObject(root, "sender_extra_destinations", config->sender_extra_destinations);
+    cJSON_AddStringToObject(root, "sender_destination_name", config->sender_destination_name);
     
     // WiFi roaming settings
     cJSON_AddNumberToObject(root, "rssi_threshold", config->rssi_threshold);
 
+    // USB DAC buffering settings
+    cJSON_AddNumberToObject(root, "usb_buffer_chunks", config->usb_buffer_chunks);
+    cJSON_AddNumberToObject(root, "usb_threshold_chunks", config->usb_threshold_chunks);
+    cJSON_AddStringToObject(root, "usb_zone_channels", config->usb_zone_channels);
+
     // Sleep settings
     cJSON_AddNumberToObject(root, "silence_threshold_ms", config->silence_threshold_ms);
     cJSON_AddNumberToObject(root, "network_check_interval_ms", config->network_check_interval_ms);
@@ -982,6 +1264,23 @@ static esp_err_t settings_get_handler(httpd_req_t *req)
     return ret;
 }
 
+/**
+ * Read an integer setting, false if it is missing or outside min to max
+ */
+static bool get_int_setting(cJSON *root, const char *name, int min, int max, int *value)
+{
+    cJSON *item = cJSON_GetObjectItem(root, name);
+    if (!item || !cJSON_IsNumber(item)) {
+        return false;
+    }
+    if (item->valueint < min || item->valueint > max) {
+        ESP_LOGW(TAG, "Invalid %s: %d (must be %d to %d)", name, item->valueint, min, max);
+        return false;
+    }
+    *value = item->valueint;
+    return true;
+}
+
 /**
  * POST handler for updating device settings
  */
@@ -1123,6 +1422,96 @@ static esp_err_t settings_post_handler(httpd_req_t *req)
         volume_changed = (old_volume != config->volume);
     }
 
+    // Channel selection, applied from the next packet
+    bool channel_map_changed = false;
+    cJSON *channel_mode = cJSON_GetObjectItem(root, "channel_mode");
+    if (channel_mode && cJSON_IsNumber(channel_mode)) {
+        int mode = channel_mode->valueint;
+        if (mode >= CHANNEL_MAP_PAIR && mode <= CHANNEL_MAP_DOWNMIX) {
+            channel_map_changed |= config->channel_mode != mode;
+            config->channel_mode = (uint8_t)mode;
+        } else {
+            ESP_LOGW(TAG, "Invalid channel mode: %d (must be 0-2)", mode);
+        }
+    }
+
+    cJSON *channel_select = cJSON_GetObjectItem(root, "channel_select");
+    if (channel_select && cJSON_IsNumber(channel_select)) {
+        int select = channel_select->valueint;
+        if (select >= 0 && select < SCREAM_MAX_CHANNELS) {
+            channel_map_changed |= config->channel_select != select;
+            config->channel_select = (uint8_t)select;
+        } else {
+            ESP_LOGW(TAG, "Invalid channel select: %d (must be 0-%d)", select, SCREAM_MAX_CHANNELS - 1);
+        }
+    }
+
+    cJSON *downmix_matrix = cJSON_GetObjectItem(root, "downmix_matrix");
+    if (downmix_matrix && cJSON_IsString(downmix_matrix)) {
+        const char *text = downmix_matrix->valuestring;
+        int16_t matrix[2][SCREAM_MAX_CHANNELS];
+        if (strlen(text) <= DOWNMIX_MATRIX_MAX_LENGTH && (text[0] == '\0' || channel_map_parse_matrix(text, matrix))) {
+            channel_map_changed |= strcmp(config->downmix_matrix, text) != 0;
+            strcpy(config->downmix_matrix, text);
+        } else {
+            ESP_LOGW(TAG, "Invalid downmix matrix: %s", text);
+        }
+    }
+
+    bool eq_changed = false;
+    cJSON *eq_bands = cJSON_GetObjectItem(root, "eq_bands");
+    if (eq_bands && cJSON_IsString(eq_bands)) {
+        const char *text = eq_bands->valuestring;
+        eq_band_t bands[EQ_MAX_BANDS];
+        if (strlen(text) <= EQ_BANDS_MAX_LENGTH && eq_parse_bands(text, bands, EQ_MAX_BANDS) >= 0) {
+            eq_changed = strcmp(config->eq_bands, text) != 0;
+            strcpy(config->eq_bands, text);
+        } else {
+            ESP_LOGW(TAG, "Invalid EQ bands: %s", text);
+        }
+    }
+
+    // Compressor and limiter
+    bool dynamics_changed = false;
+    const char *dynamics_flag_names[] = { "compressor_enabled", "limiter_enabled" };
+    bool *dynamics_flags[] = { &config->compressor_enabled, &config->limiter_enabled };
+    for (int i = 0; i < 2; i++) {
+        cJSON *flag = cJSON_GetObjectItem(root, dynamics_flag_names[i]);
+        if (flag && cJSON_IsBool(flag)) {
+            dynamics_changed |= *dynamics_flags[i] != cJSON_IsTrue(flag);
+            *dynamics_flags[i] = cJSON_IsTrue(flag);
+        }
+    }
+    int value;
+    if (get_int_setting(root, "compressor_threshold_db", -60, 0, &value)) {
+        dynamics_changed |= value != config->compressor_threshold_db;
+        config->compressor_threshold_db = (int8_t)value;
+    }
+    if (get_int_setting(root, "compressor_ratio", 1, 20, &value)) {
+        dynamics_changed |= value != config->compressor_ratio;
+        config->compressor_ratio = (uint8_t)value;
+    }
+    if (get_int_setting(root, "compressor_attack_ms", 1, 200, &value)) {
+        dynamics_changed |= value != config->compressor_attack_ms;
+        config->compressor_attack_ms = (uint8_t)value;
+    }
+    if (get_int_setting(root, "compressor_release_ms", 10, 2000, &value)) {
+        dynamics_changed |= value != config->compressor_release_ms;
+        config->compressor_release_ms = (uint16_t)value;
+    }
+    if (get_int_setting(root, "compressor_makeup_db", 0, 18, &value)) {
+        dynamics_changed |= value != config->compressor_makeup_db;
+        config->compressor_makeup_db = (uint8_t)value;
+    }
+    if (get_int_setting(root, "limiter_ceiling_db", -20, 0, &value)) {
+        dynamics_changed |= value != config->limiter_ceiling_db;
+        config->limiter_ceiling_db = (int8_t)value;
+    }
+    if (get_int_setting(root, "lookahead_ms", 1, 5, &value)) {
+        dynamics_changed |= value != config->lookahead_ms;
+        config->lookahead_ms = (uint8_t)value;
+    }
+
     // Sleep settings
     cJSON *silence_threshold_ms = cJSON_GetObjectItem(root, "silence_threshold_ms");
     if (silence_threshold_ms && cJSON_IsNumber(silence_threshold_ms)) {
@@ -1171,51 +1560,55 @@ static esp_err_t settings_post_handler(httpd_req_t *req)
         ESP_LOGI(TAG, "Updating sender destination port to: %d", config->sender_destination_port);
     }
 
-    // SPDIF settings
-#ifdef IS_SPDIF
-    bool spdif_pin_changed = false;
-    uint8_t old_spdif_pin = config->spdif_data_pin;
+    cJSON *sender_extra_destinations = cJSON_GetObjectItem(root, "sender_extra_destinations");
+    if (sender_extra_destinations && cJSON_IsString(sender_extra_destinations)) {
+        strncpy(config->sender_extra_destinations, sender_extra_destinations->valuestring, SENDER_EXTRA_DESTINATIONS_MAX_LENGTH);
+        config->sender_extra_destinations[SENDER_EXTRA_DESTINATIONS_MAX_LENGTH] = '\0'; // Ensure null termination
+        ESP_LOGI(TAG, "Updating sender extra destinations to: %s", config->sender_extra_destinations);
+    }
 
+    cJSON *sender_destination_name = cJSON_GetObjectItem(root, "sender_destination_name");
+    if (sender_destination_name && cJSON_IsString(sender_destination_name)) {
+        strncpy(config->sender_destination_name, sender_destination_name->valuestring, SENDER_DESTINATION_NAME_MAX_LENGTH);
+        config->sender_destination_name[SENDER_DESTINATION_NAME_MAX_LENGTH] = '\0'; // Ensure null termination
+        ESP_LOGI(TAG, "Updating sender destination name to: %s", config->sender_destination_name);
+    }
+
+    // Output settings, outputs are enabled at boot so the switches apply after a restart
+    bool spdif_pin_changed = false;
     cJSON *spdif_data_pin = cJSON_GetObjectItem(root, "spdif_data_pin");
     if (spdif_data_pin && cJSON_IsNumber(spdif_data_pin)) {
         // Limit the pin number to valid GPIO range (0-39 for ESP32)
         uint8_t pin = (uint8_t)spdif_data_pin->valueint;
-        if (pin <= 39) {
-            if (pin != config->spdif_data_pin) {
-                spdif_pin_changed = true;
-                config->spdif_data_pin = pin;
-                ESP_LOGI(TAG, "SPDIF pin changed from %d to %d", old_spdif_pin, pin);
-            }
+        if (pin <= 39 && pin != config->spdif_data_pin) {
+            ESP_LOGI(TAG, "SPDIF pin changed from %d to %d", config->spdif_data_pin, pin);
+            config->spdif_data_pin = pin;
+            spdif_pin_changed = true;
         }
     }
-#endif
 
-    // Free the JSON object
-    cJSON_Delete(root);
+    cJSON *enable_spdif_output = cJSON_GetObjectItem(root, "enable_spdif_output");
+    if (enable_spdif_output && cJSON_IsBool(enable_spdif_output)) {
+        config->enable_spdif_output = cJSON_IsTrue(enable_spdif_output);
+    }
 
-    // Save the configuration to NVS
-    esp_err_t err = config_manager_save_config();
-    if (err != ESP_OK) {
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to save configuration");
-        return ESP_FAIL;
+    cJSON *enable_i2s_output = cJSON_GetObjectItem(root, "enable_i2s_output");
+    if (enable_i2s_output && cJSON_IsBool(enable_i2s_output)) {
+        config->enable_i2s_output = cJSON_IsTrue(enable_i2s_output);
     }
 
-    // Apply SPDIF changes if needed
-#ifdef IS_SPDIF
-    if (spdif_pin_changed || sample_rate_changed) {
-        ESP_LOGI(TAG, "SPDIF configuration changed, reinitializing SPDIF with pin %d and sample rate %" PRIu32,
-                config->spdif_data_pin, config->sample_rate);
-
-        // Reinitialize SPDIF with the new settings
-        esp_err_t spdif_err = spdif_set_sample_rates(config->sample_rate);
-        if (spdif_err != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to reinitialize SPDIF: %s", esp_err_to_name(spdif_err));
-            // Continue anyway - the user can retry or use different settings later
-        } else {
-            ESP_LOGI(TAG, "Successfully reinitialized SPDIF");
+    const char *i2s_pin_names[] = { "i2s_bck_pin", "i2s_ws_pin", "i2s_data_pin" };
+    uint8_t *i2s_pins[] = { &config->i2s_bck_pin, &config->i2s_ws_pin, &config->i2s_data_pin };
+    for (int i = 0; i < 3; i++) {
+        cJSON *pin = cJSON_GetObjectItem(root, i2s_pin_names[i]);
+        if (pin && cJSON_IsNumber(pin)) {
+            if (pin->valueint >= 0 && pin->valueint <= 48) {
+                *i2s_pins[i] = (uint8_t)pin->valueint;
+            } else {
+                ESP_LOGW(TAG, "Invalid %s: %d (must be 0-48)", i2s_pin_names[i], pin->valueint);
+            }
         }
     }
-#endif
 
     // WiFi roaming settings
     cJSON *rssi_threshold = cJSON_GetObjectItem(root, "rssi_threshold");
@@ -1232,10 +1625,73 @@ static esp_err_t settings_post_handler(httpd_req_t *req)
         }
     }
     
+    // USB DAC buffering, takes effect the next time the DAC is opened
+    cJSON *usb_buffer_chunks = cJSON_GetObjectItem(root, "usb_buffer_chunks");
+    if (usb_buffer_chunks && cJSON_IsNumber(usb_buffer_chunks)) {
+        int chunks = usb_buffer_chunks->valueint;
+        if (chunks >= 2 && chunks <= 16) {
+            config->usb_buffer_chunks = (uint8_t)chunks;
+        } else {
+            ESP_LOGW(TAG, "Invalid USB buffer chunks: %d (must be 2-16)", chunks);
+        }
+    }
+
+    cJSON *usb_threshold_chunks = cJSON_GetObjectItem(root, "usb_threshold_chunks");
+    if (usb_threshold_chunks && cJSON_IsNumber(usb_threshold_chunks)) {
+        int chunks = usb_threshold_chunks->valueint;
+        if (chunks >= 1 && chunks < config->usb_buffer_chunks) {
+            config->usb_threshold_chunks = (uint8_t)chunks;
+        } else {
+            ESP_LOGW(TAG, "Invalid USB threshold chunks: %d (must be 1 to buffer chunks - 1)", chunks);
+        }
+    }
+
+    cJSON *usb_zone_channels = cJSON_GetObjectItem(root, "usb_zone_channels");
+    if (usb_zone_channels && cJSON_IsString(usb_zone_channels)) {
+        const char *value = usb_zone_channels->valuestring;
+        bool valid = strlen(value) <= USB_ZONE_CHANNELS_MAX_LENGTH;
+        for (const char *p = value; valid && *p; p++) {
+            valid = (*p >= '0' && *p <= '3') || *p == ',' || *p == ' ';
+        }
+        if (valid) {
+            strcpy(config->usb_zone_channels, value);
+            ESP_LOGI(TAG, "Updating USB zone channels to: %s", config->usb_zone_channels);
+        } else {
+            ESP_LOGW(TAG, "Invalid USB zone channels: %s (comma separated pairs 0-3)", value);
+        }
+    }
+    
+    // Free the JSON object
+    cJSON_Delete(root);
+
+    // Save the configuration to NVS
+    esp_err_t err = config_manager_save_config();
+    if (err != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to save configuration");
+        return ESP_FAIL;
+    }
+
+    // Apply sample rate changes to the S/PDIF and I2S outputs, S/PDIF also picks up its pin
+    if (sample_rate_changed || spdif_pin_changed) {
+        audio_set_sample_rate(config->sample_rate);
+    }
+
+    if (channel_map_changed) {
+        audio_update_channel_map();
+    }
+
+    if (eq_changed) {
+        audio_update_eq();
+    }
+
+    if (dynamics_changed) {
+        audio_update_dynamics();
+    }
+
     // Apply volume changes immediately if volume was changed
     if (volume_changed) {
         ESP_LOGI(TAG, "Volume changed, applying immediately");
-        resume_playback();
+        audio_set_volume(config->volume);
     }
 
     // Send success response
@@ -1245,6 +1701,307 @@ static esp_err_t settings_post_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+/**
+ * POST handler switching a pipeline stage on or off, takes {"stage":"gain","enabled":false}.
+ * Not saved, every stage is back to its default after a restart.
+ */
+static esp_err_t pipeline_post_handler(httpd_req_t *req)
+{
+    ESP_LOGI(TAG, "Handling POST request for /api/pipeline");
+
+    size_t content_len = req->content_len;
+    if (content_len >= 256) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Content too long");
+        return ESP_FAIL;
+    }
+
+    char buf[256];
+    int ret = httpd_req_recv(req, buf, content_len);
+    if (ret <= 0) {
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            httpd_resp_send_408(req);
+        }
+        return ESP_FAIL;
+    }
+    buf[content_len] = '\0';
+
+    cJSON *root = cJSON_Parse(buf);
+    if (!root) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        return ESP_FAIL;
+    }
+
+    cJSON *stage = cJSON_GetObjectItem(root, "stage");
+    cJSON *enabled = cJSON_GetObjectItem(root, "enabled");
+    if (!cJSON_IsString(stage) || !cJSON_IsBool(enabled)) {
+        cJSON_Delete(root);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Expected stage and enabled");
+        return ESP_FAIL;
+    }
+
+    bool found = audio_set_stage_enabled(stage->valuestring, cJSON_IsTrue(enabled));
+    cJSON_Delete(root);
+    if (!found) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No such stage");
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, "{\"status\":\"ok\"}");
+    return ESP_OK;
+}
+
+// Upload lands here first so a bad file never replaces the working response
+#define FIR_UPLOAD_PATH "/storage/fir.tmp"
+// Largest upload, a stereo 32-bit response of FIR_MAX_TAPS plus room for the header chunks
+#define FIR_UPLOAD_MAX_BYTES (FIR_MAX_TAPS * 8 + 4096)
+
+/**
+ * POST handler for a room correction impulse response, the body is the WAV file.
+ * The file is streamed to the storage partition and only kept if it loads.
+ */
+static esp_err_t fir_post_handler(httpd_req_t *req)
+{
+    ESP_LOGI(TAG, "Handling POST request for /api/fir (%u bytes)", (unsigned)req->content_len);
+
+    if (req->content_len == 0 || req->content_len > FIR_UPLOAD_MAX_BYTES) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Impulse response too long");
+        return ESP_FAIL;
+    }
+
+    FILE *file = fopen(FIR_UPLOAD_PATH, "wb");
+    if (!file) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Storage partition not available");
+        return ESP_FAIL;
+    }
+
+    char buf[1024];
+    size_t remaining = req->content_len;
+    while (remaining > 0) {
+        int ret = httpd_req_recv(req, buf, remaining < sizeof(buf) ? remaining : sizeof(buf));
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        }
+        if (ret <= 0 || fwrite(buf, 1, ret, file) != (size_t)ret) {
+            fclose(file);
+            unlink(FIR_UPLOAD_PATH);
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to store impulse response");
+            return ESP_FAIL;
+        }
+        remaining -= ret;
+    }
+    fclose(file);
+
+    esp_err_t err = audio_load_fir(FIR_UPLOAD_PATH);
+    if (err != ESP_OK) {
+        unlink(FIR_UPLOAD_PATH);
+        const char *reason = err == ESP_ERR_INVALID_SIZE ? "Impulse response longer than 8192 taps"
+                           : err == ESP_ERR_NO_MEM ? "Not enough memory for this impulse response"
+                           : "Not a 16, 24 or 32-bit WAV of 1 or 2 channels";
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, reason);
+        return ESP_FAIL;
+    }
+    unlink(AUDIO_FIR_PATH);
+    if (rename(FIR_UPLOAD_PATH, AUDIO_FIR_PATH) != 0) {
+        ESP_LOGW(TAG, "Impulse response in use but not kept for the next boot");
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, "{\"status\":\"ok\"}");
+    return ESP_OK;
+}
+
+/**
+ * DELETE handler removing the room correction impulse response
+ */
+static esp_err_t fir_delete_handler(httpd_req_t *req)
+{
+    ESP_LOGI(TAG, "Handling DELETE request for /api/fir");
+    audio_load_fir(NULL);
+    unlink(AUDIO_FIR_PATH);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, "{\"status\":\"ok\"}");
+    return ESP_OK;
+}
+
+// Level meters go out over the /ws/meters WebSocket as binary frames of
+//   version, lanes, bands, flags (bit 0 while playing),
+//   peak left, peak right, RMS left, RMS right for every lane,
+//   then the spectrum bands while any client has asked for them,
+// each value a level code counting METER_CODE_STEP_DB down from full scale.
+// A client sends a single byte to ask for the spectrum (1) or stop it (0).
+#define METER_FRAME_VERSION 1
+#define METER_MAX_CLIENTS 4
+// Meter frames per second is 1000 / METER_INTERVAL_MS, the spectrum included
+#define METER_INTERVAL_MS 100
+#define METER_FRAME_MAX (4 + SINK_MAX_LANES * 4 + METER_BANDS)
+
+typedef struct {
+    int fd;
+    bool spectrum;
+} meter_client_t;
+
+typedef struct {
+    size_t len;
+    uint8_t data[METER_FRAME_MAX];
+} meter_frame_t;
+
+// Only touched on the server task, the meter task reads the count
+static meter_client_t s_meter_clients[METER_MAX_CLIENTS];
+static volatile int s_meter_client_count = 0;
+static volatile bool s_spectrum_wanted = false;
+static TaskHandle_t s_meter_task_handle = NULL;
+
+static void update_spectrum_wanted(void)
+{
+    bool wanted = false;
+    for (int i = 0; i < s_meter_client_count; i++) {
+        wanted |= s_meter_clients[i].spectrum;
+    }
+    s_spectrum_wanted = wanted;
+    audio_set_scope_enabled(wanted);
+}
+
+static void drop_meter_client(int index)
+{
+    s_meter_clients[index] = s_meter_clients[s_meter_client_count - 1];
+    s_meter_client_count--;
+    update_spectrum_wanted();
+}
+
+// Queued to the server task, which owns the client sockets
+static void send_meter_frame(void *arg)
+{
+    meter_frame_t *frame = arg;
+    httpd_ws_frame_t ws = {
+        .final = true,
+        .type = HTTPD_WS_TYPE_BINARY,
+        .payload = frame->data,
+        .len = frame->len,
+    };
+    for (int i = s_meter_client_count - 1; i >= 0 && s_httpd_handle != NULL; i--) {
+        int fd = s_meter_clients[i].fd;
+        if (httpd_ws_get_fd_info(s_httpd_handle, fd) != HTTPD_WS_CLIENT_WEBSOCKET
+            || httpd_ws_send_frame_async(s_httpd_handle, fd, &ws) != ESP_OK) {
+            ESP_LOGI(TAG, "Meter client on socket %d gone", fd);
+            drop_meter_client(i);
+        }
+    }
+    free(frame);
+}
+
+/**
+ * Builds a meter frame every METER_INTERVAL_MS while anyone is connected.
+ * Pinned to core 0 away from the audio tasks, the spectrum FFT runs here.
+ */
+static void meter_task(void *pvParameters)
+{
+    meter_spectrum_t *spectrum = NULL;
+    int16_t *mono = NULL;
+    meter_levels_t levels[SINK_MAX_LANES];
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while (1) {
+        if (s_meter_client_count == 0) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            // Start from fresh levels, not what built up while nobody watched
+            audio_get_levels(levels, SINK_MAX_LANES);
+            last_wake = xTaskGetTickCount();
+        }
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(METER_INTERVAL_MS));
+
+        meter_frame_t *frame = malloc(sizeof(meter_frame_t));
+        if (frame == NULL) {
+            continue;
+        }
+        int lanes = audio_get_levels(levels, SINK_MAX_LANES);
+        uint8_t *p = frame->data;
+        *p++ = METER_FRAME_VERSION;
+        *p++ = (uint8_t)lanes;
+        uint8_t *bands = p++;
+        *p++ = is_playing() ? 1 : 0;
+        for (int lane = 0; lane < lanes; lane++) {
+            *p++ = meter_peak_code(&levels[lane], 0);
+            *p++ = meter_peak_code(&levels[lane], 1);
+            *p++ = meter_rms_code(&levels[lane], 0);
+            *p++ = meter_rms_code(&levels[lane], 1);
+        }
+        *bands = 0;
+        if (s_spectrum_wanted) {
+            // Allocated the first time someone asks and kept from then on
+            if (spectrum == NULL) {
+                spectrum = heap_caps_aligned_calloc(16, 1, sizeof(meter_spectrum_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+                mono = heap_caps_malloc(METER_FFT_SIZE * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+            }
+            if (spectrum != NULL && mono != NULL) {
+                uint32_t rate = audio_get_scope(mono);
+                if (rate != 0 && (rate == spectrum->sample_rate || meter_spectrum_init(spectrum, rate))) {
+                    meter_spectrum_analyze(spectrum, mono, p);
+                    p += METER_BANDS;
+                    *bands = METER_BANDS;
+                }
+            }
+        }
+        frame->len = p - frame->data;
+        if (s_httpd_handle == NULL || httpd_queue_work(s_httpd_handle, send_meter_frame, frame) != ESP_OK) {
+            free(frame);
+        }
+    }
+}
+
+/**
+ * WebSocket handler for /ws/meters, the handshake subscribes the socket to meter frames
+ */
+static esp_err_t meters_ws_handler(httpd_req_t *req)
+{
+    int fd = httpd_req_to_sockfd(req);
+    int index = -1;
+    for (int i = 0; i < s_meter_client_count; i++) {
+        if (s_meter_clients[i].fd == fd) {
+            index = i;
+        }
+    }
+
+    if (req->method == HTTP_GET) {
+        // A closed client's socket number can come back for the next one
+        if (index >= 0) {
+            drop_meter_client(index);
+        }
+        if (s_meter_client_count == METER_MAX_CLIENTS) {
+            ESP_LOGW(TAG, "Meter client on socket %d refused, %d already connected", fd, METER_MAX_CLIENTS);
+            return ESP_FAIL;
+        }
+        s_meter_clients[s_meter_client_count] = (meter_client_t){ .fd = fd, .spectrum = false };
+        s_meter_client_count++;
+        ESP_LOGI(TAG, "Meter client on socket %d connected", fd);
+        if (s_meter_task_handle != NULL) {
+            xTaskNotifyGive(s_meter_task_handle);
+        }
+        return ESP_OK;
+    }
+
+    uint8_t request = 0;
+    httpd_ws_frame_t frame = { .payload = &request };
+    esp_err_t ret = httpd_ws_recv_frame(req, &frame, 0);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (frame.len > sizeof(request)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (frame.len > 0) {
+        ret = httpd_ws_recv_frame(req, &frame, sizeof(request));
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    if (index >= 0 && frame.len == 1) {
+        s_meter_clients[index].spectrum = request == 1;
+        update_spectrum_wanted();
+    }
+    return ESP_OK;
+}
+
 /**
  * GET handler for Apple Captive Network Assistant detection
  */
@@ -1511,6 +2268,42 @@ esp_err_t web_server_start(void)
     };
     ESP_ERROR_CHECK(httpd_register_uri_handler(s_httpd_handle, &settings_post));
 
+    httpd_uri_t pipeline_post = {
+        .uri       = "/api/pipeline",
+        .method    = HTTP_POST,
+        .handler   = pipeline_post_handler,
+        .user_ctx  = NULL
+    };
+    ESP_ERROR_CHECK(httpd_register_uri_handler(s_httpd_handle, &pipeline_post));
+
+    httpd_uri_t fir_post = {
+        .uri       = "/api/fir",
+        .method    = HTTP_POST,
+        .handler   = fir_post_handler,
+        .user_ctx  = NULL
+    };
+    ESP_ERROR_CHECK(httpd_register_uri_handler(s_httpd_handle, &fir_post));
+
+    httpd_uri_t fir_delete = {
+        .uri       = "/api/fir",
+        .method    = HTTP_DELETE,
+        .handler   = fir_delete_handler,
+        .user_ctx  = NULL
+    };
+    ESP_ERROR_CHECK(httpd_register_uri_handler(s_httpd_handle, &fir_delete));
+
+    httpd_uri_t meters_ws = {
+        .uri          = "/ws/meters",
+        .method       = HTTP_GET,
+        .handler      = meters_ws_handler,
+        .user_ctx     = NULL,
+        .is_websocket = true
+    };
+    ESP_ERROR_CHECK(httpd_register_uri_handler(s_httpd_handle, &meters_ws));
+    if (s_meter_task_handle == NULL) {
+        xTaskCreatePinnedToCore(meter_task, "meters", 4096, NULL, 1, &s_meter_task_handle, 0);
+    }
+
     ESP_ERROR_CHECK(httpd_register_uri_handler(s_httpd_handle, &connect));
     ESP_ERROR_CHECK(httpd_register_uri_handler(s_httpd_handle, &reset));
 
@@ -1636,6 +2429,8 @@ esp_err_t web_server_stop(void)
     }
 
     s_httpd_handle = NULL;
+    s_meter_client_count = 0;
+    update_spectrum_wanted();
     return ESP_OK;
 }
 
@@ -9,11 +9,15 @@
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
 #include "config_manager.h"
+#include "boot_profile.h"
 #include "esp_wnm.h"
 #include "esp_rrm.h"
 #include "esp_mbo.h"
 #include "esp_mac.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
 #include <string.h>
+#include <stddef.h>
 #include <inttypes.h>
 
 static const char *TAG = "wifi_manager";
@@ -76,6 +80,7 @@ static inline uint32_t WPA_GET_LE32(const uint8_t *a)
 #define WIFI_NVS_KEY_SSID "ssid"
 #define WIFI_NVS_KEY_PASSWORD "password"
 #define WIFI_NVS_KEY_RSSI_THRESHOLD "rssi_threshold"
+#define WIFI_NVS_KEY_FAST_CONNECT "fast_connect"
 
 // Event group to signal WiFi connection events
 static EventGroupHandle_t s_wifi_event_group;
@@ -92,11 +97,114 @@ static wifi_manager_state_t s_wifi_manager_state = WIFI_MANAGER_STATE_NOT_INITIA
 // Flag to indicate we're in scan mode - used to prevent connection attempts
 static bool s_in_scan_mode = false;
 
+// Access point and DHCP lease of the last connection, to reconnect without a
+// scan and without waiting on DHCP. Kept in RTC memory, which survives deep
+// sleep and restarts, and in NVS for after a power cycle.
+#define FAST_CONNECT_MAGIC 0x46434331
+typedef struct {
+    uint32_t magic;
+    char ssid[WIFI_SSID_MAX_LENGTH + 1];
+    uint8_t bssid[6];
+    uint8_t channel;
+    esp_netif_ip_info_t ip_info;
+    esp_netif_dns_info_t dns;
+    uint32_t checksum;
+} fast_connect_cache_t;
+
+static RTC_NOINIT_ATTR fast_connect_cache_t s_rtc_cache;
+// Cache read at start, and the one being built from the current connection
+static fast_connect_cache_t s_cache;
+static bool s_cache_valid = false;
+static fast_connect_cache_t s_new_cache;
+// Set while connecting straight to the cached access point, a failure falls back to a scan
+static bool s_fast_attempt = false;
+// Set while the cached lease stands in for one DHCP didn't deliver in time
+static bool s_static_lease = false;
+static esp_timer_handle_t s_dhcp_fallback_timer = NULL;
+static wifi_connect_timing_t s_timing;
+
+// DHCP time after association before the cached lease is used instead
+#define DHCP_FALLBACK_MS 2000
+
 // Forward declarations for internal functions
 static void wifi_event_handler(void *arg, esp_event_base_t event_base, 
                               int32_t event_id, void *event_data);
 static esp_err_t start_ap_mode(void);
 
+static uint32_t fast_connect_checksum(const fast_connect_cache_t *cache) {
+    // FNV-1a over everything before the checksum
+    const uint8_t *bytes = (const uint8_t *)cache;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(fast_connect_cache_t, checksum); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static bool fast_connect_valid(const fast_connect_cache_t *cache) {
+    return cache->magic == FAST_CONNECT_MAGIC && cache->checksum == fast_connect_checksum(cache);
+}
+
+// Prefer RTC memory, it holds the latest connection even when NVS wasn't written
+static void load_fast_connect_cache(const char *ssid) {
+    s_cache_valid = false;
+    if (fast_connect_valid(&s_rtc_cache)) {
+        s_cache = s_rtc_cache;
+    } else {
+        nvs_handle_t nvs_handle;
+        size_t size = sizeof(s_cache);
+        if (nvs_open(WIFI_NVS_NAMESPACE, NVS_READONLY, &nvs_handle) != ESP_OK) {
+            return;
+        }
+        esp_err_t ret = nvs_get_blob(nvs_handle, WIFI_NVS_KEY_FAST_CONNECT, &s_cache, &size);
+        nvs_close(nvs_handle);
+        if (ret != ESP_OK || size != sizeof(s_cache) || !fast_connect_valid(&s_cache)) {
+            return;
+        }
+    }
+    // Credentials changed since
+    s_cache_valid = strncmp(s_cache.ssid, ssid, sizeof(s_cache.ssid)) == 0;
+}
+
+// Keep the connection just made, NVS is only written when something changed
+static void save_fast_connect_cache(void) {
+    s_new_cache.magic = FAST_CONNECT_MAGIC;
+    s_new_cache.checksum = fast_connect_checksum(&s_new_cache);
+    s_rtc_cache = s_new_cache;
+    if (s_cache_valid && memcmp(&s_cache, &s_new_cache, sizeof(s_cache)) == 0) {
+        return;
+    }
+    nvs_handle_t nvs_handle;
+    if (nvs_open(WIFI_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) != ESP_OK) {
+        return;
+    }
+    if (nvs_set_blob(nvs_handle, WIFI_NVS_KEY_FAST_CONNECT, &s_new_cache, sizeof(s_new_cache)) == ESP_OK) {
+        nvs_commit(nvs_handle);
+        s_cache = s_new_cache;
+        s_cache_valid = true;
+    }
+    nvs_close(nvs_handle);
+}
+
+// DHCP didn't answer in time after a fast connect, use the cached lease as a static address
+static void dhcp_fallback_cb(void *arg) {
+    if (s_wifi_manager_state == WIFI_MANAGER_STATE_CONNECTED || !s_cache_valid) {
+        return;
+    }
+    ESP_LOGW(TAG, "No DHCP lease after %d ms, using cached address " IPSTR,
+             DHCP_FALLBACK_MS, IP2STR(&s_cache.ip_info.ip));
+    esp_netif_dhcpc_stop(s_sta_netif);
+    s_static_lease = true;
+    s_timing.static_lease = true;
+    // Posts IP_EVENT_STA_GOT_IP like a lease would
+    esp_netif_set_ip_info(s_sta_netif, &s_cache.ip_info);
+    esp_netif_set_dns_info(s_sta_netif, ESP_NETIF_DNS_MAIN, &s_cache.dns);
+}
+
+void wifi_manager_get_connect_timing(wifi_connect_timing_t *timing) {
+    *timing = s_timing;
+}
+
 /**
  * Initialize the WiFi manager
  */
@@ -183,8 +291,52 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base,
                 ESP_LOGI(TAG, "STA started, connecting to AP");
                 esp_wifi_connect();
             }
+        } else if (event_id == WIFI_EVENT_STA_CONNECTED) {
+            wifi_event_sta_connected_t *event = (wifi_event_sta_connected_t *)event_data;
+            if (s_timing.associated_ms == 0) {
+                s_timing.associated_ms = (uint32_t)(esp_timer_get_time() / 1000);
+                s_timing.fast = s_fast_attempt;
+                boot_profile_mark("associated");
+                ESP_LOGI(TAG, "Associated %" PRIu32 " ms after boot%s", s_timing.associated_ms,
+                         s_fast_attempt ? " using the cached access point" : "");
+            }
+            s_fast_attempt = false;
+            memset(&s_new_cache, 0, sizeof(s_new_cache));
+            memcpy(s_new_cache.ssid, event->ssid, event->ssid_len < WIFI_SSID_MAX_LENGTH ? event->ssid_len : WIFI_SSID_MAX_LENGTH);
+            memcpy(s_new_cache.bssid, event->bssid, sizeof(s_new_cache.bssid));
+            s_new_cache.channel = event->channel;
+            if (s_cache_valid && s_dhcp_fallback_timer != NULL
+                && memcmp(event->bssid, s_cache.bssid, sizeof(s_cache.bssid)) == 0) {
+                esp_timer_start_once(s_dhcp_fallback_timer, DHCP_FALLBACK_MS * 1000);
+            }
         } else if (event_id == WIFI_EVENT_STA_DISCONNECTED) {
             wifi_event_sta_disconnected_t *disconn = event_data;
+            if (s_dhcp_fallback_timer != NULL) {
+                esp_timer_stop(s_dhcp_fallback_timer);
+            }
+            // The cached lease only stood in until the next association
+            if (s_static_lease) {
+                s_static_lease = false;
+                esp_netif_dhcpc_start(s_sta_netif);
+            }
+
+            // Only the first connection goes straight to the cached access point,
+            // every reconnect scans so a dead access point or roaming can't strand it
+            wifi_config_t wifi_config;
+            if (esp_wifi_get_config(WIFI_IF_STA, &wifi_config) == ESP_OK && wifi_config.sta.bssid_set) {
+                wifi_config.sta.bssid_set = false;
+                wifi_config.sta.channel = 0;
+                esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+            }
+            
+            // The cached access point is gone or moved, scan for the network right away
+            if (s_fast_attempt) {
+                s_fast_attempt = false;
+                s_timing.fast_failures++;
+                ESP_LOGI(TAG, "Cached access point not found (reason %" PRIu16 "), scanning", disconn->reason);
+                esp_wifi_connect();
+                return;
+            }
             
             // Re-enable AP mode if it was hidden while connected
             app_config_t* config = config_manager_get_config();
@@ -236,6 +388,19 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base,
             ESP_LOGI(TAG, "Got IP address: " IPSTR, 
                     IP2STR(&event->ip_info.ip));
             s_retry_num = 0;
+            if (s_dhcp_fallback_timer != NULL) {
+                esp_timer_stop(s_dhcp_fallback_timer);
+            }
+            if (s_timing.got_ip_ms == 0) {
+                s_timing.got_ip_ms = (uint32_t)(esp_timer_get_time() / 1000);
+                boot_profile_mark("got_ip");
+                ESP_LOGI(TAG, "IP address %" PRIu32 " ms after boot", s_timing.got_ip_ms);
+            }
+            if (!s_static_lease) {
+                s_new_cache.ip_info = event->ip_info;
+                esp_netif_get_dns_info(s_sta_netif, ESP_NETIF_DNS_MAIN, &s_new_cache.dns);
+                save_fast_connect_cache();
+            }
             xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
             s_wifi_manager_state = WIFI_MANAGER_STATE_CONNECTED;
             
@@ -309,6 +474,24 @@ esp_err_t wifi_manager_start(void) {
         
         strncpy((char*)wifi_sta_config.sta.ssid, ssid, sizeof(wifi_sta_config.sta.ssid));
         strncpy((char*)wifi_sta_config.sta.password, password, sizeof(wifi_sta_config.sta.password));
+
+        // Go straight to the access point of the last connection, only its channel is probed
+        load_fast_connect_cache(ssid);
+        if (s_cache_valid) {
+            ESP_LOGI(TAG, "Connecting to cached access point " MACSTR " on channel %u",
+                     MAC2STR(s_cache.bssid), s_cache.channel);
+            memcpy(wifi_sta_config.sta.bssid, s_cache.bssid, sizeof(s_cache.bssid));
+            wifi_sta_config.sta.bssid_set = true;
+            wifi_sta_config.sta.channel = s_cache.channel;
+            s_fast_attempt = true;
+            if (s_dhcp_fallback_timer == NULL) {
+                const esp_timer_create_args_t timer_args = {
+                    .callback = dhcp_fallback_cb,
+                    .name = "dhcp_fallback",
+                };
+                ESP_ERROR_CHECK(esp_timer_create(&timer_args, &s_dhcp_fallback_timer));
+            }
+        }
         
         ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_sta_config));
         
@@ -456,6 +639,25 @@ bool wifi_manager_has_credentials(void) {
     return true;
 }
 
+/**
+ * Check if the stored network has a cached access point to connect straight to
+ */
+bool wifi_manager_has_fast_connect(void) {
+    nvs_handle_t nvs_handle;
+    if (nvs_open(WIFI_NVS_NAMESPACE, NVS_READONLY, &nvs_handle) != ESP_OK) {
+        return false;
+    }
+    char ssid[WIFI_SSID_MAX_LENGTH + 1] = {0};
+    size_t required_size = sizeof(ssid);
+    esp_err_t ret = nvs_get_str(nvs_handle, WIFI_NVS_KEY_SSID, ssid, &required_size);
+    nvs_close(nvs_handle);
+    if (ret != ESP_OK) {
+        return false;
+    }
+    load_fast_connect_cache(ssid);
+    return s_cache_valid;
+}
+
 /**
  * Save WiFi credentials to NVS
  */
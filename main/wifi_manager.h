@@ -29,6 +29,15 @@ typedef enum {
 #define WIFI_BAND_2_4GHZ 0
 #define WIFI_BAND_5GHZ   1
 
+// How the connection at boot went, times are since the app started
+typedef struct {
+    bool fast;                  // Connected straight to the cached access point
+    bool static_lease;          // DHCP was slow and the cached lease was used
+    uint32_t fast_failures;     // Cached access points that didn't answer and needed a scan
+    uint32_t associated_ms;     // Boot to associated, 0 until then
+    uint32_t got_ip_ms;         // Boot to IP address, 0 until then
+} wifi_connect_timing_t;
+
 // Structure to hold WiFi network scan result info
 typedef struct {
     char ssid[WIFI_SSID_MAX_LENGTH + 1];
@@ -74,6 +83,13 @@ wifi_manager_state_t wifi_manager_get_state(void);
  */
 bool wifi_manager_has_credentials(void);
 
+/**
+ * @brief Check if the stored network has a cached access point from the last connection
+ * 
+ * @return true if wifi_manager_start() will connect straight to it without a scan
+ */
+bool wifi_manager_has_fast_connect(void);
+
 /**
  * @brief Save WiFi credentials to NVS
  * 
@@ -99,6 +115,13 @@ esp_err_t wifi_manager_clear_credentials(void);
  */
 esp_err_t wifi_manager_connect(const char *ssid, const char *password);
 
+/**
+ * @brief Get the boot connection timing
+ *
+ * @param timing Filled with whether the cached access point and lease were used and how long it took
+ */
+void wifi_manager_get_connect_timing(wifi_connect_timing_t *timing);
+
 /**
  * @brief Get the currently connected SSID (if connected)
  * 